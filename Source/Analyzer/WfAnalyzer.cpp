@@ -511,8 +511,10 @@ WfLexicalScopeManager
 				statementScopes.Clear();
 				expressionScopes.Clear();
 				expressionResolvings.Clear();
+				constantValues.Clear();
 				functionLambdaCaptures.Clear();
 				orderedLambdaCaptures.Clear();
+				interfaceMethods.Clear();
 			}
 
 			bool WfLexicalScopeManager::CheckScopes()
@@ -617,6 +619,12 @@ WfLexicalScopeManager
 					ValidateModuleSemantic(this, module);
 				}
 
+				EXIT_IF_ERRORS_EXIST;
+				FOREACH(Ptr<WfModule>, module, modules)
+				{
+					FoldModuleConstants(this, module);
+				}
+
 #undef EXIT_IF_ERRORS_EXIST
 			}
 			
@@ -773,19 +781,34 @@ WfCodegenContext
 			{
 			}
 
+			parsing::ParsingTextRange WfCodegenContext::GetPositionBeforeCodegen(parsing::ParsingTreeCustomBase* node)
+			{
+				if (!assembly->insAfterCodegen)
+				{
+					return node->codeRange;
+				}
+				return nodePositionsBeforeCodegen[node];
+			}
+
 			vint WfCodegenContext::AddInstruction(parsing::ParsingTreeCustomBase* node, const runtime::WfInstruction& ins)
 			{
 				auto index = assembly->instructions.Add(ins);
 				if (node)
 				{
-					assembly->insBeforeCodegen->instructionCodeMapping.Add(nodePositionsBeforeCodegen[node]);
-					assembly->insAfterCodegen->instructionCodeMapping.Add(nodePositionsAfterCodegen[node]);
+					assembly->insBeforeCodegen->instructionCodeMapping.Add(GetPositionBeforeCodegen(node));
+					if (assembly->insAfterCodegen)
+					{
+						assembly->insAfterCodegen->instructionCodeMapping.Add(nodePositionsAfterCodegen[node]);
+					}
 				}
 				else
 				{
 					parsing::ParsingTextRange range;
 					assembly->insBeforeCodegen->instructionCodeMapping.Add(range);
-					assembly->insAfterCodegen->instructionCodeMapping.Add(range);
+					if (assembly->insAfterCodegen)
+					{
+						assembly->insAfterCodegen->instructionCodeMapping.Add(range);
+					}
 				}
 				return index;
 			}
@@ -794,8 +817,11 @@ WfCodegenContext
 			{
 				auto context = functionContext->GetCurrentScopeContext();
 				context->exitInstructions.Add(ins);
-				context->instructionCodeMappingBeforeCodegen.Add(nodePositionsBeforeCodegen[node]);
-				context->instructionCodeMappingAfterCodegen.Add(nodePositionsAfterCodegen[node]);
+				context->instructionCodeMappingBeforeCodegen.Add(GetPositionBeforeCodegen(node));
+				if (assembly->insAfterCodegen)
+				{
+					context->instructionCodeMappingAfterCodegen.Add(nodePositionsAfterCodegen[node]);
+				}
 			}
 
 			void WfCodegenContext::ApplyExitInstructions(Ptr<WfCodegenScopeContext> scopeContext)
@@ -804,7 +830,10 @@ WfCodegenContext
 				{
 					CopyFrom(assembly->instructions, scopeContext->exitInstructions, true);
 					CopyFrom(assembly->insBeforeCodegen->instructionCodeMapping, scopeContext->instructionCodeMappingBeforeCodegen, true);
-					CopyFrom(assembly->insAfterCodegen->instructionCodeMapping, scopeContext->instructionCodeMappingAfterCodegen, true);
+					if (assembly->insAfterCodegen)
+					{
+						CopyFrom(assembly->insAfterCodegen->instructionCodeMapping, scopeContext->instructionCodeMappingAfterCodegen, true);
+					}
 				}
 			}
 		}
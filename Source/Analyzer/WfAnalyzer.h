@@ -127,8 +127,10 @@ Scope Manager
 				typedef collections::Dictionary<Ptr<WfStatement>, Ptr<WfLexicalScope>>						StatementScopeMap;
 				typedef collections::Dictionary<Ptr<WfExpression>, Ptr<WfLexicalScope>>						ExpressionScopeMap;
 				typedef collections::Dictionary<Ptr<WfExpression>, ResolveExpressionResult>					ExpressionResolvingMap;
+				typedef collections::Dictionary<Ptr<WfExpression>, reflection::description::Value>			ExpressionConstantMap;
 				typedef collections::Group<WfFunctionDeclaration*, Ptr<WfLexicalSymbol>>					FunctionLambdaCaptureGroup;
 				typedef collections::Group<WfOrderedLambdaExpression*, Ptr<WfLexicalSymbol>>				OrderedLambdaCaptureGroup;
+				typedef collections::Dictionary<WfFunctionDeclaration*, reflection::description::IMethodInfo*>	InterfaceMethodMap;
 
 			protected:
 				ModuleList									modules;
@@ -152,8 +154,10 @@ Scope Manager
 				StatementScopeMap							statementScopes;			// the nearest scope for the statement
 				ExpressionScopeMap							expressionScopes;			// the nearest scope for the expression
 				ExpressionResolvingMap						expressionResolvings;		// the resolving result for the expression
+				ExpressionConstantMap						constantValues;				// the folded value for the expression, in the type of the resolving result
 				FunctionLambdaCaptureGroup					functionLambdaCaptures;		// all captured symbol in an lambda expression
 				OrderedLambdaCaptureGroup					orderedLambdaCaptures;		// all captured symbol in an lambda expression
+				InterfaceMethodMap							interfaceMethods;			// the implemented interface method for a function in a new interface expression
 
 				/// <summary>Create a Workflow compiler.</summary>
 				/// <param name="_parsingTable">The workflow parser table. It can be retrived from [M:vl.workflow.WfLoadTable].</param>
@@ -310,6 +314,18 @@ Semantic Analyzing
 			extern Ptr<reflection::description::ITypeInfo>	GetLeftValueExpressionType(WfLexicalScopeManager* manager, Ptr<WfExpression> expression);
 			extern Ptr<reflection::description::ITypeInfo>	GetEnumerableExpressionItemType(WfLexicalScopeManager* manager, Ptr<WfExpression> expression, Ptr<reflection::description::ITypeInfo> expectedType);
 
+/***********************************************************************
+Constant Folding
+***********************************************************************/
+
+			extern void										FoldModuleConstants(WfLexicalScopeManager* manager, Ptr<WfModule> module);
+			extern void										FoldDeclarationConstants(WfLexicalScopeManager* manager, Ptr<WfDeclaration> declaration);
+			extern void										FoldStatementConstants(WfLexicalScopeManager* manager, Ptr<WfStatement> statement);
+			extern void										FoldExpressionConstants(WfLexicalScopeManager* manager, Ptr<WfExpression> expression);
+			extern bool										ConvertConstantValue(const reflection::description::Value& value, reflection::description::ITypeInfo* type, reflection::description::Value& converted);
+			extern bool										FoldBinaryConstant(TypeFlag flag, WfBinaryOperator op, const reflection::description::Value& first, const reflection::description::Value& second, reflection::description::Value& result);
+			extern bool										GetConstantValue(WfLexicalScopeManager* manager, Ptr<WfExpression> expression, Ptr<reflection::description::ITypeInfo> expectedType, reflection::description::Value& value);
+
 /***********************************************************************
 Code Generation
 ***********************************************************************/
@@ -321,6 +337,15 @@ Code Generation
 				WfOrderedLambdaExpression*			orderedLambdaExpression = 0;
 				WfMemberExpression*					methodReferenceExpression = 0;
 				WfExpression*						staticMethodReferenceExpression = 0;
+				bool								capturesAsArguments = false;	// the closure never escapes, captured values are passed after arguments
+				Ptr<collections::List<Ptr<WfLexicalSymbol>>>	interfaceCaptures;		// captured symbols shared by all methods of a new interface expression
+			};
+
+			struct WfCodegenLiftedClosure
+			{
+				vint								functionIndex = -1;
+				vint								firstCapturedVariable = -1;		// captured values are copied to local variables when the closure is created
+				vint								capturedVariableCount = 0;
 			};
 
 			enum class WfCodegenScopeType
@@ -351,6 +376,7 @@ Code Generation
 			{
 				typedef collections::Dictionary<WfLexicalSymbol*, vint>				VariableIndexMap;
 				typedef collections::Dictionary<vint, WfCodegenLambdaContext>		ClosureIndexMap;
+				typedef collections::Dictionary<WfLexicalSymbol*, WfCodegenLiftedClosure>	LiftedClosureMap;
 				typedef collections::List<Ptr<WfCodegenScopeContext>>				ScopeContextList;
 			public:
 				Ptr<runtime::WfAssemblyFunction>	function;
@@ -358,6 +384,7 @@ Code Generation
 				VariableIndexMap					arguments;
 				VariableIndexMap					localVariables;
 				ClosureIndexMap						closuresToCodegen;
+				LiftedClosureMap					liftedClosures;
 				ScopeContextList					scopeContextStack;
 
 				WfCodegenFunctionContext();
@@ -373,17 +400,24 @@ Code Generation
 				typedef collections::Dictionary<WfLexicalSymbol*, vint>											VariableIndexMap;
 				typedef collections::Dictionary<WfLexicalSymbol*, vint>											FunctionIndexMap;
 				typedef collections::Dictionary<parsing::ParsingTreeCustomBase*, parsing::ParsingTextRange>		NodePositionMap;
+				typedef collections::SortedList<WfLexicalSymbol*>												SymbolSet;
 			public:
 				Ptr<runtime::WfAssembly>			assembly;
 				WfLexicalScopeManager*				manager;
 				VariableIndexMap					globalVariables;
 				FunctionIndexMap					globalFunctions;
+				SymbolSet							escapedSymbols;		// symbols that are captured, or used other than being called
+				bool								inlineFunctions = false;
+				bool								hashMaps = false;
+				collections::List<vint>				inliningFunctions;	// global functions whose body is being inlined
 				Ptr<WfCodegenFunctionContext>		functionContext;
-				NodePositionMap						nodePositionsBeforeCodegen;
-				NodePositionMap						nodePositionsAfterCodegen;
+				NodePositionMap						nodePositionsBeforeCodegen;	// empty if generated syntax trees are not printed
+				NodePositionMap						nodePositionsAfterCodegen;	// empty if generated syntax trees are not printed
 
 				WfCodegenContext(Ptr<runtime::WfAssembly> _assembly, WfLexicalScopeManager* _manager);
 
+				parsing::ParsingTextRange			GetPositionBeforeCodegen(parsing::ParsingTreeCustomBase* node);
+
 				vint								AddInstruction(parsing::ParsingTreeCustomBase* node, const runtime::WfInstruction& ins);
 				void								AddExitInstruction(parsing::ParsingTreeCustomBase* node, const runtime::WfInstruction& ins);
 				void								ApplyExitInstructions(Ptr<WfCodegenScopeContext> scopeContext);
@@ -394,15 +428,36 @@ Code Generation
 			extern void										GenerateInitializeInstructions(WfCodegenContext& context, Ptr<WfDeclaration> declaration);
 			extern void										GenerateDeclarationInstructions(WfCodegenContext& context, Ptr<WfDeclaration> declaration);
 			extern void										GenerateStatementInstructions(WfCodegenContext& context, Ptr<WfStatement> statement);
+			extern bool										GenerateLiftedClosureInstructions(WfCodegenContext& context, WfLexicalSymbol* symbol, Ptr<WfExpression> expression);
 			extern Ptr<reflection::description::ITypeInfo>	GenerateExpressionInstructions(WfCodegenContext& context, Ptr<WfExpression> expression, Ptr<reflection::description::ITypeInfo> expectedType = 0);
+			extern void										GenerateRangeBoundaryInstructions(WfCodegenContext& context, Ptr<WfExpression> boundary, WfRangeBoundary boundaryType, bool beginBoundary, Ptr<reflection::description::ITypeInfo> elementType, parsing::ParsingTreeCustomBase* node);
 			extern void										GenerateTypeCastInstructions(WfCodegenContext& context, Ptr<reflection::description::ITypeInfo> expectedType, bool strongCast, WfExpression* node);
 			extern void										GenerateTypeTestingInstructions(WfCodegenContext& context, Ptr<reflection::description::ITypeInfo> expectedType, WfExpression* node);
 			extern runtime::WfInsType						GetInstructionTypeArgument(Ptr<reflection::description::ITypeInfo> expectedType);
+			extern bool										IsLabelInstruction(runtime::WfInsCode code);
+			extern void										OptimizeInstructions(Ptr<runtime::WfAssembly> assembly);
+			extern void										GenerateSuperInstructions(Ptr<runtime::WfAssembly> assembly);
+
+			/// <summary>Options for generating an assembly.</summary>
+			struct WfCodegenOptions
+			{
+				/// <summary>Set to true to remove unreachable instructions, dead stores of local variables and redundant jumps. Values of local variables shown in a debugger may be out of date.</summary>
+				bool										optimizeInstructions = false;
+				/// <summary>Set to true to replace calls to global functions whose body is a single return statement with the returned expression. Inlined calls are not shown in the call stack of a debugger.</summary>
+				bool										inlineFunctions = false;
+				/// <summary>Set to true to create maps from map literals as [T:vl.workflow.runtime.WfRuntimeHashMap], which sets and finds keys in constant time. Keys of these maps are enumerated in inserting order instead of in sorted order.</summary>
+				bool										hashMaps = false;
+				/// <summary>Set to false to skip printing generated syntax trees. [F:vl.workflow.runtime.WfAssembly.insAfterCodegen] will be null, and positions in [F:vl.workflow.runtime.WfAssembly.insBeforeCodegen] are read from syntax trees.</summary>
+				bool										debugInfoAfterCodegen = true;
+				/// <summary>Set to false to store empty strings instead of module codes in debug informations. Instructions are still mapped to rows, so code line break points still work.</summary>
+				bool										embedModuleCodes = true;
+			};
 
 			/// <summary>Generate an assembly from a compiler. [M:vl.workflow.analyzer.WfLexicalScopeManager.Rebuild] should be called before using this function.</summary>
 			/// <returns>The generated assembly.</returns>
 			/// <param name="manager">The Workflow compiler.</param>
-			extern Ptr<runtime::WfAssembly>					GenerateAssembly(WfLexicalScopeManager* manager);
+			/// <param name="options">Options for generating the assembly.</param>
+			extern Ptr<runtime::WfAssembly>					GenerateAssembly(WfLexicalScopeManager* manager, const WfCodegenOptions& options = WfCodegenOptions());
 
 			/// <summary>Compile a Workflow program.</summary>
 			/// <returns>The generated assembly.</returns>
@@ -410,14 +465,54 @@ Code Generation
 			/// <param name="manager">The workflow compiler to reuse the cache of C++ reflectable types.</param>
 			/// <param name="moduleCodes">All workflow module codes.</param>
 			/// <param name="errors">Container to get all compileing errors.</param>
-			extern Ptr<runtime::WfAssembly>					Compile(Ptr<parsing::tabling::ParsingTable> table, WfLexicalScopeManager* manager, collections::List<WString>& moduleCodes, collections::List<Ptr<parsing::ParsingError>>& errors);
+			/// <param name="options">Options for generating the assembly.</param>
+			extern Ptr<runtime::WfAssembly>					Compile(Ptr<parsing::tabling::ParsingTable> table, WfLexicalScopeManager* manager, collections::List<WString>& moduleCodes, collections::List<Ptr<parsing::ParsingError>>& errors, const WfCodegenOptions& options = WfCodegenOptions());
 			
 			/// <summary>Compile a Workflow program.</summary>
 			/// <returns>The generated assembly.</returns>
 			/// <param name="table">The workflow parser table. It can be retrived from [M:vl.workflow.WfLoadTable].</param>
 			/// <param name="moduleCodes">All workflow module codes.</param>
 			/// <param name="errors">Container to get all compileing errors.</param>
-			extern Ptr<runtime::WfAssembly>					Compile(Ptr<parsing::tabling::ParsingTable> table, collections::List<WString>& moduleCodes, collections::List<Ptr<parsing::ParsingError>>& errors);
+			/// <param name="options">Options for generating the assembly.</param>
+			extern Ptr<runtime::WfAssembly>					Compile(Ptr<parsing::tabling::ParsingTable> table, collections::List<WString>& moduleCodes, collections::List<Ptr<parsing::ParsingError>>& errors, const WfCodegenOptions& options = WfCodegenOptions());
+
+/***********************************************************************
+Assembly Cache
+***********************************************************************/
+
+			/// <summary>Compute a fingerprint of all types, members and their signatures in the global type manager.</summary>
+			/// <returns>The fingerprint.</returns>
+			extern vuint64_t								GetReflectionFingerprint();
+
+			/// <summary>A folder of serialized assemblies. An assembly is found by a key computed from module codes, codegen options, the binary version and the reflection fingerprint, so changing any of them compiles modules again.</summary>
+			class WfAssemblyCache : public Object
+			{
+			protected:
+				WString										folder;
+				vuint64_t									reflectionFingerprint;
+
+				WString										GetFilePath(vuint64_t key);
+				Ptr<runtime::WfAssembly>					Load(vuint64_t key);
+				void										Save(vuint64_t key, Ptr<runtime::WfAssembly> assembly);
+			public:
+				/// <summary>Create a cache. The reflection fingerprint is computed here, create another cache after types are loaded or unloaded.</summary>
+				/// <param name="_folder">An existing folder to store assemblies.</param>
+				WfAssemblyCache(const WString& _folder);
+
+				/// <summary>Compute the key of an assembly.</summary>
+				/// <returns>The key.</returns>
+				/// <param name="moduleCodes">All workflow module codes.</param>
+				/// <param name="options">Options for generating the assembly.</param>
+				vuint64_t									GetKey(collections::List<WString>& moduleCodes, const WfCodegenOptions& options);
+
+				/// <summary>Load a Workflow program from the cache, or compile it and store it in the cache.</summary>
+				/// <returns>The assembly.</returns>
+				/// <param name="table">The workflow parser table. It can be retrived from [M:vl.workflow.WfLoadTable].</param>
+				/// <param name="moduleCodes">All workflow module codes.</param>
+				/// <param name="errors">Container to get all compileing errors. Failed compilings are not cached.</param>
+				/// <param name="options">Options for generating the assembly.</param>
+				Ptr<runtime::WfAssembly>					Compile(Ptr<parsing::tabling::ParsingTable> table, collections::List<WString>& moduleCodes, collections::List<Ptr<parsing::ParsingError>>& errors, const WfCodegenOptions& options = WfCodegenOptions());
+			};
 
 /***********************************************************************
 Error Messages
@@ -0,0 +1,286 @@
+#include "WfAnalyzer.h"
+#include <stdio.h>
+
+namespace vl
+{
+	namespace workflow
+	{
+		namespace analyzer
+		{
+			using namespace collections;
+			using namespace parsing;
+			using namespace reflection;
+			using namespace reflection::description;
+			using namespace runtime;
+
+/***********************************************************************
+WfFingerprint
+***********************************************************************/
+
+			// 64 bits FNV-1a hash
+			class WfFingerprint
+			{
+			public:
+				vuint64_t									value = 14695981039346656037ULL;
+
+				void AddBytes(const void* data, vint size)
+				{
+					auto bytes = (const vuint8_t*)data;
+					for (vint i = 0; i < size; i++)
+					{
+						value ^= bytes[i];
+						value *= 1099511628211ULL;
+					}
+				}
+
+				WfFingerprint& operator<<(vint64_t number)
+				{
+					AddBytes(&number, sizeof(number));
+					return *this;
+				}
+
+				WfFingerprint& operator<<(const WString& text)
+				{
+					*this << (vint64_t)text.Length();
+					AddBytes(text.Buffer(), text.Length() * sizeof(wchar_t));
+					return *this;
+				}
+
+				WfFingerprint& operator<<(ITypeInfo* typeInfo)
+				{
+					return *this << (typeInfo ? typeInfo->GetTypeFriendlyName() : WString::Empty);
+				}
+
+				WfFingerprint& operator<<(IMethodGroupInfo* group)
+				{
+					if (!group)
+					{
+						return *this << (vint64_t)-1;
+					}
+
+					vint count = group->GetMethodCount();
+					*this << group->GetName() << (vint64_t)count;
+					for (vint i = 0; i < count; i++)
+					{
+						auto method = group->GetMethod(i);
+						vint parameterCount = method->GetParameterCount();
+						*this << (vint64_t)method->IsStatic() << method->GetReturn() << (vint64_t)parameterCount;
+						for (vint j = 0; j < parameterCount; j++)
+						{
+							auto parameter = method->GetParameter(j);
+							*this << parameter->GetName() << parameter->GetType();
+						}
+					}
+					return *this;
+				}
+
+				WfFingerprint& operator<<(ITypeDescriptor* type)
+				{
+					*this << type->GetTypeName() << (vint64_t)(type->GetValueSerializer() != nullptr);
+
+					vint count = type->GetBaseTypeDescriptorCount();
+					*this << (vint64_t)count;
+					for (vint i = 0; i < count; i++)
+					{
+						*this << type->GetBaseTypeDescriptor(i)->GetTypeName();
+					}
+
+					count = type->GetPropertyCount();
+					*this << (vint64_t)count;
+					for (vint i = 0; i < count; i++)
+					{
+						auto property = type->GetProperty(i);
+						*this << property->GetName() << (vint64_t)property->IsReadable() << (vint64_t)property->IsWritable() << property->GetReturn();
+					}
+
+					count = type->GetEventCount();
+					*this << (vint64_t)count;
+					for (vint i = 0; i < count; i++)
+					{
+						auto event = type->GetEvent(i);
+						*this << event->GetName() << event->GetHandlerType();
+					}
+
+					count = type->GetMethodGroupCount();
+					*this << (vint64_t)count;
+					for (vint i = 0; i < count; i++)
+					{
+						*this << type->GetMethodGroup(i);
+					}
+					return *this << type->GetConstructorGroup();
+				}
+			};
+
+			vuint64_t GetReflectionFingerprint()
+			{
+				WfFingerprint fingerprint;
+				auto manager = GetGlobalTypeManager();
+				vint count = manager->GetTypeDescriptorCount();
+				fingerprint << (vint64_t)count;
+				for (vint i = 0; i < count; i++)
+				{
+					fingerprint << manager->GetTypeDescriptor(i);
+				}
+				return fingerprint.value;
+			}
+
+/***********************************************************************
+WfAssemblyCache
+***********************************************************************/
+
+			bool RemoveCacheFile(const WString& path)
+			{
+#if defined VCZH_MSVC
+				return _wremove(path.Buffer()) == 0;
+#elif defined VCZH_GCC
+				return remove(wtoa(path).Buffer()) == 0;
+#endif
+			}
+
+			bool RenameCacheFile(const WString& from, const WString& to)
+			{
+#if defined VCZH_MSVC
+				// _wrename does not replace an existing file
+				RemoveCacheFile(to);
+				return _wrename(from.Buffer(), to.Buffer()) == 0;
+#elif defined VCZH_GCC
+				return rename(wtoa(from).Buffer(), wtoa(to).Buffer()) == 0;
+#endif
+			}
+
+			// a file begins with its key, the size and the hash of the serialized assembly, so partially written or broken files are never deserialized
+			struct WfAssemblyCacheHeader
+			{
+				vuint64_t									key;
+				vuint64_t									size;
+				vuint64_t									hash;
+			};
+
+			WString WfAssemblyCache::GetFilePath(vuint64_t key)
+			{
+				return folder + u64tow(key) + L".wfasm";
+			}
+
+			Ptr<WfAssembly> WfAssemblyCache::Load(vuint64_t key)
+			{
+				stream::FileStream fileStream(GetFilePath(key), stream::FileStream::ReadOnly);
+				if (!fileStream.IsAvailable())
+				{
+					return nullptr;
+				}
+
+				WfAssemblyCacheHeader header;
+				if (fileStream.Read(&header, sizeof(header)) != sizeof(header) || header.key != key || header.size != (vuint64_t)(fileStream.Size() - sizeof(header)))
+				{
+					return nullptr;
+				}
+
+				Array<char> buffer((vint)header.size);
+				if (header.size > 0 && fileStream.Read(&buffer[0], buffer.Count()) != buffer.Count())
+				{
+					return nullptr;
+				}
+
+				WfFingerprint hash;
+				if (header.size > 0) hash.AddBytes(&buffer[0], buffer.Count());
+				if (hash.value != header.hash)
+				{
+					return nullptr;
+				}
+
+				// an assembly that could not be loaded, e.g. a type is renamed without changing the fingerprint, is compiled again
+				stream::MemoryWrapperStream memoryStream(header.size > 0 ? &buffer[0] : nullptr, buffer.Count());
+				try
+				{
+					return new WfAssembly(memoryStream);
+				}
+				catch (const Error&)
+				{
+					return nullptr;
+				}
+				catch (const Exception&)
+				{
+					return nullptr;
+				}
+			}
+
+			void WfAssemblyCache::Save(vuint64_t key, Ptr<WfAssembly> assembly)
+			{
+				stream::MemoryStream memoryStream;
+				assembly->Serialize(memoryStream);
+
+				WfAssemblyCacheHeader header;
+				header.key = key;
+				header.size = (vuint64_t)memoryStream.Size();
+				WfFingerprint hash;
+				hash.AddBytes(memoryStream.GetInternalBuffer(), (vint)memoryStream.Size());
+				header.hash = hash.value;
+
+				// the file is written to a temporary file and then renamed, so other processes never load a partially written file
+				// failing to write the cache only makes the next compiling slower
+				auto filePath = GetFilePath(key);
+				auto tempPath = filePath + L"." + itow(Thread::GetCurrentThreadId()) + L".tmp";
+				bool written = false;
+				{
+					stream::FileStream fileStream(tempPath, stream::FileStream::WriteOnly);
+					if (fileStream.IsAvailable())
+					{
+						written =
+							fileStream.Write(&header, sizeof(header)) == sizeof(header) &&
+							fileStream.Write(memoryStream.GetInternalBuffer(), (vint)memoryStream.Size()) == memoryStream.Size();
+					}
+				}
+				if (!written || !RenameCacheFile(tempPath, filePath))
+				{
+					RemoveCacheFile(tempPath);
+				}
+			}
+
+			WfAssemblyCache::WfAssemblyCache(const WString& _folder)
+				:folder(_folder)
+				, reflectionFingerprint(GetReflectionFingerprint())
+			{
+				if (folder.Length() > 0 && folder[folder.Length() - 1] != L'/' && folder[folder.Length() - 1] != L'\\')
+				{
+					folder += L"/";
+				}
+			}
+
+			vuint64_t WfAssemblyCache::GetKey(collections::List<WString>& moduleCodes, const WfCodegenOptions& options)
+			{
+				WfFingerprint fingerprint;
+				fingerprint
+					<< (vint64_t)WfAssembly::BinaryVersion
+					<< (vint64_t)reflectionFingerprint
+					<< (vint64_t)options.optimizeInstructions
+					<< (vint64_t)options.inlineFunctions
+					<< (vint64_t)options.hashMaps
+					<< (vint64_t)options.debugInfoAfterCodegen
+					<< (vint64_t)options.embedModuleCodes
+					<< (vint64_t)moduleCodes.Count();
+				FOREACH(WString, code, moduleCodes)
+				{
+					fingerprint << code;
+				}
+				return fingerprint.value;
+			}
+
+			Ptr<WfAssembly> WfAssemblyCache::Compile(Ptr<parsing::tabling::ParsingTable> table, collections::List<WString>& moduleCodes, collections::List<Ptr<parsing::ParsingError>>& errors, const WfCodegenOptions& options)
+			{
+				auto key = GetKey(moduleCodes, options);
+				if (auto assembly = Load(key))
+				{
+					return assembly;
+				}
+
+				WfLexicalScopeManager manager(table);
+				auto assembly = analyzer::Compile(table, &manager, moduleCodes, errors, options);
+				if (assembly)
+				{
+					Save(key, assembly);
+				}
+				return assembly;
+			}
+		}
+	}
+}
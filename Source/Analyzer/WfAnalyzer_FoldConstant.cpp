@@ -0,0 +1,804 @@
+#include "WfAnalyzer.h"
+#include <math.h>
+#include <limits>
+
+namespace vl
+{
+	namespace workflow
+	{
+		namespace analyzer
+		{
+			using namespace collections;
+			using namespace reflection;
+			using namespace reflection::description;
+
+#define FOLD_CONSTANT_INTEGER_TYPES(F)\
+			F(I1, vint8_t)\
+			F(I2, vint16_t)\
+			F(I4, vint32_t)\
+			F(I8, vint64_t)\
+			F(U1, vuint8_t)\
+			F(U2, vuint16_t)\
+			F(U4, vuint32_t)\
+			F(U8, vuint64_t)\
+
+#define FOLD_CONSTANT_FLOAT_TYPES(F)\
+			F(F4, float)\
+			F(F8, double)\
+
+/***********************************************************************
+Operators
+***********************************************************************/
+
+			// all operators behave exactly the same as the runtime, operations that may fail or raise exceptions are not folded
+
+			template<typename T>
+			bool FoldCompareConstant(WfBinaryOperator op, const Value& first, const Value& second, Value& result)
+			{
+				T firstValue = UnboxValue<T>(first);
+				T secondValue = UnboxValue<T>(second);
+				vint compare = firstValue < secondValue ? -1 : firstValue > secondValue ? 1 : 0;
+				switch (op)
+				{
+				case WfBinaryOperator::LT: result = BoxValue(compare < 0); return true;
+				case WfBinaryOperator::GT: result = BoxValue(compare > 0); return true;
+				case WfBinaryOperator::LE: result = BoxValue(compare <= 0); return true;
+				case WfBinaryOperator::GE: result = BoxValue(compare >= 0); return true;
+				case WfBinaryOperator::EQ: result = BoxValue(compare == 0); return true;
+				case WfBinaryOperator::NE: result = BoxValue(compare != 0); return true;
+				default: return false;
+				}
+			}
+
+			template<typename T>
+			bool FoldExpConstant(T firstValue, T secondValue, Value& result)
+			{
+				double value = exp(secondValue * log(firstValue));
+				if (value != value || value < (double)std::numeric_limits<T>::lowest() || value >= (double)std::numeric_limits<T>::max() + 1)
+				{
+					return false;
+				}
+				result = BoxValue<T>((T)value);
+				return true;
+			}
+
+			template<typename T>
+			bool FoldIntegerConstant(WfBinaryOperator op, const Value& first, const Value& second, Value& result)
+			{
+				T firstValue = UnboxValue<T>(first);
+				T secondValue = UnboxValue<T>(second);
+				switch (op)
+				{
+				case WfBinaryOperator::Exp: return FoldExpConstant<T>(firstValue, secondValue, result);
+				case WfBinaryOperator::Add: result = BoxValue<T>((T)(firstValue + secondValue)); return true;
+				case WfBinaryOperator::Sub: result = BoxValue<T>((T)(firstValue - secondValue)); return true;
+				case WfBinaryOperator::Mul: result = BoxValue<T>((T)(firstValue * secondValue)); return true;
+				case WfBinaryOperator::Div:
+				case WfBinaryOperator::Mod:
+					if (secondValue == 0 || (std::numeric_limits<T>::is_signed && secondValue == (T)-1))
+					{
+						return false;
+					}
+					result = BoxValue<T>((T)(op == WfBinaryOperator::Div ? firstValue / secondValue : firstValue % secondValue));
+					return true;
+				case WfBinaryOperator::Shl:
+				case WfBinaryOperator::Shr:
+					if (secondValue < 0 || secondValue >= (T)(sizeof(T) * 8))
+					{
+						return false;
+					}
+					result = BoxValue<T>((T)(op == WfBinaryOperator::Shl ? firstValue << secondValue : firstValue >> secondValue));
+					return true;
+				case WfBinaryOperator::Xor: result = BoxValue<T>((T)(firstValue ^ secondValue)); return true;
+				case WfBinaryOperator::And: result = BoxValue<T>((T)(firstValue & secondValue)); return true;
+				case WfBinaryOperator::Or: result = BoxValue<T>((T)(firstValue | secondValue)); return true;
+				default: return false;
+				}
+			}
+
+			template<typename T>
+			bool FoldFloatConstant(WfBinaryOperator op, const Value& first, const Value& second, Value& result)
+			{
+				T firstValue = UnboxValue<T>(first);
+				T secondValue = UnboxValue<T>(second);
+				switch (op)
+				{
+				case WfBinaryOperator::Exp: result = BoxValue<T>((T)exp(secondValue * log(firstValue))); return true;
+				case WfBinaryOperator::Add: result = BoxValue<T>(firstValue + secondValue); return true;
+				case WfBinaryOperator::Sub: result = BoxValue<T>(firstValue - secondValue); return true;
+				case WfBinaryOperator::Mul: result = BoxValue<T>(firstValue * secondValue); return true;
+				case WfBinaryOperator::Div: result = BoxValue<T>(firstValue / secondValue); return true;
+				default: return false;
+				}
+			}
+
+			template<typename T>
+			bool FoldIntegerUnaryConstant(WfUnaryOperator op, const Value& operand, Value& result)
+			{
+				T value = UnboxValue<T>(operand);
+				switch (op)
+				{
+				case WfUnaryOperator::Not: result = BoxValue<T>((T)~value); return true;
+				case WfUnaryOperator::Positive: result = BoxValue<T>((T)+value); return true;
+				case WfUnaryOperator::Negative: result = BoxValue<T>((T)-value); return true;
+				default: return false;
+				}
+			}
+
+			template<typename T>
+			bool FoldFloatUnaryConstant(WfUnaryOperator op, const Value& operand, Value& result)
+			{
+				T value = UnboxValue<T>(operand);
+				switch (op)
+				{
+				case WfUnaryOperator::Positive: result = BoxValue<T>(+value); return true;
+				case WfUnaryOperator::Negative: result = BoxValue<T>(-value); return true;
+				default: return false;
+				}
+			}
+
+			bool FoldUnaryConstant(TypeFlag flag, WfUnaryOperator op, const Value& operand, Value& result)
+			{
+				switch (flag)
+				{
+				case TypeFlag::Bool:
+					if (op == WfUnaryOperator::Not)
+					{
+						result = BoxValue(!UnboxValue<bool>(operand));
+						return true;
+					}
+					return false;
+#define FOLD_INTEGER(FLAG, TYPE) case TypeFlag::FLAG: return FoldIntegerUnaryConstant<TYPE>(op, operand, result);
+#define FOLD_FLOAT(FLAG, TYPE) case TypeFlag::FLAG: return FoldFloatUnaryConstant<TYPE>(op, operand, result);
+					FOLD_CONSTANT_INTEGER_TYPES(FOLD_INTEGER)
+					FOLD_CONSTANT_FLOAT_TYPES(FOLD_FLOAT)
+#undef FOLD_INTEGER
+#undef FOLD_FLOAT
+				default:
+					return false;
+				}
+			}
+
+			bool FoldBinaryConstant(TypeFlag flag, WfBinaryOperator op, const Value& first, const Value& second, Value& result)
+			{
+				switch (op)
+				{
+				case WfBinaryOperator::LT:
+				case WfBinaryOperator::GT:
+				case WfBinaryOperator::LE:
+				case WfBinaryOperator::GE:
+				case WfBinaryOperator::EQ:
+				case WfBinaryOperator::NE:
+					switch (flag)
+					{
+					case TypeFlag::Bool: return FoldCompareConstant<bool>(op, first, second, result);
+					case TypeFlag::String: return FoldCompareConstant<WString>(op, first, second, result);
+#define FOLD_COMPARE(FLAG, TYPE) case TypeFlag::FLAG: return FoldCompareConstant<TYPE>(op, first, second, result);
+						FOLD_CONSTANT_INTEGER_TYPES(FOLD_COMPARE)
+						FOLD_CONSTANT_FLOAT_TYPES(FOLD_COMPARE)
+#undef FOLD_COMPARE
+					default:
+						return false;
+					}
+				default:;
+				}
+
+				switch (flag)
+				{
+				case TypeFlag::Bool:
+					{
+						bool firstValue = UnboxValue<bool>(first);
+						bool secondValue = UnboxValue<bool>(second);
+						switch (op)
+						{
+						case WfBinaryOperator::Xor: result = BoxValue<bool>(firstValue ^ secondValue); return true;
+						case WfBinaryOperator::And: result = BoxValue<bool>(firstValue & secondValue); return true;
+						case WfBinaryOperator::Or: result = BoxValue<bool>(firstValue | secondValue); return true;
+						default: return false;
+						}
+					}
+#define FOLD_INTEGER(FLAG, TYPE) case TypeFlag::FLAG: return FoldIntegerConstant<TYPE>(op, first, second, result);
+#define FOLD_FLOAT(FLAG, TYPE) case TypeFlag::FLAG: return FoldFloatConstant<TYPE>(op, first, second, result);
+					FOLD_CONSTANT_INTEGER_TYPES(FOLD_INTEGER)
+					FOLD_CONSTANT_FLOAT_TYPES(FOLD_FLOAT)
+#undef FOLD_INTEGER
+#undef FOLD_FLOAT
+				default:
+					return false;
+				}
+			}
+
+#undef FOLD_CONSTANT_INTEGER_TYPES
+#undef FOLD_CONSTANT_FLOAT_TYPES
+
+/***********************************************************************
+ConvertConstantValue
+***********************************************************************/
+
+			bool ConvertConstantValue(const Value& value, ITypeInfo* type, Value& converted)
+			{
+				// the same as ConvertToType(Value::Text, type), only primitive types are supported
+				if (value.GetValueType() != Value::Text || type->GetDecorator() != ITypeInfo::TypeDescriptor)
+				{
+					return false;
+				}
+
+				auto td = type->GetTypeDescriptor();
+				if (GetTypeFlag(td) == TypeFlag::Others)
+				{
+					return false;
+				}
+
+				if (value.GetTypeDescriptor() == td)
+				{
+					converted = value;
+					return true;
+				}
+
+				auto serializer = td->GetValueSerializer();
+				return serializer && serializer->Parse(value.GetText(), converted);
+			}
+
+/***********************************************************************
+GetConstantValue
+***********************************************************************/
+
+			bool GetConstantValue(WfLexicalScopeManager* manager, Ptr<WfExpression> expression, Ptr<reflection::description::ITypeInfo> expectedType, reflection::description::Value& value)
+			{
+				vint index = manager->constantValues.Keys().IndexOf(expression.Obj());
+				if (index == -1)
+				{
+					return false;
+				}
+
+				value = manager->constantValues.Values()[index];
+				auto result = manager->expressionResolvings[expression.Obj()];
+				if (result.expectedType && !ConvertConstantValue(value, result.expectedType.Obj(), value))
+				{
+					return false;
+				}
+				if (expectedType && !ConvertConstantValue(value, expectedType.Obj(), value))
+				{
+					return false;
+				}
+				return true;
+			}
+
+/***********************************************************************
+FoldConstants(Declaration)
+***********************************************************************/
+
+			class FoldConstantsDeclarationVisitor : public Object, public WfDeclaration::IVisitor
+			{
+			public:
+				WfLexicalScopeManager*					manager;
+
+				FoldConstantsDeclarationVisitor(WfLexicalScopeManager* _manager)
+					:manager(_manager)
+				{
+				}
+
+				void Visit(WfNamespaceDeclaration* node)override
+				{
+					FOREACH(Ptr<WfDeclaration>, declaration, node->declarations)
+					{
+						FoldDeclarationConstants(manager, declaration);
+					}
+				}
+
+				void Visit(WfFunctionDeclaration* node)override
+				{
+					if (node->statement)
+					{
+						FoldStatementConstants(manager, node->statement);
+					}
+				}
+
+				void Visit(WfVariableDeclaration* node)override
+				{
+					FoldExpressionConstants(manager, node->expression);
+				}
+
+				static void Execute(WfLexicalScopeManager* manager, Ptr<WfDeclaration> declaration)
+				{
+					FoldConstantsDeclarationVisitor visitor(manager);
+					declaration->Accept(&visitor);
+				}
+			};
+
+/***********************************************************************
+FoldConstants(Statement)
+***********************************************************************/
+
+			class FoldConstantsStatementVisitor : public Object, public WfStatement::IVisitor
+			{
+			public:
+				WfLexicalScopeManager*					manager;
+
+				FoldConstantsStatementVisitor(WfLexicalScopeManager* _manager)
+					:manager(_manager)
+				{
+				}
+
+				void Visit(WfBreakStatement* node)override
+				{
+				}
+
+				void Visit(WfContinueStatement* node)override
+				{
+				}
+
+				void Visit(WfReturnStatement* node)override
+				{
+					if (node->expression)
+					{
+						FoldExpressionConstants(manager, node->expression);
+					}
+				}
+
+				void Visit(WfDeleteStatement* node)override
+				{
+					FoldExpressionConstants(manager, node->expression);
+				}
+
+				void Visit(WfRaiseExceptionStatement* node)override
+				{
+					if (node->expression)
+					{
+						FoldExpressionConstants(manager, node->expression);
+					}
+				}
+
+				void Visit(WfIfStatement* node)override
+				{
+					FoldExpressionConstants(manager, node->expression);
+					node->trueBranch->Accept(this);
+					if (node->falseBranch)
+					{
+						node->falseBranch->Accept(this);
+					}
+				}
+
+				void Visit(WfSwitchStatement* node)override
+				{
+					FoldExpressionConstants(manager, node->expression);
+					FOREACH(Ptr<WfSwitchCase>, switchCase, node->caseBranches)
+					{
+						FoldExpressionConstants(manager, switchCase->expression);
+						switchCase->statement->Accept(this);
+					}
+					if (node->defaultBranch)
+					{
+						node->defaultBranch->Accept(this);
+					}
+				}
+
+				void Visit(WfWhileStatement* node)override
+				{
+					FoldExpressionConstants(manager, node->condition);
+					node->statement->Accept(this);
+				}
+
+				void Visit(WfForEachStatement* node)override
+				{
+					FoldExpressionConstants(manager, node->collection);
+					node->statement->Accept(this);
+				}
+
+				void Visit(WfTryStatement* node)override
+				{
+					node->protectedStatement->Accept(this);
+					if (node->catchStatement)
+					{
+						node->catchStatement->Accept(this);
+					}
+					if (node->finallyStatement)
+					{
+						node->finallyStatement->Accept(this);
+					}
+				}
+
+				void Visit(WfBlockStatement* node)override
+				{
+					FOREACH(Ptr<WfStatement>, statement, node->statements)
+					{
+						statement->Accept(this);
+					}
+				}
+
+				void Visit(WfExpressionStatement* node)override
+				{
+					FoldExpressionConstants(manager, node->expression);
+				}
+
+				void Visit(WfVariableStatement* node)override
+				{
+					FoldDeclarationConstants(manager, node->variable);
+				}
+
+				static void Execute(WfLexicalScopeManager* manager, Ptr<WfStatement> statement)
+				{
+					FoldConstantsStatementVisitor visitor(manager);
+					statement->Accept(&visitor);
+				}
+			};
+
+/***********************************************************************
+FoldConstants(Expression)
+***********************************************************************/
+
+			class FoldConstantsExpressionVisitor : public Object, public WfExpression::IVisitor
+			{
+			public:
+				WfLexicalScopeManager*					manager;
+				ResolveExpressionResult					result;
+				bool									folded = false;
+				Value									value;
+
+				FoldConstantsExpressionVisitor(WfLexicalScopeManager* _manager, const ResolveExpressionResult& _result)
+					:manager(_manager)
+					, result(_result)
+				{
+				}
+
+				void Fold(const Value& _value)
+				{
+					if (result.type)
+					{
+						folded = true;
+						value = _value;
+					}
+				}
+
+				void Visit(WfTopQualifiedExpression* node)override
+				{
+				}
+
+				void Visit(WfReferenceExpression* node)override
+				{
+				}
+
+				void Visit(WfOrderedNameExpression* node)override
+				{
+				}
+
+				void Visit(WfOrderedLambdaExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->body);
+				}
+
+				void Visit(WfMemberExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->parent);
+				}
+
+				void Visit(WfChildExpression* node)override
+				{
+				}
+
+				void Visit(WfLiteralExpression* node)override
+				{
+					switch (node->value)
+					{
+					case WfLiteralValue::True:
+						Fold(BoxValue(true));
+						break;
+					case WfLiteralValue::False:
+						Fold(BoxValue(false));
+						break;
+					default:;
+					}
+				}
+
+				void Visit(WfFloatingExpression* node)override
+				{
+					Fold(BoxValue(wtof(node->value.value)));
+				}
+
+				void Visit(WfIntegerExpression* node)override
+				{
+					if (!result.type) return;
+					auto td = result.type->GetTypeDescriptor();
+					if (td == description::GetTypeDescriptor<vint32_t>())
+					{
+						Fold(BoxValue((vint32_t)wtoi(node->value.value)));
+					}
+					else if (td == description::GetTypeDescriptor<vint64_t>())
+					{
+						Fold(BoxValue((vint64_t)wtoi64(node->value.value)));
+					}
+					else if (td == description::GetTypeDescriptor<vuint64_t>())
+					{
+						Fold(BoxValue((vuint64_t)wtou64(node->value.value)));
+					}
+				}
+
+				void Visit(WfStringExpression* node)override
+				{
+					Fold(BoxValue(node->value.value));
+				}
+
+				void Visit(WfFormatExpression* node)override
+				{
+					if (node->expandedExpression)
+					{
+						FoldExpressionConstants(manager, node->expandedExpression);
+						Value constant;
+						if (GetConstantValue(manager, node->expandedExpression, result.type, constant))
+						{
+							Fold(constant);
+						}
+					}
+				}
+
+				void Visit(WfUnaryExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->operand);
+					Value operand, constant;
+					if (result.type && GetConstantValue(manager, node->operand, 0, operand))
+					{
+						auto operandResult = manager->expressionResolvings[node->operand.Obj()];
+						auto operandType = operandResult.expectedType ? operandResult.expectedType : operandResult.type;
+						auto flag = GetTypeFlag(operandType.Obj());
+						if (flag == GetTypeFlag(result.type.Obj()) && FoldUnaryConstant(flag, node->op, operand, constant))
+						{
+							Fold(constant);
+						}
+					}
+				}
+
+				void Visit(WfBinaryExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->first);
+					FoldExpressionConstants(manager, node->second);
+					if (!result.type) return;
+
+					Ptr<ITypeInfo> mergedType;
+					switch (node->op)
+					{
+					case WfBinaryOperator::Assign:
+					case WfBinaryOperator::Index:
+					case WfBinaryOperator::FailedThen:
+						return;
+					case WfBinaryOperator::Concat:
+						{
+							auto type = TypeInfoRetriver<WString>::CreateTypeInfo();
+							Value first, second;
+							if (GetConstantValue(manager, node->first, type, first) && GetConstantValue(manager, node->second, type, second))
+							{
+								Fold(BoxValue(UnboxValue<WString>(first) + UnboxValue<WString>(second)));
+							}
+						}
+						return;
+					case WfBinaryOperator::Exp:
+					case WfBinaryOperator::Add:
+					case WfBinaryOperator::Sub:
+					case WfBinaryOperator::Mul:
+					case WfBinaryOperator::Div:
+					case WfBinaryOperator::Mod:
+					case WfBinaryOperator::Shl:
+					case WfBinaryOperator::Shr:
+						mergedType = result.type;
+						break;
+					default:
+						{
+							auto firstResult = manager->expressionResolvings[node->first.Obj()];
+							auto secondResult = manager->expressionResolvings[node->second.Obj()];
+							auto firstType = firstResult.expectedType ? firstResult.expectedType : firstResult.type;
+							auto secondType = secondResult.expectedType ? secondResult.expectedType : secondResult.type;
+							if (!firstType || !secondType)
+							{
+								return;
+							}
+							mergedType = GetMergedType(firstType, secondType);
+						}
+					}
+
+					if (!mergedType || mergedType->GetDecorator() != ITypeInfo::TypeDescriptor)
+					{
+						return;
+					}
+
+					Value first, second, constant;
+					if (GetConstantValue(manager, node->first, mergedType, first) && GetConstantValue(manager, node->second, mergedType, second))
+					{
+						if (FoldBinaryConstant(GetTypeFlag(mergedType.Obj()), node->op, first, second, constant))
+						{
+							if (constant.GetTypeDescriptor() == result.type->GetTypeDescriptor())
+							{
+								Fold(constant);
+							}
+						}
+					}
+				}
+
+				void Visit(WfLetExpression* node)override
+				{
+					FOREACH(Ptr<WfLetVariable>, variable, node->variables)
+					{
+						FoldExpressionConstants(manager, variable->value);
+					}
+					FoldExpressionConstants(manager, node->expression);
+				}
+
+				void Visit(WfIfExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->condition);
+					FoldExpressionConstants(manager, node->trueBranch);
+					FoldExpressionConstants(manager, node->falseBranch);
+
+					Value condition, constant;
+					if (GetConstantValue(manager, node->condition, 0, condition))
+					{
+						auto branch = UnboxValue<bool>(condition) ? node->trueBranch : node->falseBranch;
+						if (GetConstantValue(manager, branch, result.type, constant))
+						{
+							Fold(constant);
+						}
+					}
+				}
+
+				void Visit(WfRangeExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->begin);
+					FoldExpressionConstants(manager, node->end);
+				}
+
+				void Visit(WfSetTestingExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->element);
+					FoldExpressionConstants(manager, node->collection);
+				}
+
+				void Visit(WfConstructorExpression* node)override
+				{
+					FOREACH(Ptr<WfConstructorArgument>, argument, node->arguments)
+					{
+						FoldExpressionConstants(manager, argument->key);
+						if (argument->value)
+						{
+							FoldExpressionConstants(manager, argument->value);
+						}
+					}
+				}
+
+				void Visit(WfInferExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->expression);
+					Value constant;
+					if (GetConstantValue(manager, node->expression, result.type, constant))
+					{
+						Fold(constant);
+					}
+				}
+
+				void Visit(WfTypeCastingExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->expression);
+					Value constant;
+					if (node->strategy == WfTypeCastingStrategy::Strong && GetConstantValue(manager, node->expression, result.type, constant))
+					{
+						Fold(constant);
+					}
+				}
+
+				void Visit(WfTypeTestingExpression* node)override
+				{
+					if (node->expression)
+					{
+						FoldExpressionConstants(manager, node->expression);
+					}
+				}
+
+				void Visit(WfTypeOfTypeExpression* node)override
+				{
+				}
+
+				void Visit(WfTypeOfExpressionExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->expression);
+				}
+
+				void Visit(WfAttachEventExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->event);
+					FoldExpressionConstants(manager, node->function);
+				}
+
+				void Visit(WfDetachEventExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->handler);
+				}
+
+				void Visit(WfBindExpression* node)override
+				{
+					if (node->expandedExpression)
+					{
+						FoldExpressionConstants(manager, node->expandedExpression);
+					}
+				}
+
+				void Visit(WfObserveExpression* node)override
+				{
+					// observe expressions only appear in bind expressions, which are generated from the expanded expression
+				}
+
+				void Visit(WfCallExpression* node)override
+				{
+					FoldExpressionConstants(manager, node->function);
+					FOREACH(Ptr<WfExpression>, argument, node->arguments)
+					{
+						FoldExpressionConstants(manager, argument);
+					}
+				}
+
+				void Visit(WfFunctionExpression* node)override
+				{
+					FoldDeclarationConstants(manager, node->function);
+				}
+
+				void Visit(WfNewTypeExpression* node)override
+				{
+					FOREACH(Ptr<WfExpression>, argument, node->arguments)
+					{
+						FoldExpressionConstants(manager, argument);
+					}
+
+					FOREACH(Ptr<WfFunctionDeclaration>, function, node->functions)
+					{
+						FoldDeclarationConstants(manager, function);
+					}
+				}
+
+				static void Execute(WfLexicalScopeManager* manager, Ptr<WfExpression> expression)
+				{
+					if (manager->constantValues.Keys().Contains(expression.Obj()))
+					{
+						return;
+					}
+
+					ResolveExpressionResult result;
+					vint index = manager->expressionResolvings.Keys().IndexOf(expression.Obj());
+					if (index != -1)
+					{
+						result = manager->expressionResolvings.Values()[index];
+					}
+
+					FoldConstantsExpressionVisitor visitor(manager, result);
+					expression->Accept(&visitor);
+					if (visitor.folded)
+					{
+						manager->constantValues.Add(expression, visitor.value);
+					}
+				}
+			};
+
+/***********************************************************************
+FoldConstants
+***********************************************************************/
+
+			void FoldModuleConstants(WfLexicalScopeManager* manager, Ptr<WfModule> module)
+			{
+				FOREACH(Ptr<WfDeclaration>, declaration, module->declarations)
+				{
+					FoldDeclarationConstants(manager, declaration);
+				}
+			}
+
+			void FoldDeclarationConstants(WfLexicalScopeManager* manager, Ptr<WfDeclaration> declaration)
+			{
+				FoldConstantsDeclarationVisitor::Execute(manager, declaration);
+			}
+
+			void FoldStatementConstants(WfLexicalScopeManager* manager, Ptr<WfStatement> statement)
+			{
+				FoldConstantsStatementVisitor::Execute(manager, statement);
+			}
+
+			void FoldExpressionConstants(WfLexicalScopeManager* manager, Ptr<WfExpression> expression)
+			{
+				FoldConstantsExpressionVisitor::Execute(manager, expression);
+			}
+		}
+	}
+}
@@ -114,40 +114,97 @@ GenerateTypeCastInstructions
 				return WfInsType::Unknown;
 			}
 
+/***********************************************************************
+CollectEscapedSymbols
+***********************************************************************/
+
+			void CollectEscapedSymbols(WfCodegenContext& context)
+			{
+				auto manager = context.manager;
+				SortedList<WfExpression*> calledExpressions;
+				FOREACH(Ptr<WfExpression>, expression, manager->expressionResolvings.Keys())
+				{
+					if (auto call = expression.Cast<WfCallExpression>())
+					{
+						calledExpressions.Add(call->function.Obj());
+					}
+				}
+
+				auto addSymbol = [&](WfLexicalSymbol* symbol)
+				{
+					if (!context.escapedSymbols.Contains(symbol))
+					{
+						context.escapedSymbols.Add(symbol);
+					}
+				};
+
+				FOREACH_INDEXER(Ptr<WfExpression>, expression, index, manager->expressionResolvings.Keys())
+				{
+					auto symbol = manager->expressionResolvings.Values()[index].symbol;
+					if (symbol && !calledExpressions.Contains(expression.Obj()))
+					{
+						addSymbol(symbol.Obj());
+					}
+				}
+
+				// a captured symbol is called from another stack frame
+				for (vint i = 0; i < manager->functionLambdaCaptures.Count(); i++)
+				{
+					FOREACH(Ptr<WfLexicalSymbol>, symbol, manager->functionLambdaCaptures.GetByIndex(i))
+					{
+						addSymbol(symbol.Obj());
+					}
+				}
+				for (vint i = 0; i < manager->orderedLambdaCaptures.Count(); i++)
+				{
+					FOREACH(Ptr<WfLexicalSymbol>, symbol, manager->orderedLambdaCaptures.GetByIndex(i))
+					{
+						addSymbol(symbol.Obj());
+					}
+				}
+			}
+
 /***********************************************************************
 GenerateAssembly
 ***********************************************************************/
 
-			Ptr<runtime::WfAssembly> GenerateAssembly(WfLexicalScopeManager* manager)
+			Ptr<runtime::WfAssembly> GenerateAssembly(WfLexicalScopeManager* manager, const WfCodegenOptions& options)
 			{
 				auto assembly = MakePtr<WfAssembly>();
 				assembly->insBeforeCodegen = new WfInstructionDebugInfo;
-				assembly->insAfterCodegen = new WfInstructionDebugInfo;
+				if (options.debugInfoAfterCodegen)
+				{
+					assembly->insAfterCodegen = new WfInstructionDebugInfo;
+				}
 				
 				WfCodegenContext context(assembly, manager);
+				context.inlineFunctions = options.inlineFunctions;
+				context.hashMaps = options.hashMaps;
 				FOREACH_INDEXER(Ptr<WfModule>, module, index, manager->GetModules())
 				{
 					auto codeBeforeCodegen = manager->GetModuleCodes()[index];
-
-					auto recorderBefore = new ParsingGeneratedLocationRecorder(context.nodePositionsBeforeCodegen);
-					auto recorderAfter = new ParsingGeneratedLocationRecorder(context.nodePositionsAfterCodegen);
-					auto recorderOriginal = new ParsingOriginalLocationRecorder(recorderBefore);
-					auto recorderMultiple = new ParsingMultiplePrintNodeRecorder;
-					recorderMultiple->AddRecorder(recorderOriginal);
-					recorderMultiple->AddRecorder(recorderAfter);
-
-					stream::MemoryStream memoryStream;
+					assembly->insBeforeCodegen->moduleCodes.Add(options.embedModuleCodes ? codeBeforeCodegen : WString::Empty);
+					// positions before codegen are read from syntax trees if generated syntax trees are not printed
+					if (options.debugInfoAfterCodegen)
 					{
-						stream::StreamWriter streamWriter(memoryStream);
-						ParsingWriter parsingWriter(streamWriter, recorderMultiple, index);
-						WfPrint(module, L"", parsingWriter);
-					}
+						auto recorderBefore = new ParsingGeneratedLocationRecorder(context.nodePositionsBeforeCodegen);
+						auto recorderAfter = new ParsingGeneratedLocationRecorder(context.nodePositionsAfterCodegen);
+						auto recorderOriginal = new ParsingOriginalLocationRecorder(recorderBefore);
+						auto recorderMultiple = new ParsingMultiplePrintNodeRecorder;
+						recorderMultiple->AddRecorder(recorderOriginal);
+						recorderMultiple->AddRecorder(recorderAfter);
 
-					memoryStream.SeekFromBegin(0);
-					auto codeAfterCodegen = stream::StreamReader(memoryStream).ReadToEnd();
+						stream::MemoryStream memoryStream;
+						{
+							stream::StreamWriter streamWriter(memoryStream);
+							ParsingWriter parsingWriter(streamWriter, recorderMultiple, index);
+							WfPrint(module, L"", parsingWriter);
+						}
 
-					assembly->insBeforeCodegen->moduleCodes.Add(codeBeforeCodegen);
-					assembly->insAfterCodegen->moduleCodes.Add(codeAfterCodegen);
+						memoryStream.SeekFromBegin(0);
+						auto codeAfterCodegen = stream::StreamReader(memoryStream).ReadToEnd();
+						assembly->insAfterCodegen->moduleCodes.Add(options.embedModuleCodes ? codeAfterCodegen : WString::Empty);
+					}
 				}
 
 				FOREACH(Ptr<WfModule>, module, manager->GetModules())
@@ -157,6 +214,7 @@ GenerateAssembly
 						GenerateGlobalDeclarationMetadata(context, decl);
 					}
 				}
+				CollectEscapedSymbols(context);
 
 				{
 					auto meta = MakePtr<WfAssemblyFunction>();
@@ -196,6 +254,11 @@ GenerateAssembly
 					}
 				}
 
+				if (options.optimizeInstructions)
+				{
+					OptimizeInstructions(assembly);
+				}
+				GenerateSuperInstructions(assembly);
 				assembly->Initialize();
 				return assembly;
 			}
@@ -206,7 +269,7 @@ GenerateAssembly
 Compile
 ***********************************************************************/
 
-			Ptr<runtime::WfAssembly> Compile(Ptr<parsing::tabling::ParsingTable> table, WfLexicalScopeManager* manager, collections::List<WString>& moduleCodes, collections::List<Ptr<parsing::ParsingError>>& errors)
+			Ptr<runtime::WfAssembly> Compile(Ptr<parsing::tabling::ParsingTable> table, WfLexicalScopeManager* manager, collections::List<WString>& moduleCodes, collections::List<Ptr<parsing::ParsingError>>& errors, const WfCodegenOptions& options)
 			{
 				manager->Clear(true, true);
 				FOREACH(WString, code, moduleCodes)
@@ -227,13 +290,13 @@ Compile
 					return 0;
 				}
 
-				return GenerateAssembly(manager);
+				return GenerateAssembly(manager, options);
 			}
 
-			Ptr<runtime::WfAssembly> Compile(Ptr<parsing::tabling::ParsingTable> table, collections::List<WString>& moduleCodes, collections::List<Ptr<parsing::ParsingError>>& errors)
+			Ptr<runtime::WfAssembly> Compile(Ptr<parsing::tabling::ParsingTable> table, collections::List<WString>& moduleCodes, collections::List<Ptr<parsing::ParsingError>>& errors, const WfCodegenOptions& options)
 			{
 				WfLexicalScopeManager manager(table);
-				return Compile(table, &manager, moduleCodes, errors);
+				return Compile(table, &manager, moduleCodes, errors, options);
 			}
 		}
 	}
@@ -21,20 +21,34 @@ namespace vl
 GenerateGlobalDeclarationMetadata
 ***********************************************************************/
 
-			void GenerateFunctionDeclarationMetadata(WfCodegenContext& context, WfFunctionDeclaration* node, Ptr<WfAssemblyFunction> meta)
+			void GetFunctionDeclarationCaptures(WfCodegenContext& context, WfFunctionDeclaration* node, Ptr<List<Ptr<WfLexicalSymbol>>> interfaceCaptures, List<Ptr<WfLexicalSymbol>>& symbols)
+			{
+				if (interfaceCaptures)
+				{
+					CopyFrom(symbols, *interfaceCaptures.Obj(), true);
+					return;
+				}
+
+				vint index = context.manager->functionLambdaCaptures.Keys().IndexOf(node);
+				if (index != -1)
+				{
+					CopyFrom(symbols, context.manager->functionLambdaCaptures.GetByIndex(index), true);
+				}
+			}
+
+			void GenerateFunctionDeclarationMetadata(WfCodegenContext& context, WfFunctionDeclaration* node, Ptr<WfAssemblyFunction> meta, bool capturesAsArguments = false, Ptr<List<Ptr<WfLexicalSymbol>>> interfaceCaptures = nullptr)
 			{
 				FOREACH(Ptr<WfFunctionArgument>, argument, node->arguments)
 				{
 					meta->argumentNames.Add(argument->name.value);
 				}
 				{
-					vint index = context.manager->functionLambdaCaptures.Keys().IndexOf(node);
-					if (index != -1)
+					List<Ptr<WfLexicalSymbol>> symbols;
+					GetFunctionDeclarationCaptures(context, node, interfaceCaptures, symbols);
+					auto& names = capturesAsArguments ? meta->argumentNames : meta->capturedVariableNames;
+					FOREACH(Ptr<WfLexicalSymbol>, symbol, symbols)
 					{
-						FOREACH(Ptr<WfLexicalSymbol>, symbol, context.manager->functionLambdaCaptures.GetByIndex(index))
-						{
-							meta->capturedVariableNames.Add(L"<captured>" + symbol->name);
-						}
+						names.Add(L"<captured>" + symbol->name);
 					}
 				}
 			}
@@ -206,7 +220,7 @@ GenerateInstructions(Declaration)
 				GenerateFunctionInstructions_Epilog(context, scope, meta, returnType, recursiveLambdaSymbol, argumentSymbols, capturedSymbols, functionContext, node);
 			}
 
-			void GenerateFunctionDeclarationInstructions(WfCodegenContext& context, WfFunctionDeclaration* node, WfLexicalScope* scope, Ptr<WfAssemblyFunction> meta, Ptr<WfLexicalSymbol> recursiveLambdaSymbol)
+			void GenerateFunctionDeclarationInstructions(WfCodegenContext& context, WfFunctionDeclaration* node, WfLexicalScope* scope, Ptr<WfAssemblyFunction> meta, Ptr<WfLexicalSymbol> recursiveLambdaSymbol, bool capturesAsArguments = false, Ptr<List<Ptr<WfLexicalSymbol>>> interfaceCaptures = nullptr)
 			{
 				List<Ptr<WfLexicalSymbol>> argumentSymbols, capturedSymbols;
 				{
@@ -216,14 +230,7 @@ GenerateInstructions(Declaration)
 						argumentSymbols.Add(symbol);
 					}
 
-					vint index = context.manager->functionLambdaCaptures.Keys().IndexOf(node);
-					if (index != -1)
-					{
-						FOREACH(Ptr<WfLexicalSymbol>, symbol, context.manager->functionLambdaCaptures.GetByIndex(index))
-						{
-							capturedSymbols.Add(symbol);
-						}
-					}
+					GetFunctionDeclarationCaptures(context, node, interfaceCaptures, capturesAsArguments ? argumentSymbols : capturedSymbols);
 				}
 
 				auto returnType = CreateTypeInfoFromType(scope, node->returnType);
@@ -317,20 +324,20 @@ GenerateInstructions(Closure)
 				meta->lastInstruction = context.assembly->instructions.Count() - 1;
 			}
 
-			void GenerateClosureInstructions_Function(WfCodegenContext& context, vint functionIndex, WfFunctionDeclaration* node, bool createInterface)
+			void GenerateClosureInstructions_Function(WfCodegenContext& context, vint functionIndex, WfFunctionDeclaration* node, bool createInterface, bool capturesAsArguments, Ptr<List<Ptr<WfLexicalSymbol>>> interfaceCaptures = nullptr)
 			{
 				auto scope = context.manager->declarationScopes[node].Obj();
 				auto meta = context.assembly->functions[functionIndex];
-				GenerateFunctionDeclarationMetadata(context, node, meta);
+				GenerateFunctionDeclarationMetadata(context, node, meta, capturesAsArguments, interfaceCaptures);
 				Ptr<WfLexicalSymbol> recursiveLambdaSymbol;
 				if (!createInterface && node->name.value != L"")
 				{
 					recursiveLambdaSymbol = scope->symbols[node->name.value][0];
 				}
-				GenerateFunctionDeclarationInstructions(context, node, scope, meta, recursiveLambdaSymbol);
+				GenerateFunctionDeclarationInstructions(context, node, scope, meta, recursiveLambdaSymbol, capturesAsArguments, interfaceCaptures);
 			}
 
-			void GenerateClosureInstructions_Ordered(WfCodegenContext& context, vint functionIndex, WfOrderedLambdaExpression* node)
+			void GenerateClosureInstructions_Ordered(WfCodegenContext& context, vint functionIndex, WfOrderedLambdaExpression* node, bool capturesAsArguments)
 			{
 				auto scope = context.manager->expressionScopes[node].Obj();
 				List<Ptr<WfLexicalSymbol>> argumentSymbols, capturedSymbols;
@@ -355,10 +362,12 @@ GenerateInstructions(Closure)
 					vint index = context.manager->orderedLambdaCaptures.Keys().IndexOf(node);
 					if (index != -1)
 					{
+						auto& names = capturesAsArguments ? meta->argumentNames : meta->capturedVariableNames;
+						auto& symbols = capturesAsArguments ? argumentSymbols : capturedSymbols;
 						FOREACH(Ptr<WfLexicalSymbol>, symbol, context.manager->orderedLambdaCaptures.GetByIndex(index))
 						{
-							meta->capturedVariableNames.Add(L"<captured>" + symbol->name);
-							capturedSymbols.Add(symbol);
+							names.Add(L"<captured>" + symbol->name);
+							symbols.Add(symbol);
 						}
 					}
 				}
@@ -385,15 +394,15 @@ GenerateInstructions(Closure)
 					}
 					else if (closure.functionExpression)
 					{
-						GenerateClosureInstructions_Function(context, functionIndex, closure.functionExpression->function.Obj(), false);
+						GenerateClosureInstructions_Function(context, functionIndex, closure.functionExpression->function.Obj(), false, closure.capturesAsArguments);
 					}
 					else if (closure.orderedLambdaExpression)
 					{
-						GenerateClosureInstructions_Ordered(context, functionIndex, closure.orderedLambdaExpression);
+						GenerateClosureInstructions_Ordered(context, functionIndex, closure.orderedLambdaExpression, closure.capturesAsArguments);
 					}
 					else if (closure.functionDeclaration)
 					{
-						GenerateClosureInstructions_Function(context, functionIndex, closure.functionDeclaration, true);
+						GenerateClosureInstructions_Function(context, functionIndex, closure.functionDeclaration, true, false, closure.interfaceCaptures);
 					}
 				}
 			}
@@ -101,16 +101,24 @@ GenerateInstructions(Expression)
 					VisitReferenceExpression(node);
 				}
 
-				void Visit(WfOrderedLambdaExpression* node)override
+				WString GetOrderedLambdaName(vint index)
 				{
-					auto meta = MakePtr<WfAssemblyFunction>();
-					vint functionIndex = context.assembly->functions.Add(meta);
-					meta->name = L"<lambda:(" + itow(functionIndex) + L")> in " + context.functionContext->function->name;
-					context.assembly->functionByName.Add(meta->name, functionIndex);
+					return L"<lambda:(" + itow(index) + L")> in " + context.functionContext->function->name;
+				}
 
+				WString GetFunctionLambdaName(WfFunctionDeclaration* node, vint index)
+				{
+					return L"<lambda:" + node->name.value + L"(" + itow(index) + L")> in " + context.functionContext->function->name;
+				}
+
+				void Visit(WfOrderedLambdaExpression* node)override
+				{
 					WfCodegenLambdaContext lc;
 					lc.orderedLambdaExpression = node;
-					context.functionContext->closuresToCodegen.Add(functionIndex, lc);
+					vint functionIndex = AddClosureFunction(lc, [=](vint index)
+					{
+						return GetOrderedLambdaName(index);
+					});
 
 					vint index = context.manager->orderedLambdaCaptures.Keys().IndexOf(node);
 					if (index != -1)
@@ -213,6 +221,33 @@ GenerateInstructions(Expression)
 					GenerateExpressionInstructions(context, node->expandedExpression);
 				}
 
+				void CollectConcatOperands(Ptr<WfExpression> expression, List<Ptr<WfExpression>>& operands)
+				{
+					// a chain of string concatenations is built into one string, except for the parts that are already constants
+					if (!context.manager->constantValues.Keys().Contains(expression.Obj()))
+					{
+						auto result = context.manager->expressionResolvings[expression.Obj()];
+						if (!result.expectedType || IsSameType(result.type.Obj(), result.expectedType.Obj()))
+						{
+							if (auto format = expression.Cast<WfFormatExpression>())
+							{
+								CollectConcatOperands(format->expandedExpression, operands);
+								return;
+							}
+							else if (auto binary = expression.Cast<WfBinaryExpression>())
+							{
+								if (binary->op == WfBinaryOperator::Concat)
+								{
+									CollectConcatOperands(binary->first, operands);
+									CollectConcatOperands(binary->second, operands);
+									return;
+								}
+							}
+						}
+					}
+					operands.Add(expression);
+				}
+
 				void Visit(WfUnaryExpression* node)override
 				{
 					auto type = GenerateExpressionInstructions(context, node->operand);
@@ -285,10 +320,23 @@ GenerateInstructions(Expression)
 					}
 					else if (node->op == WfBinaryOperator::Concat)
 					{
+						List<Ptr<WfExpression>> operands;
+						CollectConcatOperands(node->first, operands);
+						CollectConcatOperands(node->second, operands);
+
 						auto type = TypeInfoRetriver<WString>::CreateTypeInfo();
-						GenerateExpressionInstructions(context, node->first, type);
-						GenerateExpressionInstructions(context, node->second, type);
-						INSTRUCTION(Ins::OpConcat());
+						FOREACH(Ptr<WfExpression>, operand, operands)
+						{
+							GenerateExpressionInstructions(context, operand, type);
+						}
+						if (operands.Count() == 2)
+						{
+							INSTRUCTION(Ins::OpConcat());
+						}
+						else
+						{
+							INSTRUCTION(Ins::ConcatN(operands.Count()));
+						}
 					}
 					else if (node->op == WfBinaryOperator::FailedThen)
 					{
@@ -452,7 +500,7 @@ GenerateInstructions(Expression)
 					{
 						auto symbol = scope->symbols[var->name.value][0];
 						vint variableIndex = function->argumentNames.Count() + function->localVariableNames.Add(L"<let>" + var->name.value);
-						context.functionContext->localVariables.Add(symbol.Obj(), variableIndex);
+						context.functionContext->localVariables.Set(symbol.Obj(), variableIndex);
 						variableIndices[index] = variableIndex;
 
 						GenerateExpressionInstructions(context, var->value);
@@ -469,6 +517,13 @@ GenerateInstructions(Expression)
 				void Visit(WfIfExpression* node)override
 				{
 					auto result = context.manager->expressionResolvings[node];
+					Value condition;
+					if (GetConstantValue(context.manager, node->condition, 0, condition))
+					{
+						GenerateExpressionInstructions(context, UnboxValue<bool>(condition) ? node->trueBranch : node->falseBranch, result.type);
+						return;
+					}
+
 					GenerateExpressionInstructions(context, node->condition);
 					vint fillTrueIndex = INSTRUCTION(Ins::JumpIf(-1));
 					GenerateExpressionInstructions(context, node->falseBranch, result.type);
@@ -484,26 +539,56 @@ GenerateInstructions(Expression)
 					auto elementType = result.type->GetElementType()->GetGenericArgument(0);
 					auto type = GetInstructionTypeArgument(elementType);
 					
-					GenerateExpressionInstructions(context, node->begin, elementType);
-					if (node->beginBoundary == WfRangeBoundary::Exclusive)
+					GenerateRangeBoundaryInstructions(context, node->begin, node->beginBoundary, true, elementType, node);
+					GenerateRangeBoundaryInstructions(context, node->end, node->endBoundary, false, elementType, node);
+
+					INSTRUCTION(Ins::CreateRange(type));
+				}
+
+				Ptr<WfConstantSet> GetConstantSet(WfSetTestingExpression* node)
+				{
+					auto constructor = node->collection.Cast<WfConstructorExpression>();
+					if (!constructor || constructor->arguments.Count() == 0) return nullptr;
+
+					auto elementResult = context.manager->expressionResolvings[node->element.Obj()];
+					auto elementType = elementResult.expectedType ? elementResult.expectedType : elementResult.type;
+					if (elementType->GetDecorator() != ITypeInfo::TypeDescriptor) return nullptr;
+					auto type = GetInstructionTypeArgument(elementType);
+					switch (type)
 					{
-						INSTRUCTION(Ins::LoadValue(BoxValue<vint>(1)));
-						INSTRUCTION(Ins::OpAdd(type));
+					case WfInsType::Bool:
+					case WfInsType::F4:
+					case WfInsType::F8:
+					case WfInsType::Unknown:
+						return nullptr;
+					default:;
 					}
-					
-					GenerateExpressionInstructions(context, node->end, elementType);
-					if (node->endBoundary == WfRangeBoundary::Exclusive)
+
+					auto set = MakePtr<WfConstantSet>();
+					set->type = type;
+					FOREACH(Ptr<WfConstructorArgument>, argument, constructor->arguments)
 					{
-						INSTRUCTION(Ins::LoadValue(BoxValue<vint>(1)));
-						INSTRUCTION(Ins::OpSub(type));
+						if (argument->value) return nullptr;
+						auto keyResult = context.manager->expressionResolvings[argument->key.Obj()];
+						auto keyType = keyResult.expectedType ? keyResult.expectedType : keyResult.type;
+						if (!IsSameType(elementType.Obj(), GetMergedType(elementType, keyType).Obj())) return nullptr;
+
+						Value key;
+						if (!GetConstantValue(context.manager, argument->key, elementType, key)) return nullptr;
+						set->keys.Add(key);
 					}
-
-					INSTRUCTION(Ins::CreateRange(type));
+					return set;
 				}
 
 				void Visit(WfSetTestingExpression* node)override
 				{
-					if (auto range = node->collection.Cast<WfRangeExpression>())
+					if (auto set = GetConstantSet(node))
+					{
+						vint setIndex = context.assembly->constantSets.Add(set);
+						GenerateExpressionInstructions(context, node->element);
+						INSTRUCTION(Ins::TestElementInConstantSet(setIndex));
+					}
+					else if (auto range = node->collection.Cast<WfRangeExpression>())
 					{
 						auto resultElement = context.manager->expressionResolvings[node->element.Obj()];
 						auto resultBegin = context.manager->expressionResolvings[range->begin.Obj()];
@@ -600,7 +685,14 @@ GenerateInstructions(Expression)
 							GenerateExpressionInstructions(context, argument->key, keyType);
 							GenerateExpressionInstructions(context, argument->value, valueType);
 						}
-						INSTRUCTION(Ins::CreateMap(node->arguments.Count() * 2));
+						if (context.hashMaps)
+						{
+							INSTRUCTION(Ins::CreateHashMap(node->arguments.Count() * 2));
+						}
+						else
+						{
+							INSTRUCTION(Ins::CreateMap(node->arguments.Count() * 2));
+						}
 					}
 				}
 
@@ -698,6 +790,52 @@ GenerateInstructions(Expression)
 				{
 				}
 
+				static const vint MaxInliningDepth = 3;
+
+				bool VisitInlineFunction(WfCallExpression* node, WfLexicalSymbol* symbol, vint functionIndex)
+				{
+					if (!context.inlineFunctions) return false;
+					if (context.inliningFunctions.Count() >= MaxInliningDepth) return false;
+					if (context.inliningFunctions.Contains(functionIndex)) return false;
+					if (context.assembly->functions[functionIndex] == context.functionContext->function) return false;
+
+					auto decl = symbol->creatorDeclaration.Cast<WfFunctionDeclaration>();
+					if (!decl) return false;
+					auto block = decl->statement.Cast<WfBlockStatement>();
+					if (!block || block->statements.Count() != 1) return false;
+					auto returnStatement = block->statements[0].Cast<WfReturnStatement>();
+					if (!returnStatement || !returnStatement->expression) return false;
+
+					// arguments are on the stack, they are stored to local variables of the caller in reverse order
+					auto scope = context.manager->declarationScopes[decl.Obj()];
+					auto function = context.functionContext->function;
+					List<vint> variableIndices;
+					FOREACH(Ptr<WfFunctionArgument>, argument, decl->arguments)
+					{
+						auto argumentSymbol = scope->symbols[argument->name.value][0];
+						vint variableIndex = function->argumentNames.Count() + function->localVariableNames.Add(L"<inline>" + decl->name.value + L"." + argument->name.value);
+						context.functionContext->localVariables.Set(argumentSymbol.Obj(), variableIndex);
+						variableIndices.Add(variableIndex);
+					}
+					for (vint i = variableIndices.Count() - 1; i >= 0; i--)
+					{
+						INSTRUCTION(Ins::StoreLocalVar(variableIndices[i]));
+					}
+
+					// instructions of the inlined expression are mapped to the callee
+					context.inliningFunctions.Add(functionIndex);
+					GenerateExpressionInstructions(context, returnStatement->expression);
+					context.inliningFunctions.RemoveAt(context.inliningFunctions.Count() - 1);
+
+					// release arguments like a returned stack frame
+					FOREACH(vint, variableIndex, variableIndices)
+					{
+						INSTRUCTION(Ins::LoadValue(Value()));
+						INSTRUCTION(Ins::StoreLocalVar(variableIndex));
+					}
+					return true;
+				}
+
 				void Visit(WfCallExpression* node)override
 				{
 					FOREACH(Ptr<WfExpression>, argument, node->arguments)
@@ -727,7 +865,22 @@ GenerateInstructions(Expression)
 						if (index != -1)
 						{
 							vint functionIndex = context.globalFunctions.Values()[index];
-							INSTRUCTION(Ins::Invoke(functionIndex, node->arguments.Count()));
+							if (!VisitInlineFunction(node, result.symbol.Obj(), functionIndex))
+							{
+								INSTRUCTION(Ins::Invoke(functionIndex, node->arguments.Count()));
+							}
+							return;
+						}
+
+						index = context.functionContext->liftedClosures.Keys().IndexOf(result.symbol.Obj());
+						if (index != -1)
+						{
+							auto closure = context.functionContext->liftedClosures.Values()[index];
+							for (vint i = 0; i < closure.capturedVariableCount; i++)
+							{
+								INSTRUCTION(Ins::LoadLocalVar(closure.firstCapturedVariable + i));
+							}
+							INSTRUCTION(Ins::Invoke(closure.functionIndex, node->arguments.Count() + closure.capturedVariableCount));
 							return;
 						}
 					}
@@ -736,7 +889,7 @@ GenerateInstructions(Expression)
 					INSTRUCTION(Ins::InvokeProxy(node->arguments.Count()));
 				}
 
-				void VisitFunction(WfFunctionDeclaration* node, WfCodegenLambdaContext lc, const Func<WString(vint)>& getName)
+				vint AddClosureFunction(WfCodegenLambdaContext lc, const Func<WString(vint)>& getName)
 				{
 					auto meta = MakePtr<WfAssemblyFunction>();
 					vint functionIndex = context.assembly->functions.Add(meta);
@@ -744,6 +897,12 @@ GenerateInstructions(Expression)
 					context.assembly->functionByName.Add(meta->name, functionIndex);
 
 					context.functionContext->closuresToCodegen.Add(functionIndex, lc);
+					return functionIndex;
+				}
+
+				void VisitFunction(WfFunctionDeclaration* node, WfCodegenLambdaContext lc, const Func<WString(vint)>& getName)
+				{
+					vint functionIndex = AddClosureFunction(lc, getName);
 
 					vint index = context.manager->functionLambdaCaptures.Keys().IndexOf(node);
 					if (index != -1)
@@ -767,10 +926,82 @@ GenerateInstructions(Expression)
 					lc.functionExpression = node;
 					VisitFunction(node->function.Obj(), lc, [=](vint index)
 					{
-						return L"<lambda:" + node->function->name.value + L"(" + itow(index) + L")> in " + context.functionContext->function->name;
+						return GetFunctionLambdaName(node->function.Obj(), index);
 					});
 				}
 
+				bool VisitLiftedClosure(WfLexicalSymbol* symbol, WfExpression* node)
+				{
+					if (context.escapedSymbols.Contains(symbol))
+					{
+						return false;
+					}
+					auto result = context.manager->expressionResolvings[node];
+					if (result.expectedType && !IsSameType(result.type.Obj(), result.expectedType.Obj()))
+					{
+						return false;
+					}
+
+					WfCodegenLambdaContext lc;
+					lc.capturesAsArguments = true;
+					vint functionIndex = -1;
+					List<Ptr<WfLexicalSymbol>> capturedSymbols;
+					if (auto orderedLambda = dynamic_cast<WfOrderedLambdaExpression*>(node))
+					{
+						lc.orderedLambdaExpression = orderedLambda;
+						functionIndex = AddClosureFunction(lc, [=](vint index)
+						{
+							return GetOrderedLambdaName(index);
+						});
+
+						vint index = context.manager->orderedLambdaCaptures.Keys().IndexOf(orderedLambda);
+						if (index != -1)
+						{
+							CopyFrom(capturedSymbols, context.manager->orderedLambdaCaptures.GetByIndex(index));
+						}
+					}
+					else if (auto functionExpression = dynamic_cast<WfFunctionExpression*>(node))
+					{
+						// a named lambda creates a closure of itself
+						auto function = functionExpression->function.Obj();
+						if (function->name.value != L"")
+						{
+							return false;
+						}
+
+						lc.functionExpression = functionExpression;
+						functionIndex = AddClosureFunction(lc, [=](vint index)
+						{
+							return GetFunctionLambdaName(function, index);
+						});
+
+						vint index = context.manager->functionLambdaCaptures.Keys().IndexOf(function);
+						if (index != -1)
+						{
+							CopyFrom(capturedSymbols, context.manager->functionLambdaCaptures.GetByIndex(index));
+						}
+					}
+					else
+					{
+						return false;
+					}
+
+					// captured values are copied to local variables, which are released with the stack frame
+					auto function = context.functionContext->function;
+					WfCodegenLiftedClosure closure;
+					closure.functionIndex = functionIndex;
+					closure.firstCapturedVariable = function->argumentNames.Count() + function->localVariableNames.Count();
+					closure.capturedVariableCount = capturedSymbols.Count();
+					FOREACH(Ptr<WfLexicalSymbol>, capturedSymbol, capturedSymbols)
+					{
+						vint variableIndex = function->argumentNames.Count() + function->localVariableNames.Add(L"<captured>" + capturedSymbol->name);
+						GenerateLoadSymbolInstructions(capturedSymbol.Obj(), node);
+						INSTRUCTION(Ins::StoreLocalVar(variableIndex));
+					}
+					context.functionContext->liftedClosures.Add(symbol, closure);
+					return true;
+				}
+
 				void Visit(WfNewTypeExpression* node)override
 				{
 					auto result = context.manager->expressionResolvings[node];
@@ -785,33 +1016,112 @@ GenerateInstructions(Expression)
 					}
 					else
 					{
+						// all methods capture the same variables, so an object only holds one closure context
+						auto& captures = context.manager->functionLambdaCaptures;
+						auto capturedSymbols = MakePtr<List<Ptr<WfLexicalSymbol>>>();
+						FOREACH(Ptr<WfFunctionDeclaration>, decl, node->functions)
+						{
+							vint index = captures.Keys().IndexOf(decl.Obj());
+							if (index != -1)
+							{
+								FOREACH(Ptr<WfLexicalSymbol>, symbol, captures.GetByIndex(index))
+								{
+									if (!capturedSymbols->Contains(symbol.Obj()))
+									{
+										capturedSymbols->Add(symbol);
+									}
+								}
+							}
+						}
+
+						// the method table is shared by all objects created here
+						auto methodTable = MakePtr<WfMethodTable>();
 						FOREACH(Ptr<WfFunctionDeclaration>, decl, node->functions)
 						{
-							INSTRUCTION(Ins::LoadValue(BoxValue(decl->name.value)));
 							WfCodegenLambdaContext lc;
 							lc.functionDeclaration = decl.Obj();
-							VisitFunction(decl.Obj(), lc, [=](vint index)
+							lc.interfaceCaptures = capturedSymbols;
+							vint functionIndex = AddClosureFunction(lc, [=](vint index)
 							{
 								return L"<method:" + decl->name.value + L"<" + result.type->GetTypeDescriptor()->GetTypeName() + L">(" + itow(index) + L")> in " + context.functionContext->function->name;
 							});
+							methodTable->methods.Add(context.manager->interfaceMethods[decl.Obj()]);
+							methodTable->functions.Add(functionIndex);
+						}
+
+						FOREACH(Ptr<WfLexicalSymbol>, symbol, *capturedSymbols.Obj())
+						{
+							GenerateLoadSymbolInstructions(symbol.Obj(), node);
 						}
-						INSTRUCTION(Ins::CreateInterface(node->functions.Count() * 2));
+						vint methodTableIndex = context.assembly->methodTables.Add(methodTable);
+						INSTRUCTION(Ins::CreateInterface(methodTableIndex, capturedSymbols->Count()));
 						INSTRUCTION(Ins::LoadValue(Value()));
 						INSTRUCTION(Ins::InvokeMethod(result.methodInfo, 1));
 					}
 				}
 			};
 
+			void GenerateRangeBoundaryInstructions(WfCodegenContext& context, Ptr<WfExpression> boundary, WfRangeBoundary boundaryType, bool beginBoundary, Ptr<reflection::description::ITypeInfo> elementType, parsing::ParsingTreeCustomBase* node)
+			{
+				auto op = beginBoundary ? WfBinaryOperator::Add : WfBinaryOperator::Sub;
+				if (boundaryType == WfRangeBoundary::Exclusive)
+				{
+					// the adjusted boundary of a constant is also a constant
+					Value value, one, adjusted;
+					if (GetConstantValue(context.manager, boundary, elementType, value)
+						&& ConvertConstantValue(BoxValue<vint>(1), elementType.Obj(), one)
+						&& FoldBinaryConstant(GetTypeFlag(elementType.Obj()), op, value, one, adjusted))
+					{
+						INSTRUCTION(Ins::LoadValue(adjusted));
+						return;
+					}
+				}
+
+				GenerateExpressionInstructions(context, boundary, elementType);
+				if (boundaryType == WfRangeBoundary::Exclusive)
+				{
+					INSTRUCTION(Ins::LoadValue(BoxValue<vint>(1)));
+					if (beginBoundary)
+					{
+						INSTRUCTION(Ins::OpAdd(GetInstructionTypeArgument(elementType)));
+					}
+					else
+					{
+						INSTRUCTION(Ins::OpSub(GetInstructionTypeArgument(elementType)));
+					}
+				}
+			}
+
 #undef INSTRUCTION
 
-			Ptr<reflection::description::ITypeInfo> GenerateExpressionInstructions(WfCodegenContext& context, Ptr<WfExpression> expression, Ptr<reflection::description::ITypeInfo> expectedType)
+			bool GenerateLiftedClosureInstructions(WfCodegenContext& context, WfLexicalSymbol* symbol, Ptr<WfExpression> expression)
 			{
 				GenerateExpressionInstructionsVisitor visitor(context);
-				expression->Accept(&visitor);
+				return visitor.VisitLiftedClosure(symbol, expression.Obj());
+			}
 
+			Ptr<reflection::description::ITypeInfo> GenerateExpressionInstructions(WfCodegenContext& context, Ptr<WfExpression> expression, Ptr<reflection::description::ITypeInfo> expectedType)
+			{
 				auto result = context.manager->expressionResolvings[expression.Obj()];
 				auto type = result.type;
 
+				vint index = context.manager->constantValues.Keys().IndexOf(expression.Obj());
+				if (index != -1)
+				{
+					Value value;
+					if (GetConstantValue(context.manager, expression, expectedType, value))
+					{
+						context.AddInstruction(expression.Obj(), Ins::LoadValue(value));
+						return expectedType ? expectedType : result.expectedType ? result.expectedType : type;
+					}
+					context.AddInstruction(expression.Obj(), Ins::LoadValue(context.manager->constantValues.Values()[index]));
+				}
+				else
+				{
+					GenerateExpressionInstructionsVisitor visitor(context);
+					expression->Accept(&visitor);
+				}
+
 				if (result.expectedType && !IsSameType(type.Obj(), result.expectedType.Obj()))
 				{
 					type = result.expectedType;
@@ -72,12 +72,40 @@ GenerateInstructions(Statement)
 					context.functionContext->GetCurrentScopeContext(WfCodegenScopeType::Loop)->continueInstructions.Add(INSTRUCTION(Ins::Jump(-1)));
 				}
 
+				bool IsTailInvoke(vint firstInstruction)
+				{
+					auto& instructions = context.assembly->instructions;
+					vint count = instructions.Count();
+					if (count == firstInstruction || instructions[count - 1].code != WfInsCode::Invoke)
+					{
+						return false;
+					}
+
+					// an inlined function could jump over the last Invoke to return another value
+					for (vint i = firstInstruction; i < count; i++)
+					{
+						auto& ins = instructions[i];
+						if (IsLabelInstruction(ins.code) && ins.indexParameter == count)
+						{
+							return false;
+						}
+					}
+					return true;
+				}
+
 				void Visit(WfReturnStatement* node)override
 				{
 					InlineScopeExitCode(WfCodegenScopeType::Function, false);
 					if (node->expression)
 					{
+						vint firstInstruction = context.assembly->instructions.Count();
 						GenerateExpressionInstructions(context, node->expression);
+						if (node->expression.Cast<WfCallExpression>() && IsTailInvoke(firstInstruction))
+						{
+							// trap frames have been uninstalled, so a call to a global function could reuse the stack frame
+							context.assembly->instructions[context.assembly->instructions.Count() - 1].code = WfInsCode::TailInvoke;
+							return;
+						}
 					}
 					else
 					{
@@ -122,6 +150,20 @@ GenerateInstructions(Statement)
 
 				void Visit(WfIfStatement* node)override
 				{
+					Value condition;
+					if (node->name.value == L"" && GetConstantValue(context.manager, node->expression, 0, condition))
+					{
+						if (UnboxValue<bool>(condition))
+						{
+							GenerateStatementInstructions(context, node->trueBranch);
+						}
+						else if (node->falseBranch)
+						{
+							GenerateStatementInstructions(context, node->falseBranch);
+						}
+						return;
+					}
+
 					vint variableIndex = -1;
 
 					GenerateExpressionInstructions(context, node->expression);
@@ -161,8 +203,119 @@ GenerateInstructions(Statement)
 					context.assembly->instructions[fillEndIndex].indexParameter = context.assembly->instructions.Count();
 				}
 
+				bool GetConstantSwitchBranch(WfSwitchStatement* node, Ptr<WfStatement>& branch)
+				{
+					auto expressionResult = context.manager->expressionResolvings[node->expression.Obj()];
+					auto expressionType = expressionResult.expectedType ? expressionResult.expectedType : expressionResult.type;
+
+					// a switch with only a default branch still evaluates a non-constant expression for its side effects
+					Value value;
+					if (!GetConstantValue(context.manager, node->expression, expressionType, value)) return false;
+
+					FOREACH(Ptr<WfSwitchCase>, switchCase, node->caseBranches)
+					{
+						auto caseResult = context.manager->expressionResolvings[switchCase->expression.Obj()];
+						auto caseType = caseResult.expectedType ? caseResult.expectedType : caseResult.type;
+						auto mergedType = GetMergedType(expressionType, caseType);
+
+						Value expressionValue, caseValue, equal;
+						if (!GetConstantValue(context.manager, node->expression, mergedType, expressionValue)) return false;
+						if (!GetConstantValue(context.manager, switchCase->expression, mergedType, caseValue)) return false;
+						if (!FoldBinaryConstant(GetTypeFlag(mergedType.Obj()), WfBinaryOperator::EQ, expressionValue, caseValue, equal)) return false;
+						if (UnboxValue<bool>(equal))
+						{
+							branch = switchCase->statement;
+							return true;
+						}
+					}
+					branch = node->defaultBranch;
+					return true;
+				}
+
+				Ptr<WfSwitchTable> GetSwitchTable(WfSwitchStatement* node)
+				{
+					// short switches are cheaper as a comparison chain than as a table lookup
+					if (node->caseBranches.Count() < 3) return nullptr;
+
+					auto expressionResult = context.manager->expressionResolvings[node->expression.Obj()];
+					auto expressionType = expressionResult.expectedType ? expressionResult.expectedType : expressionResult.type;
+					if (expressionType->GetDecorator() != ITypeInfo::TypeDescriptor) return nullptr;
+					auto type = GetInstructionTypeArgument(expressionType);
+					switch (type)
+					{
+					case WfInsType::Bool:
+					case WfInsType::F4:
+					case WfInsType::F8:
+					case WfInsType::Unknown:
+						return nullptr;
+					default:;
+					}
+
+					auto table = MakePtr<WfSwitchTable>();
+					table->type = type;
+					FOREACH(Ptr<WfSwitchCase>, switchCase, node->caseBranches)
+					{
+						auto caseResult = context.manager->expressionResolvings[switchCase->expression.Obj()];
+						auto caseType = caseResult.expectedType ? caseResult.expectedType : caseResult.type;
+						if (!IsSameType(expressionType.Obj(), GetMergedType(expressionType, caseType).Obj())) return nullptr;
+
+						Value key;
+						if (!GetConstantValue(context.manager, switchCase->expression, expressionType, key)) return nullptr;
+						table->keys.Add(key);
+						table->labels.Add(-1);
+					}
+					return table;
+				}
+
+				void GenerateSwitchTableInstructions(WfSwitchStatement* node, Ptr<WfSwitchTable> table)
+				{
+					vint tableIndex = context.assembly->switchTables.Add(table);
+					GenerateExpressionInstructions(context, node->expression);
+					INSTRUCTION(Ins::SwitchTable(tableIndex));
+					vint defaultInstruction = INSTRUCTION(Ins::Jump(-1));
+					auto switchContext = context.functionContext->PushScopeContext(WfCodegenScopeType::Switch);
+
+					List<vint> breakInstructions;
+					FOREACH_INDEXER(Ptr<WfSwitchCase>, switchCase, index, node->caseBranches)
+					{
+						table->labels[index] = context.assembly->instructions.Count();
+						GenerateStatementInstructions(context, switchCase->statement);
+						breakInstructions.Add(INSTRUCTION(Ins::Jump(-1)));
+					}
+
+					context.assembly->instructions[defaultInstruction].indexParameter = context.assembly->instructions.Count();
+					if (node->defaultBranch)
+					{
+						GenerateStatementInstructions(context, node->defaultBranch);
+					}
+
+					vint breakLabelIndex = context.assembly->instructions.Count();
+					FOREACH(vint, index, breakInstructions)
+					{
+						context.assembly->instructions[index].indexParameter = breakLabelIndex;
+					}
+					ApplyCurrentScopeExitCode();
+					context.functionContext->PopScopeContext();
+				}
+
 				void Visit(WfSwitchStatement* node)override
 				{
+					Ptr<WfStatement> branch;
+					if (GetConstantSwitchBranch(node, branch))
+					{
+						if (branch)
+						{
+							GenerateStatementInstructions(context, branch);
+						}
+						return;
+					}
+
+					if (auto table = GetSwitchTable(node))
+					{
+						GenerateSwitchTableInstructions(node, table);
+						return;
+					}
+
 					auto function = context.functionContext->function;
 					vint variableIndex = function->argumentNames.Count() + function->localVariableNames.Add(L"<switch>");
 					GenerateExpressionInstructions(context, node->expression);
@@ -282,19 +435,9 @@ GenerateInstructions(Statement)
 							EXIT_CODE(Ins::LoadValue(Value()));
 							EXIT_CODE(Ins::StoreLocalVar(endIndex));
 						}
-						GenerateExpressionInstructions(context, range->begin, symbol->typeInfo);
-						if (range->beginBoundary == WfRangeBoundary::Exclusive)
-						{
-							INSTRUCTION(Ins::LoadValue(BoxValue<vint>(1)));
-							INSTRUCTION(Ins::OpAdd(typeArgument));
-						}
+						GenerateRangeBoundaryInstructions(context, range->begin, range->beginBoundary, true, symbol->typeInfo, node);
 						INSTRUCTION(Ins::StoreLocalVar(beginIndex));
-						GenerateExpressionInstructions(context, range->end, symbol->typeInfo);
-						if (range->endBoundary == WfRangeBoundary::Exclusive)
-						{
-							INSTRUCTION(Ins::LoadValue(BoxValue<vint>(1)));
-							INSTRUCTION(Ins::OpSub(typeArgument));
-						}
+						GenerateRangeBoundaryInstructions(context, range->end, range->endBoundary, false, symbol->typeInfo, node);
 						INSTRUCTION(Ins::StoreLocalVar(endIndex));
 
 						if (node->direction == WfForEachDirection::Normal)
@@ -371,8 +514,7 @@ GenerateInstructions(Statement)
 						INSTRUCTION(Ins::InvokeMethod(methodCreateEnumerator, 0));
 						INSTRUCTION(Ins::StoreLocalVar(enumeratorIndex));
 						
-						loopLabelIndex = INSTRUCTION(Ins::LoadLocalVar(elementIndex));
-						INSTRUCTION(Ins::LoadLocalVar(enumeratorIndex));
+						loopLabelIndex = INSTRUCTION(Ins::LoadLocalVar(enumeratorIndex));
 						INSTRUCTION(Ins::InvokeMethod(methodNext, 0));
 						INSTRUCTION(Ins::OpNot(WfInsType::Bool));
 						loopContext->breakInstructions.Add(INSTRUCTION(Ins::JumpIf(-1)));
@@ -492,6 +634,11 @@ GenerateInstructions(Statement)
 					auto manager = context.manager;
 					auto scope = manager->declarationScopes[node->variable.Obj()];
 					auto symbol = scope->symbols[node->variable->name.value][0].Obj();
+					if (GenerateLiftedClosureInstructions(context, symbol, node->variable->expression))
+					{
+						return;
+					}
+
 					auto function = context.functionContext->function;
 					vint index = function->argumentNames.Count() + function->localVariableNames.Add(node->variable->name.value);
 					context.functionContext->localVariables.Add(symbol, index);
@@ -0,0 +1,606 @@
+#include "WfAnalyzer.h"
+
+namespace vl
+{
+	namespace workflow
+	{
+		namespace analyzer
+		{
+			using namespace collections;
+			using namespace parsing;
+			using namespace reflection;
+			using namespace reflection::description;
+			using namespace runtime;
+
+			typedef WfInstruction Ins;
+
+/***********************************************************************
+RewriteInstructions
+***********************************************************************/
+
+			bool IsLabelInstruction(WfInsCode code)
+			{
+				switch (code)
+				{
+				case WfInsCode::Jump:
+				case WfInsCode::JumpIf:
+				case WfInsCode::InstallTry:
+				case WfInsCode::JumpIfLT:
+				case WfInsCode::JumpIfGT:
+				case WfInsCode::JumpIfLE:
+				case WfInsCode::JumpIfGE:
+				case WfInsCode::JumpIfEQ:
+				case WfInsCode::JumpIfNE:
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			ParsingTextRange MergeInstructionCodeMapping(Ptr<WfInstructionDebugInfo> debugInfo, vint index, vint count)
+			{
+				auto range = debugInfo->instructionCodeMapping[index];
+				for (vint i = 1; i < count; i++)
+				{
+					auto next = debugInfo->instructionCodeMapping[index + i];
+					if (next.codeIndex != -1 && next.codeIndex == range.codeIndex)
+					{
+						if (next.start < range.start) range.start = next.start;
+						if (next.end > range.end) range.end = next.end;
+					}
+				}
+				return range;
+			}
+
+			/// <summary>Replace instruction sequences in an assembly. Labels, function ranges and debug informations are updated.</summary>
+			/// <param name="assembly">The assembly.</param>
+			/// <param name="rewriter">
+			/// Called with the index of the first instruction, the first instruction, the number of instructions from the first one until the next jump target, and the container for new instructions.
+			/// Returns the number of replaced instructions, or 0 to keep the first instruction. Returning a positive number without adding instructions removes them.
+			/// </param>
+			template<typename TRewriter>
+			void RewriteInstructions(Ptr<WfAssembly> assembly, const TRewriter& rewriter)
+			{
+				vint count = assembly->instructions.Count();
+
+				// only the first instruction of a sequence could be jumped to, so a sequence never crosses functions
+				Array<bool> labels(count + 1);
+				for (vint i = 0; i <= count; i++)
+				{
+					labels[i] = false;
+				}
+				FOREACH(WfInstruction, ins, assembly->instructions)
+				{
+					if (IsLabelInstruction(ins.code) && 0 <= ins.indexParameter && ins.indexParameter < count)
+					{
+						labels[ins.indexParameter] = true;
+					}
+				}
+				FOREACH(Ptr<WfSwitchTable>, table, assembly->switchTables)
+				{
+					FOREACH(vint, label, table->labels)
+					{
+						labels[label] = true;
+					}
+				}
+				FOREACH(Ptr<WfAssemblyFunction>, function, assembly->functions)
+				{
+					if (function->firstInstruction >= 0)
+					{
+						labels[function->firstInstruction] = true;
+					}
+				}
+
+				Array<vint> sequences(count + 1);
+				sequences[count] = 0;
+				for (vint i = count - 1; i >= 0; i--)
+				{
+					sequences[i] = labels[i + 1] ? 1 : sequences[i + 1] + 1;
+				}
+
+				List<WfInstruction> instructions;
+				List<ParsingTextRange> mappingBeforeCodegen, mappingAfterCodegen;
+				Array<vint> newIndices(count + 1);
+				vint index = 0;
+				while (index < count)
+				{
+					vint first = instructions.Count();
+					vint replaced = rewriter(index, &assembly->instructions[index], sequences[index], instructions);
+					if (replaced == 0)
+					{
+						instructions.Add(assembly->instructions[index]);
+						replaced = 1;
+					}
+
+					for (vint i = 0; i < replaced; i++)
+					{
+						newIndices[index + i] = first;
+					}
+					for (vint i = first; i < instructions.Count(); i++)
+					{
+						mappingBeforeCodegen.Add(MergeInstructionCodeMapping(assembly->insBeforeCodegen, index, replaced));
+						if (assembly->insAfterCodegen)
+						{
+							mappingAfterCodegen.Add(MergeInstructionCodeMapping(assembly->insAfterCodegen, index, replaced));
+						}
+					}
+					index += replaced;
+				}
+				newIndices[count] = instructions.Count();
+
+				for (vint i = 0; i < instructions.Count(); i++)
+				{
+					auto& ins = instructions[i];
+					if (IsLabelInstruction(ins.code))
+					{
+						ins.indexParameter = newIndices[ins.indexParameter];
+					}
+				}
+				FOREACH(Ptr<WfSwitchTable>, table, assembly->switchTables)
+				{
+					for (vint i = 0; i < table->labels.Count(); i++)
+					{
+						table->labels[i] = newIndices[table->labels[i]];
+					}
+				}
+				FOREACH(Ptr<WfAssemblyFunction>, function, assembly->functions)
+				{
+					function->lastInstruction = newIndices[function->lastInstruction + 1] - 1;
+					function->firstInstruction = newIndices[function->firstInstruction];
+				}
+
+				CopyFrom(assembly->instructions, instructions);
+				CopyFrom(assembly->insBeforeCodegen->instructionCodeMapping, mappingBeforeCodegen);
+				if (assembly->insAfterCodegen)
+				{
+					CopyFrom(assembly->insAfterCodegen->instructionCodeMapping, mappingAfterCodegen);
+				}
+			}
+
+/***********************************************************************
+OptimizeInstructions
+***********************************************************************/
+
+			void GetInstructionSuccessors(WfAssembly* assembly, const WfInstruction& ins, vint index, List<vint>& successors)
+			{
+				successors.Clear();
+				switch (ins.code)
+				{
+				case WfInsCode::Return:
+				case WfInsCode::TailInvoke:
+				case WfInsCode::RaiseException:
+					break;
+				case WfInsCode::Jump:
+					successors.Add(ins.indexParameter);
+					break;
+				case WfInsCode::SwitchTable:
+					successors.Add(index + 1);
+					CopyFrom(successors, assembly->switchTables[ins.indexParameter]->labels, true);
+					break;
+				default:
+					successors.Add(index + 1);
+					if (IsLabelInstruction(ins.code))
+					{
+						successors.Add(ins.indexParameter);
+					}
+				}
+			}
+
+			void RemoveUnreachableInstructions(Ptr<WfAssembly> assembly)
+			{
+				// instructions outside of any function are kept
+				Array<bool> reachable(assembly->instructions.Count());
+				for (vint i = 0; i < reachable.Count(); i++)
+				{
+					reachable[i] = true;
+				}
+				FOREACH(Ptr<WfAssemblyFunction>, function, assembly->functions)
+				{
+					for (vint i = function->firstInstruction; i <= function->lastInstruction; i++)
+					{
+						reachable[i] = false;
+					}
+				}
+
+				List<vint> pendingInstructions, successors;
+				FOREACH(Ptr<WfAssemblyFunction>, function, assembly->functions)
+				{
+					reachable[function->firstInstruction] = true;
+					pendingInstructions.Add(function->firstInstruction);
+					while (pendingInstructions.Count() > 0)
+					{
+						vint index = pendingInstructions[pendingInstructions.Count() - 1];
+						pendingInstructions.RemoveAt(pendingInstructions.Count() - 1);
+
+						GetInstructionSuccessors(assembly.Obj(), assembly->instructions[index], index, successors);
+						FOREACH(vint, successor, successors)
+						{
+							if (function->firstInstruction <= successor && successor <= function->lastInstruction && !reachable[successor])
+							{
+								reachable[successor] = true;
+								pendingInstructions.Add(successor);
+							}
+						}
+					}
+				}
+
+				RewriteInstructions(assembly, [&](vint index, const WfInstruction* ins, vint count, List<WfInstruction>& instructions)->vint
+				{
+					return reachable[index] ? 0 : 1;
+				});
+			}
+
+			vint GetFinalJumpTarget(const List<WfInstruction>& instructions, vint target)
+			{
+				// a jump to a jump goes to the final target directly, loops of jumps are left unchanged
+				vint label = target;
+				for (vint steps = 0; steps < instructions.Count() && instructions[label].code == WfInsCode::Jump; steps++)
+				{
+					label = instructions[label].indexParameter;
+				}
+				return instructions[label].code == WfInsCode::Jump ? target : label;
+			}
+
+			void ThreadJumps(Ptr<WfAssembly> assembly)
+			{
+				auto& instructions = assembly->instructions;
+				for (vint i = 0; i < instructions.Count(); i++)
+				{
+					auto& ins = instructions[i];
+					if (ins.code != WfInsCode::InstallTry && IsLabelInstruction(ins.code))
+					{
+						ins.indexParameter = GetFinalJumpTarget(instructions, ins.indexParameter);
+					}
+				}
+				FOREACH(Ptr<WfSwitchTable>, table, assembly->switchTables)
+				{
+					for (vint i = 0; i < table->labels.Count(); i++)
+					{
+						table->labels[i] = GetFinalJumpTarget(instructions, table->labels[i]);
+					}
+				}
+			}
+
+			class WfLocalVariableLiveness : public Object
+			{
+			protected:
+				WfAssembly*							assembly;
+				WfAssemblyFunction*					function;
+				vint								variableCount;
+				Array<bool>							liveVariables;		// (instruction, variable) -> true if the variable is read before written after entering the instruction
+
+				void GetUsedVariables(const WfInstruction& ins, List<vint>& variables)
+				{
+					switch (ins.code)
+					{
+					case WfInsCode::LoadLocalVar:
+					case WfInsCode::IncreaseLocalVar:
+						variables.Add(ins.indexParameter);
+						break;
+					case WfInsCode::LoadLocalVar2:
+						variables.Add(ins.indexParameter);
+						variables.Add(ins.countParameter);
+						break;
+					default:;
+					}
+				}
+
+				vint GetDefinedVariable(const WfInstruction& ins)
+				{
+					switch (ins.code)
+					{
+					case WfInsCode::StoreLocalVar:
+					case WfInsCode::IncreaseLocalVar:
+						return ins.indexParameter;
+					default:
+						return -1;
+					}
+				}
+			public:
+				WfLocalVariableLiveness(WfAssembly* _assembly, WfAssemblyFunction* _function)
+					:assembly(_assembly)
+					, function(_function)
+					, variableCount(_function->argumentNames.Count() + _function->localVariableNames.Count())
+				{
+					vint count = function->lastInstruction - function->firstInstruction + 1;
+					liveVariables.Resize(count * variableCount);
+					for (vint i = 0; i < liveVariables.Count(); i++)
+					{
+						liveVariables[i] = false;
+					}
+
+					List<vint> usedVariables, successors;
+					bool modified = true;
+					while (modified)
+					{
+						modified = false;
+						for (vint index = function->lastInstruction; index >= function->firstInstruction; index--)
+						{
+							auto& ins = assembly->instructions[index];
+							vint definedVariable = GetDefinedVariable(ins);
+							usedVariables.Clear();
+							GetUsedVariables(ins, usedVariables);
+
+							GetInstructionSuccessors(assembly, ins, index, successors);
+							for (vint variable = 0; variable < variableCount; variable++)
+							{
+								bool live = usedVariables.Contains(variable);
+								if (!live && variable != definedVariable)
+								{
+									FOREACH(vint, successor, successors)
+									{
+										if (IsLiveBefore(successor, variable))
+										{
+											live = true;
+											break;
+										}
+									}
+								}
+
+								auto& item = liveVariables[(index - function->firstInstruction) * variableCount + variable];
+								if (item != live)
+								{
+									item = live;
+									modified = true;
+								}
+							}
+						}
+					}
+				}
+
+				bool IsLiveBefore(vint index, vint variable)
+				{
+					if (index < function->firstInstruction || index > function->lastInstruction)
+					{
+						return false;
+					}
+					return liveVariables[(index - function->firstInstruction) * variableCount + variable];
+				}
+
+				bool IsLiveAfter(vint index, vint variable)
+				{
+					List<vint> successors;
+					GetInstructionSuccessors(assembly, assembly->instructions[index], index, successors);
+					FOREACH(vint, successor, successors)
+					{
+						if (IsLiveBefore(successor, variable))
+						{
+							return true;
+						}
+					}
+					return false;
+				}
+			};
+
+			void RemoveDeadStores(Ptr<WfAssembly> assembly)
+			{
+				auto& instructions = assembly->instructions;
+				Array<bool> forwardedStores(instructions.Count());
+				for (vint i = 0; i < forwardedStores.Count(); i++)
+				{
+					forwardedStores[i] = false;
+				}
+
+				FOREACH(Ptr<WfAssemblyFunction>, function, assembly->functions)
+				{
+					// an exception jumps to the catch block from any instruction in a try block, which is not tracked here
+					bool hasTrap = false;
+					for (vint i = function->firstInstruction; i <= function->lastInstruction; i++)
+					{
+						if (instructions[i].code == WfInsCode::InstallTry)
+						{
+							hasTrap = true;
+							break;
+						}
+					}
+					if (hasTrap) continue;
+
+					WfLocalVariableLiveness liveness(assembly.Obj(), function.Obj());
+					for (vint i = function->firstInstruction; i <= function->lastInstruction; i++)
+					{
+						auto& ins = instructions[i];
+						if (ins.code == WfInsCode::StoreLocalVar)
+						{
+							if (!liveness.IsLiveAfter(i, ins.indexParameter))
+							{
+								ins = Ins::Pop();
+							}
+							else if (i < function->lastInstruction)
+							{
+								auto& next = instructions[i + 1];
+								if (next.code == WfInsCode::LoadLocalVar && next.indexParameter == ins.indexParameter && !liveness.IsLiveAfter(i + 1, ins.indexParameter))
+								{
+									forwardedStores[i] = true;
+								}
+							}
+						}
+					}
+				}
+
+				// StoreLocalVar x, LoadLocalVar x -> (), when x is not read later
+				RewriteInstructions(assembly, [&](vint index, const WfInstruction* ins, vint count, List<WfInstruction>& instructions)->vint
+				{
+					return forwardedStores[index] && count >= 2 ? 2 : 0;
+				});
+			}
+
+			bool IsPureLoadInstruction(const WfInstruction& ins)
+			{
+				switch (ins.code)
+				{
+				case WfInsCode::LoadValue:
+				case WfInsCode::LoadLocalVar:
+				case WfInsCode::LoadCapturedVar:
+				case WfInsCode::Duplicate:
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			void RemoveRedundantInstructions(Ptr<WfAssembly> assembly)
+			{
+				RewriteInstructions(assembly, [&](vint index, const WfInstruction* ins, vint count, List<WfInstruction>& instructions)->vint
+				{
+					// LoadValue/LoadLocalVar/LoadCapturedVar/Duplicate, Pop -> ()
+					if (count >= 2 && IsPureLoadInstruction(ins[0]) && ins[1].code == WfInsCode::Pop)
+					{
+						return 2;
+					}
+
+					// Duplicate 0, StoreLocalVar/StoreGlobalVar, Pop -> StoreLocalVar/StoreGlobalVar
+					if (count >= 3 && ins[0].code == WfInsCode::Duplicate && ins[0].countParameter == 0
+						&& (ins[1].code == WfInsCode::StoreLocalVar || ins[1].code == WfInsCode::StoreGlobalVar)
+						&& ins[2].code == WfInsCode::Pop)
+					{
+						instructions.Add(ins[1]);
+						return 3;
+					}
+
+					// Jump to the next instruction -> ()
+					if (ins[0].code == WfInsCode::Jump && ins[0].indexParameter == index + 1)
+					{
+						return 1;
+					}
+
+					// JumpIf to the next instruction -> Pop
+					if (ins[0].code == WfInsCode::JumpIf && ins[0].indexParameter == index + 1)
+					{
+						instructions.Add(Ins::Pop());
+						return 1;
+					}
+
+					return 0;
+				});
+			}
+
+			void OptimizeInstructions(Ptr<runtime::WfAssembly> assembly)
+			{
+				while (true)
+				{
+					vint count = assembly->instructions.Count();
+					RemoveUnreachableInstructions(assembly);
+					ThreadJumps(assembly);
+					RemoveDeadStores(assembly);
+					RemoveRedundantInstructions(assembly);
+					if (assembly->instructions.Count() == count)
+					{
+						break;
+					}
+				}
+			}
+
+/***********************************************************************
+GenerateSuperInstructions
+***********************************************************************/
+
+			bool GetNegativeValue(const Value& value, WfInsType type, Value& result)
+			{
+				switch (type)
+				{
+				case WfInsType::I1: result = BoxValue<vint8_t>((vint8_t)(0 - (vuint8_t)UnboxValue<vint8_t>(value))); return true;
+				case WfInsType::I2: result = BoxValue<vint16_t>((vint16_t)(0 - (vuint16_t)UnboxValue<vint16_t>(value))); return true;
+				case WfInsType::I4: result = BoxValue<vint32_t>((vint32_t)(0 - (vuint32_t)UnboxValue<vint32_t>(value))); return true;
+				case WfInsType::I8: result = BoxValue<vint64_t>((vint64_t)(0 - (vuint64_t)UnboxValue<vint64_t>(value))); return true;
+				case WfInsType::U1: result = BoxValue<vuint8_t>((vuint8_t)(0 - UnboxValue<vuint8_t>(value))); return true;
+				case WfInsType::U2: result = BoxValue<vuint16_t>((vuint16_t)(0 - UnboxValue<vuint16_t>(value))); return true;
+				case WfInsType::U4: result = BoxValue<vuint32_t>((vuint32_t)(0 - UnboxValue<vuint32_t>(value))); return true;
+				case WfInsType::U8: result = BoxValue<vuint64_t>((vuint64_t)(0 - UnboxValue<vuint64_t>(value))); return true;
+				case WfInsType::F4: result = BoxValue<float>(-UnboxValue<float>(value)); return true;
+				case WfInsType::F8: result = BoxValue<double>(-UnboxValue<double>(value)); return true;
+				default: return false;
+				}
+			}
+
+			bool GetCompareJumpInstruction(WfInsCode code, bool negative, vint label, WfInsType type, WfInstruction& result)
+			{
+				// CompareLiteral returns -1, 0 or 1, so a negative comparison is the opposite comparison
+				if (negative)
+				{
+					switch (code)
+					{
+					case WfInsCode::OpLT: code = WfInsCode::OpGE; break;
+					case WfInsCode::OpGT: code = WfInsCode::OpLE; break;
+					case WfInsCode::OpLE: code = WfInsCode::OpGT; break;
+					case WfInsCode::OpGE: code = WfInsCode::OpLT; break;
+					case WfInsCode::OpEQ: code = WfInsCode::OpNE; break;
+					case WfInsCode::OpNE: code = WfInsCode::OpEQ; break;
+					default: return false;
+					}
+				}
+
+				switch (code)
+				{
+				case WfInsCode::OpLT: result = Ins::JumpIfLT(label, type); return true;
+				case WfInsCode::OpGT: result = Ins::JumpIfGT(label, type); return true;
+				case WfInsCode::OpLE: result = Ins::JumpIfLE(label, type); return true;
+				case WfInsCode::OpGE: result = Ins::JumpIfGE(label, type); return true;
+				case WfInsCode::OpEQ: result = Ins::JumpIfEQ(label, type); return true;
+				case WfInsCode::OpNE: result = Ins::JumpIfNE(label, type); return true;
+				default: return false;
+				}
+			}
+
+			void GenerateSuperInstructions(Ptr<runtime::WfAssembly> assembly)
+			{
+				WfRuntimePrimitiveTypes primitiveTypes;
+				RewriteInstructions(assembly, [&](vint index, const WfInstruction* ins, vint count, List<WfInstruction>& instructions)->vint
+				{
+					// LoadLocalVar x, LoadValue c, OpAdd/OpSub, (Duplicate 0), StoreLocalVar x, (Pop) -> IncreaseLocalVar x, c
+					if (count >= 4 && ins[0].code == WfInsCode::LoadLocalVar && ins[1].code == WfInsCode::LoadValue)
+					{
+						auto type = primitiveTypes.GetInsType(ins[1].valueParameter.GetTypeDescriptor());
+						auto code = WfInstruction::GetGenericCode(ins[2].code);
+						if (type == ins[2].typeParameter && (code == WfInsCode::OpAdd || code == WfInsCode::OpSub) && code != ins[2].code)
+						{
+							vint replaced = 0;
+							if (ins[3].code == WfInsCode::StoreLocalVar && ins[3].indexParameter == ins[0].indexParameter)
+							{
+								replaced = 4;
+							}
+							else if (count >= 6
+								&& ins[3].code == WfInsCode::Duplicate && ins[3].countParameter == 0
+								&& ins[4].code == WfInsCode::StoreLocalVar && ins[4].indexParameter == ins[0].indexParameter
+								&& ins[5].code == WfInsCode::Pop)
+							{
+								replaced = 6;
+							}
+
+							Value step = ins[1].valueParameter;
+							if (replaced > 0 && (code == WfInsCode::OpAdd || GetNegativeValue(ins[1].valueParameter, type, step)))
+							{
+								instructions.Add(Ins::IncreaseLocalVar(ins[0].indexParameter, step));
+								return replaced;
+							}
+						}
+					}
+
+					// CompareLiteral, OpLT/OpGT/OpLE/OpGE/OpEQ/OpNE, (OpNot), JumpIf -> JumpIfLT/JumpIfGT/JumpIfLE/JumpIfGE/JumpIfEQ/JumpIfNE
+					if (count >= 3 && WfInstruction::GetGenericCode(ins[0].code) == WfInsCode::CompareLiteral && ins[0].code != WfInsCode::CompareLiteral)
+					{
+						WfInstruction jump;
+						if (ins[2].code == WfInsCode::JumpIf && GetCompareJumpInstruction(ins[1].code, false, ins[2].indexParameter, ins[0].typeParameter, jump))
+						{
+							instructions.Add(jump);
+							return 3;
+						}
+						if (count >= 4 && ins[2].code == WfInsCode::OpNot_Bool && ins[3].code == WfInsCode::JumpIf && GetCompareJumpInstruction(ins[1].code, true, ins[3].indexParameter, ins[0].typeParameter, jump))
+						{
+							instructions.Add(jump);
+							return 4;
+						}
+					}
+
+					// LoadLocalVar, LoadLocalVar -> LoadLocalVar2
+					if (count >= 2 && ins[0].code == WfInsCode::LoadLocalVar && ins[1].code == WfInsCode::LoadLocalVar)
+					{
+						instructions.Add(Ins::LoadLocalVar2(ins[0].indexParameter, ins[1].indexParameter));
+						return 2;
+					}
+
+					return 0;
+				});
+			}
+		}
+	}
+}
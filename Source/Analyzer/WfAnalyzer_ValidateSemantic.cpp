@@ -1669,6 +1669,10 @@ ValidateSemantic(Expression)
 													Ptr<ITypeInfo> methodType = GetFunctionDeclarationType(scope, decl);
 													manager->errors.Add(WfErrors::CannotPickOverloadedImplementMethods(decl.Obj(), methodType.Obj()));
 												}
+												if (interfaces.Count() == 1 && implements.Count() == 1)
+												{
+													manager->interfaceMethods.Set(implements[0].Obj(), interfaces[0]);
+												}
 											});
 									});
 							}
@@ -30,21 +30,258 @@ namespace vl
 			SERIALIZE_ENUM(WfInsType)
 			SERIALIZE_ENUM(Value::ValueType)
 
+/***********************************************************************
+Symbol Tables
+***********************************************************************/
+
+			// Strings and reflection objects are stored once in tables before all other data, and are referenced by indexes.
+			// Types and members are resolved once when the tables are loaded.
+
+			struct WfMemberSymbol
+			{
+				vint									type = -1;
+				vint									name = -1;
+			};
+
+			struct WfMethodSymbol
+			{
+				vint									type = -1;
+				vint									name = -1;
+				List<vint>								parameters;
+			};
+
+			BEGIN_SERIALIZATION(WfMemberSymbol)
+				SERIALIZE(type)
+				SERIALIZE(name)
+			END_SERIALIZATION
+
+			BEGIN_SERIALIZATION(WfMethodSymbol)
+				SERIALIZE(type)
+				SERIALIZE(name)
+				SERIALIZE(parameters)
+			END_SERIALIZATION
+
+			const vint32_t								WfAssemblyMagic = 0x53414657;	// "WFAS"
+
+			IMethodInfo* LoadMethod(ITypeDescriptor* type, const WString& name, const List<WString>& parameters)
+			{
+				auto group =
+					name == L"#ctor" ? type->GetConstructorGroup() :
+					type->GetMethodGroupByName(name, false);
+				CHECK_ERROR(group, L"Failed to load method.");
+
+				IMethodInfo* value = 0;
+				vint count = group->GetMethodCount();
+				for (vint i = 0; i < count; i++)
+				{
+					auto method = group->GetMethod(i);
+					if (method->GetParameterCount() == parameters.Count())
+					{
+						bool found = true;
+						for (vint j = 0; j < parameters.Count(); j++)
+						{
+							if (method->GetParameter(j)->GetName() != parameters[j])
+							{
+								found = false;
+								break;
+							}
+						}
+
+						if (found)
+						{
+							CHECK_ERROR(!value, L"Failed to load method.");
+							value = method;
+						}
+					}
+				}
+				CHECK_ERROR(value, L"Failed to load method.");
+				return value;
+			}
+
+			struct WfAssemblyReader : Reader
+			{
+				WfRuntimePrimitiveTypes					primitiveTypes;
+				List<WString>							strings;
+				List<ITypeDescriptor*>					types;
+				List<IMethodInfo*>						methods;
+				List<IPropertyInfo*>					properties;
+				List<IEventInfo*>						events;
+
+				WfAssemblyReader(stream::IStream& _input)
+					:Reader(_input)
+				{
+				}
+
+				// indexes are read from the data, a corrupted assembly must not be able to access other memory
+				template<typename T>
+				T& GetSymbol(List<T>& symbols, vint index)
+				{
+					if (index < 0 || index >= symbols.Count())
+					{
+						CHECK_FAIL(L"Deserialization failed.");
+					}
+					return symbols[index];
+				}
+
+				void ReadSymbols()
+				{
+					vint32_t magic = 0, version = 0;
+					*this << magic << version;
+					CHECK_ERROR(magic == WfAssemblyMagic, L"The data is not a serialized assembly.");
+					CHECK_ERROR(version == WfAssembly::BinaryVersion, L"The assembly is serialized in an incompatible version.");
+
+					List<vint> typeNames;
+					List<Ptr<WfMethodSymbol>> methodSymbols;
+					List<Ptr<WfMemberSymbol>> propertySymbols, eventSymbols;
+					*this << strings << typeNames << methodSymbols << propertySymbols << eventSymbols;
+
+					FOREACH(vint, name, typeNames)
+					{
+						auto type = GetTypeDescriptor(GetSymbol(strings, name));
+						CHECK_ERROR(type, L"Failed to load type.");
+						types.Add(type);
+					}
+
+					FOREACH(Ptr<WfMethodSymbol>, symbol, methodSymbols)
+					{
+						List<WString> parameters;
+						FOREACH(vint, parameter, symbol->parameters)
+						{
+							parameters.Add(GetSymbol(strings, parameter));
+						}
+						methods.Add(LoadMethod(GetSymbol(types, symbol->type), GetSymbol(strings, symbol->name), parameters));
+					}
+
+					FOREACH(Ptr<WfMemberSymbol>, symbol, propertySymbols)
+					{
+						auto property = GetSymbol(types, symbol->type)->GetPropertyByName(GetSymbol(strings, symbol->name), false);
+						CHECK_ERROR(property, L"Failed to load property.");
+						properties.Add(property);
+					}
+
+					FOREACH(Ptr<WfMemberSymbol>, symbol, eventSymbols)
+					{
+						auto event = GetSymbol(types, symbol->type)->GetEventByName(GetSymbol(strings, symbol->name), false);
+						CHECK_ERROR(event, L"Failed to load event.");
+						events.Add(event);
+					}
+				}
+			};
+
+			struct WfAssemblyWriter : Writer
+			{
+				WfRuntimePrimitiveTypes					primitiveTypes;
+				Dictionary<WString, vint>				stringIndexes;
+				Dictionary<ITypeDescriptor*, vint>		typeIndexes;
+				Dictionary<IMethodInfo*, vint>			methodIndexes;
+				Dictionary<IPropertyInfo*, vint>		propertyIndexes;
+				Dictionary<IEventInfo*, vint>			eventIndexes;
+				List<WString>							strings;
+				List<vint>								typeNames;
+				List<Ptr<WfMethodSymbol>>				methodSymbols;
+				List<Ptr<WfMemberSymbol>>				propertySymbols;
+				List<Ptr<WfMemberSymbol>>				eventSymbols;
+
+				WfAssemblyWriter(stream::IStream& _output)
+					:Writer(_output)
+				{
+				}
+
+				vint AddString(const WString& value)
+				{
+					vint index = stringIndexes.Keys().IndexOf(value);
+					if (index != -1) return stringIndexes.Values()[index];
+					vint result = strings.Add(value);
+					stringIndexes.Add(value, result);
+					return result;
+				}
+
+				vint AddType(ITypeDescriptor* value)
+				{
+					vint index = typeIndexes.Keys().IndexOf(value);
+					if (index != -1) return typeIndexes.Values()[index];
+					vint result = typeNames.Add(AddString(value->GetTypeName()));
+					typeIndexes.Add(value, result);
+					return result;
+				}
+
+				vint AddMethod(IMethodInfo* value)
+				{
+					vint index = methodIndexes.Keys().IndexOf(value);
+					if (index != -1) return methodIndexes.Values()[index];
+
+					auto type = value->GetOwnerTypeDescriptor();
+					auto symbol = MakePtr<WfMethodSymbol>();
+					symbol->type = AddType(type);
+					symbol->name = AddString(value->GetOwnerMethodGroup() == type->GetConstructorGroup() ? WString(L"#ctor") : value->GetName());
+					vint count = value->GetParameterCount();
+					for (vint i = 0; i < count; i++)
+					{
+						symbol->parameters.Add(AddString(value->GetParameter(i)->GetName()));
+					}
+
+					vint result = methodSymbols.Add(symbol);
+					methodIndexes.Add(value, result);
+					return result;
+				}
+
+				template<typename T>
+				vint AddMember(T* value, Dictionary<T*, vint>& indexes, List<Ptr<WfMemberSymbol>>& symbols)
+				{
+					vint index = indexes.Keys().IndexOf(value);
+					if (index != -1) return indexes.Values()[index];
+
+					auto symbol = MakePtr<WfMemberSymbol>();
+					symbol->type = AddType(value->GetOwnerTypeDescriptor());
+					symbol->name = AddString(value->GetName());
+					vint result = symbols.Add(symbol);
+					indexes.Add(value, result);
+					return result;
+				}
+
+				void WriteSymbols(Writer& writer)
+				{
+					vint32_t magic = WfAssemblyMagic, version = WfAssembly::BinaryVersion;
+					writer << magic << version << strings << typeNames << methodSymbols << propertySymbols << eventSymbols;
+				}
+			};
+
+			// symbol tables are only complete after everything else is written
+			template<typename TCallback>
+			void WriteWithSymbols(stream::IStream& output, const TCallback& callback)
+			{
+				stream::MemoryStream body;
+				WfAssemblyWriter bodyWriter(body);
+				callback(bodyWriter);
+
+				Writer writer(output);
+				bodyWriter.WriteSymbols(writer);
+				vint size = (vint)body.Size();
+				if (size > 0 && output.Write(body.GetInternalBuffer(), size) != size)
+				{
+					CHECK_FAIL(L"Serialization failed.");
+				}
+			}
+
+/***********************************************************************
+Serialization
+***********************************************************************/
+
 			template<>
 			struct Serialization<ITypeDescriptor*>
 			{
 				static void IO(Reader& reader, ITypeDescriptor*& value)
 				{
-					WString id;
-					reader << id;
-					value = GetTypeDescriptor(id);
-					CHECK_ERROR(value, L"Failed to load type.");
+					vint index = -1;
+					reader << index;
+					auto& wfReader = static_cast<WfAssemblyReader&>(reader);
+					value = index == -1 ? nullptr : wfReader.GetSymbol(wfReader.types, index);
 				}
 					
 				static void IO(Writer& writer, ITypeDescriptor*& value)
 				{
-					WString id = value->GetTypeName();
-					writer << id;
+					vint index = value ? static_cast<WfAssemblyWriter&>(writer).AddType(value) : -1;
+					writer << index;
 				}
 			};
 
@@ -53,57 +290,16 @@ namespace vl
 			{
 				static void IO(Reader& reader, IMethodInfo*& value)
 				{
-					ITypeDescriptor* type = 0;
-					WString name;
-					List<WString> parameters;
-					reader << type << name << parameters;
-					auto group =
-						name == L"#ctor" ? type->GetConstructorGroup() :
-						type->GetMethodGroupByName(name, false);
-					CHECK_ERROR(group, L"Failed to load method.");
-
-					value = 0;
-					vint count = group->GetMethodCount();
-					for (vint i = 0; i < count; i++)
-					{
-						auto method = group->GetMethod(i);
-						if (method->GetParameterCount() == parameters.Count())
-						{
-							bool found = true;
-							for (vint j = 0; j < parameters.Count(); j++)
-							{
-								if (method->GetParameter(j)->GetName() != parameters[j])
-								{
-									found = false;
-									break;
-								}
-							}
-
-							if (found)
-							{
-								CHECK_ERROR(!value, L"Failed to load method.");
-								value = method;
-							}
-						}
-					}
-					CHECK_ERROR(value, L"Failed to load method.");
+					vint index = -1;
+					reader << index;
+					auto& wfReader = static_cast<WfAssemblyReader&>(reader);
+					value = index == -1 ? nullptr : wfReader.GetSymbol(wfReader.methods, index);
 				}
 					
 				static void IO(Writer& writer, IMethodInfo*& value)
 				{
-					auto type = value->GetOwnerTypeDescriptor();
-					WString name =
-						value->GetOwnerMethodGroup() == type->GetConstructorGroup() ? L"#ctor" :
-						value->GetName();
-					writer << type << name;
-
-					List<WString> parameters;
-					vint count = value->GetParameterCount();
-					for (vint i = 0; i < count; i++)
-					{
-						parameters.Add(value->GetParameter(i)->GetName());
-					}
-					writer << parameters;
+					vint index = value ? static_cast<WfAssemblyWriter&>(writer).AddMethod(value) : -1;
+					writer << index;
 				}
 			};
 
@@ -112,18 +308,17 @@ namespace vl
 			{
 				static void IO(Reader& reader, IPropertyInfo*& value)
 				{
-					ITypeDescriptor* type = 0;
-					WString name;
-					reader << type << name;
-					value = type->GetPropertyByName(name, false);
-					CHECK_ERROR(value, L"Failed to load property.");
+					vint index = -1;
+					reader << index;
+					auto& wfReader = static_cast<WfAssemblyReader&>(reader);
+					value = index == -1 ? nullptr : wfReader.GetSymbol(wfReader.properties, index);
 				}
 					
 				static void IO(Writer& writer, IPropertyInfo*& value)
 				{
-					auto type = value->GetOwnerTypeDescriptor();
-					WString name = value->GetName();
-					writer << type << name;
+					auto& wfWriter = static_cast<WfAssemblyWriter&>(writer);
+					vint index = value ? wfWriter.AddMember(value, wfWriter.propertyIndexes, wfWriter.propertySymbols) : -1;
+					writer << index;
 				}
 			};
 
@@ -132,70 +327,138 @@ namespace vl
 			{
 				static void IO(Reader& reader, IEventInfo*& value)
 				{
-					ITypeDescriptor* type = 0;
-					WString name;
-					reader << type << name;
-					value = type->GetEventByName(name, false);
-					CHECK_ERROR(value, L"Failed to load event.");
+					vint index = -1;
+					reader << index;
+					auto& wfReader = static_cast<WfAssemblyReader&>(reader);
+					value = index == -1 ? nullptr : wfReader.GetSymbol(wfReader.events, index);
 				}
 					
 				static void IO(Writer& writer, IEventInfo*& value)
 				{
-					auto type = value->GetOwnerTypeDescriptor();
-					WString name = value->GetName();
-					writer << type << name;
+					auto& wfWriter = static_cast<WfAssemblyWriter&>(writer);
+					vint index = value ? wfWriter.AddMember(value, wfWriter.eventIndexes, wfWriter.eventSymbols) : -1;
+					writer << index;
 				}
 			};
 
+			// a primitive value is stored as its WfInsType followed by 8 bytes, or a string index for WfInsType::String
+			const vint32_t								WfValueNull = -1;
+			const vint32_t								WfValueTypeDescriptor = -2;	// followed by a type index
+			const vint32_t								WfValueSerializable = -3;	// followed by a type index and a string index of the text
+
 			template<>
 			struct Serialization<Value>
 			{
 				static void IO(Reader& reader, Value& value)
 				{
-					WString id, text;
-					reader << id << text;
-					if (id == L"")
+					auto& wfReader = static_cast<WfAssemblyReader&>(reader);
+					vint32_t tag = WfValueNull;
+					reader << tag;
+					switch (tag)
 					{
+					case WfValueNull:
 						value = Value();
-					}
-					else
-					{
-						auto type = GetTypeDescriptor(id);
-						if (type == GetTypeDescriptor<ITypeDescriptor>())
+						break;
+					case WfValueTypeDescriptor:
 						{
-							type = GetTypeDescriptor(text);
-							CHECK_ERROR(type, L"Failed to load type.");
+							ITypeDescriptor* type = nullptr;
+							reader << type;
 							value = Value::From(type);
 						}
-						else
+						break;
+					case WfValueSerializable:
 						{
-							type->GetValueSerializer()->Parse(text, value);
+							ITypeDescriptor* type = nullptr;
+							vint text = -1;
+							reader << type << text;
+							if (!type || !type->GetValueSerializer() || !type->GetValueSerializer()->Parse(wfReader.GetSymbol(wfReader.strings, text), value))
+							{
+								CHECK_FAIL(L"Deserialization failed.");
+							}
+						}
+						break;
+					case (vint32_t)WfInsType::String:
+						{
+							vint text = -1;
+							reader << text;
+							value = Value::From(wfReader.GetSymbol(wfReader.strings, text), wfReader.primitiveTypes.typeDescriptors[tag]);
+						}
+						break;
+					default:
+						{
+							CHECK_ERROR(0 <= tag && tag < (vint32_t)WfInsType::String, L"Deserialization failed.");
+							WfRuntimeValue slot;
+							slot.type = (WfInsType)tag;
+							if (reader.input.Read(&slot.uintValue, sizeof(slot.uintValue)) != sizeof(slot.uintValue))
+							{
+								CHECK_FAIL(L"Deserialization failed.");
+							}
+							value = slot.ToValue(wfReader.primitiveTypes);
 						}
 					}
 				}
 					
 				static void IO(Writer& writer, Value& value)
 				{
-					WString id;
-					if (value.GetTypeDescriptor())
+					auto& wfWriter = static_cast<WfAssemblyWriter&>(writer);
+					auto slot = WfRuntimeValue::FromValue(value, wfWriter.primitiveTypes);
+					vint32_t tag = (vint32_t)slot.type;
+					switch (slot.type)
 					{
-						id = value.GetTypeDescriptor()->GetTypeName();
-					}
-					writer << id;
-
-					if (value.GetTypeDescriptor() == GetTypeDescriptor<ITypeDescriptor>())
-					{
-						WString text = UnboxValue<ITypeDescriptor*>(value)->GetTypeName();
-						writer << text;
-					}
-					else
-					{
-						WString text = value.GetText();
-						writer << text;
+					case WfInsType::Unknown:
+						if (value.IsNull())
+						{
+							tag = WfValueNull;
+							writer << tag;
+						}
+						else if (value.GetTypeDescriptor() == GetTypeDescriptor<ITypeDescriptor>())
+						{
+							tag = WfValueTypeDescriptor;
+							auto type = UnboxValue<ITypeDescriptor*>(value);
+							writer << tag << type;
+						}
+						else
+						{
+							tag = WfValueSerializable;
+							auto type = value.GetTypeDescriptor();
+							vint text = wfWriter.AddString(value.GetText());
+							writer << tag << type << text;
+						}
+						break;
+					case WfInsType::String:
+						{
+							vint text = wfWriter.AddString(value.GetText());
+							writer << tag << text;
+						}
+						break;
+					default:
+						{
+							writer << tag;
+							if (writer.output.Write(&slot.uintValue, sizeof(slot.uintValue)) != sizeof(slot.uintValue))
+							{
+								CHECK_FAIL(L"Serialization failed.");
+							}
+						}
 					}
 				}
 			};
 
+			BEGIN_SERIALIZATION(WfSwitchTable)
+				SERIALIZE(type)
+				SERIALIZE(keys)
+				SERIALIZE(labels)
+			END_SERIALIZATION
+
+			BEGIN_SERIALIZATION(WfConstantSet)
+				SERIALIZE(type)
+				SERIALIZE(keys)
+			END_SERIALIZATION
+
+			BEGIN_SERIALIZATION(WfMethodTable)
+				SERIALIZE(methods)
+				SERIALIZE(functions)
+			END_SERIALIZATION
+
 			template<>
 			struct Serialization<WfInstruction>
 			{
@@ -215,6 +478,13 @@ namespace vl
 #define STREAMIO_EVENT(NAME)				case WfInsCode::NAME: io << value.eventParameter; break;
 #define STREAMIO_LABEL(NAME)				case WfInsCode::NAME: io << value.indexParameter; break;
 #define STREAMIO_TYPE(NAME)					case WfInsCode::NAME: io << value.typeParameter; break;
+#define STREAMIO_VARIABLE_VARIABLE(NAME)	case WfInsCode::NAME: io << value.indexParameter << value.countParameter; break;
+#define STREAMIO_VARIABLE_VALUE(NAME)		case WfInsCode::NAME: io << value.indexParameter << value.valueParameter; break;
+#define STREAMIO_LABEL_TYPE(NAME)			case WfInsCode::NAME: io << value.indexParameter << value.typeParameter; break;
+#define STREAMIO_TABLE(NAME)				case WfInsCode::NAME: io << value.indexParameter; break;
+#define STREAMIO_METHOD_TABLE_COUNT(NAME)	case WfInsCode::NAME: io << value.indexParameter << value.countParameter; break;
+#define STREAMIO_CONSTANT_SET(NAME)			case WfInsCode::NAME: io << value.indexParameter; break;
+#define STREAMIO_SPECIALIZED(NAME, TYPE)	case WfInsCode::NAME##_##TYPE: value.typeParameter = WfInsType::TYPE; break;
 
 					switch (value.code)
 					{
@@ -230,7 +500,15 @@ namespace vl
 							STREAMIO_METHOD_COUNT,
 							STREAMIO_EVENT,
 							STREAMIO_LABEL,
-							STREAMIO_TYPE)
+							STREAMIO_TYPE,
+							STREAMIO_VARIABLE_VARIABLE,
+							STREAMIO_VARIABLE_VALUE,
+							STREAMIO_LABEL_TYPE,
+							STREAMIO_TABLE,
+							STREAMIO_METHOD_TABLE_COUNT,
+							STREAMIO_CONSTANT_SET,
+							STREAMIO_SPECIALIZED)
+						default:;
 					}
 
 #undef STREAMIO
@@ -245,6 +523,13 @@ namespace vl
 #undef STREAMIO_EVENT
 #undef STREAMIO_LABEL
 #undef STREAMIO_TYPE
+#undef STREAMIO_VARIABLE_VARIABLE
+#undef STREAMIO_VARIABLE_VALUE
+#undef STREAMIO_LABEL_TYPE
+#undef STREAMIO_TABLE
+#undef STREAMIO_METHOD_TABLE_COUNT
+#undef STREAMIO_CONSTANT_SET
+#undef STREAMIO_SPECIALIZED
 				}
 			};
 		}
@@ -266,6 +551,26 @@ WfInstruction
 
 			}
 
+			WfInsCode WfInstruction::GetSpecializedCode(WfInsCode code, WfInsType type)
+			{
+#define SPECIALIZE(NAME, TYPE)				if (code == WfInsCode::NAME && type == WfInsType::TYPE) return WfInsCode::NAME##_##TYPE;
+				INSTRUCTION_SPECIALIZED_CASES(SPECIALIZE)
+#undef SPECIALIZE
+				return code;
+			}
+
+			WfInsCode WfInstruction::GetGenericCode(WfInsCode code)
+			{
+				switch (code)
+				{
+#define GENERIC_CODE(NAME, TYPE)			case WfInsCode::NAME##_##TYPE: return WfInsCode::NAME;
+					INSTRUCTION_SPECIALIZED_CASES(GENERIC_CODE)
+#undef GENERIC_CODE
+				default:
+					return code;
+				}
+			}
+
 #define CTOR(NAME)\
 	WfInstruction WfInstruction::NAME()\
 			{\
@@ -369,13 +674,80 @@ WfInstruction
 
 #define CTOR_TYPE(NAME)\
 	WfInstruction WfInstruction::NAME(WfInsType type)\
+			{\
+			WfInstruction ins; \
+			ins.code = GetSpecializedCode(WfInsCode::NAME, type); \
+			ins.typeParameter = type; \
+			return ins; \
+			}\
+
+#define CTOR_VARIABLE_VARIABLE(NAME)\
+	WfInstruction WfInstruction::NAME(vint variable1, vint variable2)\
+			{\
+			WfInstruction ins; \
+			ins.code = WfInsCode::NAME; \
+			ins.indexParameter = variable1; \
+			ins.countParameter = variable2; \
+			return ins; \
+			}\
+
+#define CTOR_VARIABLE_VALUE(NAME)\
+	WfInstruction WfInstruction::NAME(vint variable, const reflection::description::Value& value)\
 			{\
 			WfInstruction ins; \
 			ins.code = WfInsCode::NAME; \
+			ins.indexParameter = variable; \
+			ins.valueParameter = value; \
+			return ins; \
+			}\
+
+#define CTOR_LABEL_TYPE(NAME)\
+	WfInstruction WfInstruction::NAME(vint label, WfInsType type)\
+			{\
+			WfInstruction ins; \
+			ins.code = WfInsCode::NAME; \
+			ins.indexParameter = label; \
 			ins.typeParameter = type; \
 			return ins; \
 			}\
 
+#define CTOR_TABLE(NAME)\
+	WfInstruction WfInstruction::NAME(vint table)\
+			{\
+			WfInstruction ins; \
+			ins.code = WfInsCode::NAME; \
+			ins.indexParameter = table; \
+			return ins; \
+			}\
+
+#define CTOR_METHOD_TABLE_COUNT(NAME)\
+	WfInstruction WfInstruction::NAME(vint methodTable, vint count)\
+			{\
+			WfInstruction ins; \
+			ins.code = WfInsCode::NAME; \
+			ins.indexParameter = methodTable; \
+			ins.countParameter = count; \
+			return ins; \
+			}\
+
+#define CTOR_CONSTANT_SET(NAME)\
+	WfInstruction WfInstruction::NAME(vint set)\
+			{\
+			WfInstruction ins; \
+			ins.code = WfInsCode::NAME; \
+			ins.indexParameter = set; \
+			return ins; \
+			}\
+
+#define CTOR_SPECIALIZED(NAME, TYPE)\
+	WfInstruction WfInstruction::NAME##_##TYPE()\
+			{\
+			WfInstruction ins; \
+			ins.code = WfInsCode::NAME##_##TYPE; \
+			ins.typeParameter = WfInsType::TYPE; \
+			return ins; \
+			}\
+
 			INSTRUCTION_CASES(
 				CTOR,
 				CTOR_VALUE,
@@ -388,7 +760,14 @@ WfInstruction
 				CTOR_METHOD_COUNT,
 				CTOR_EVENT,
 				CTOR_LABEL,
-				CTOR_TYPE)
+				CTOR_TYPE,
+				CTOR_VARIABLE_VARIABLE,
+				CTOR_VARIABLE_VALUE,
+				CTOR_LABEL_TYPE,
+				CTOR_TABLE,
+				CTOR_METHOD_TABLE_COUNT,
+				CTOR_CONSTANT_SET,
+				CTOR_SPECIALIZED)
 
 #undef CTOR
 #undef CTOR_VALUE
@@ -402,6 +781,13 @@ WfInstruction
 #undef CTOR_EVENT
 #undef CTOR_LABEL
 #undef CTOR_TYPE
+#undef CTOR_VARIABLE_VARIABLE
+#undef CTOR_VARIABLE_VALUE
+#undef CTOR_LABEL_TYPE
+#undef CTOR_TABLE
+#undef CTOR_METHOD_TABLE_COUNT
+#undef CTOR_CONSTANT_SET
+#undef CTOR_SPECIALIZED
 
 /***********************************************************************
 WfInstructionDebugInfo
@@ -411,63 +797,1085 @@ WfInstructionDebugInfo
 			{
 				for (vint i = 0; i < instructionCodeMapping.Count(); i++)
 				{
-					const auto& range = instructionCodeMapping[i];
-					if (range.codeIndex != -1)
+					const auto& range = instructionCodeMapping[i];
+					if (range.codeIndex != -1)
+					{
+						codeInstructionMapping.Add(Tuple<vint, vint>(range.codeIndex, range.start.row), i);
+					}
+				}
+			}
+
+/***********************************************************************
+WfAssembly
+***********************************************************************/
+
+			// debug informations are not written by IO, they are a separated section that is only deserialized on first use
+			const vint32_t										WfDebugInfoMagic = 0x42444657;	// "WFDB"
+
+			void CopyDebugInfo(stream::IStream& input, stream::IStream& output)
+			{
+				char buffer[1024];
+				while (vint length = input.Read(buffer, sizeof(buffer)))
+				{
+					if (output.Write(buffer, length) != length)
+					{
+						CHECK_FAIL(L"Serialization failed.");
+					}
+				}
+			}
+
+			template<typename TIO>
+			void WfAssembly::IO(TIO& io, bool withInstructions)
+			{
+				io
+					<< variableNames
+					<< functionByName
+					<< functions
+					;
+				if (withInstructions)
+				{
+					io << instructions;
+				}
+				io
+					<< switchTables
+					<< methodTables
+					<< constantSets
+					;
+			}
+
+			WfAssembly::WfAssembly()
+			{
+			}
+
+			WfAssembly::WfAssembly(stream::IStream& input)
+			{
+				stream::internal::WfAssemblyReader reader(input);
+				reader.ReadSymbols();
+				IO(reader);
+
+				auto debugInfo = MakePtr<stream::MemoryStream>();
+				stream::IStream& debugInfoStream = *debugInfo.Obj();
+				reader << debugInfoStream;
+				if (debugInfo->Size() > 0)
+				{
+					serializedDebugInfo = debugInfo;
+				}
+				Initialize();
+			}
+
+			void WfAssembly::Initialize()
+			{
+				if (insBeforeCodegen) insBeforeCodegen->Initialize();
+				if (insAfterCodegen) insAfterCodegen->Initialize();
+
+				verificationErrors.Clear();
+				if (!Verify(verificationErrors))
+				{
+					WString message = L"vl::workflow::runtime::WfAssembly::Initialize()#The assembly failed the verification.";
+					FOREACH(WString, error, verificationErrors)
+					{
+						message += L"\r\n" + error;
+					}
+					throw WfRuntimeException(message, true);
+				}
+			}
+
+			void WfAssembly::Serialize(stream::IStream& output, bool withDebugInfo)
+			{
+				stream::internal::WriteWithSymbols(output, [&](stream::internal::WfAssemblyWriter& writer)
+				{
+					IO(writer);
+				});
+
+				stream::MemoryStream debugInfo;
+				if (withDebugInfo)
+				{
+					SerializeDebugInfo(debugInfo);
+				}
+				stream::internal::Writer writer(output);
+				stream::IStream& debugInfoStream = debugInfo;
+				writer << debugInfoStream;
+			}
+
+			Ptr<WfInstructionDebugInfo> WfAssembly::GetDebugInfo(bool beforeCodegen)
+			{
+				CS_LOCK(debugInfoLock)
+				{
+					if (serializedDebugInfo)
+					{
+						serializedDebugInfo->SeekFromBegin(0);
+						stream::internal::Reader reader(*serializedDebugInfo.Obj());
+						vint32_t magic = 0, version = 0;
+						reader << magic << version;
+
+						// this function is called when reporting exceptions, so incompatible debug informations are ignored instead of raising another error
+						if (magic == WfDebugInfoMagic && version == BinaryVersion)
+						{
+							reader << insBeforeCodegen << insAfterCodegen;
+							if (insBeforeCodegen) insBeforeCodegen->Initialize();
+							if (insAfterCodegen) insAfterCodegen->Initialize();
+						}
+						serializedDebugInfo = nullptr;
+					}
+					return beforeCodegen ? insBeforeCodegen : insAfterCodegen;
+				}
+				return nullptr;
+			}
+
+			void WfAssembly::SerializeDebugInfo(stream::IStream& output)
+			{
+				CS_LOCK(debugInfoLock)
+				{
+					if (serializedDebugInfo)
+					{
+						serializedDebugInfo->SeekFromBegin(0);
+						CopyDebugInfo(*serializedDebugInfo.Obj(), output);
+					}
+					else if (insBeforeCodegen || insAfterCodegen)
+					{
+						stream::internal::Writer writer(output);
+						vint32_t magic = WfDebugInfoMagic, version = BinaryVersion;
+						writer << magic << version << insBeforeCodegen << insAfterCodegen;
+					}
+				}
+			}
+
+			void WfAssembly::AttachDebugInfo(stream::IStream& input)
+			{
+				auto debugInfo = MakePtr<stream::MemoryStream>();
+				CopyDebugInfo(input, *debugInfo.Obj());
+				CS_LOCK(debugInfoLock)
+				{
+					serializedDebugInfo = debugInfo->Size() > 0 ? debugInfo : nullptr;
+					insBeforeCodegen = nullptr;
+					insAfterCodegen = nullptr;
+				}
+			}
+
+			void WfAssembly::StripDebugInfo()
+			{
+				CS_LOCK(debugInfoLock)
+				{
+					serializedDebugInfo = nullptr;
+					insBeforeCodegen = nullptr;
+					insAfterCodegen = nullptr;
+				}
+			}
+
+/***********************************************************************
+WfRuntimePrimitiveTypes
+***********************************************************************/
+
+			WfRuntimePrimitiveTypes::WfRuntimePrimitiveTypes()
+			{
+				typeDescriptors[(vint)WfInsType::Bool] = GetTypeDescriptor<bool>();
+				typeDescriptors[(vint)WfInsType::I1] = GetTypeDescriptor<vint8_t>();
+				typeDescriptors[(vint)WfInsType::I2] = GetTypeDescriptor<vint16_t>();
+				typeDescriptors[(vint)WfInsType::I4] = GetTypeDescriptor<vint32_t>();
+				typeDescriptors[(vint)WfInsType::I8] = GetTypeDescriptor<vint64_t>();
+				typeDescriptors[(vint)WfInsType::U1] = GetTypeDescriptor<vuint8_t>();
+				typeDescriptors[(vint)WfInsType::U2] = GetTypeDescriptor<vuint16_t>();
+				typeDescriptors[(vint)WfInsType::U4] = GetTypeDescriptor<vuint32_t>();
+				typeDescriptors[(vint)WfInsType::U8] = GetTypeDescriptor<vuint64_t>();
+				typeDescriptors[(vint)WfInsType::F4] = GetTypeDescriptor<float>();
+				typeDescriptors[(vint)WfInsType::F8] = GetTypeDescriptor<double>();
+				typeDescriptors[(vint)WfInsType::String] = GetTypeDescriptor<WString>();
+			}
+
+			WfInsType WfRuntimePrimitiveTypes::GetInsType(reflection::description::ITypeDescriptor* typeDescriptor)const
+			{
+				if (typeDescriptor)
+				{
+					for (vint i = 0; i < (vint)WfInsType::Unknown; i++)
+					{
+						if (typeDescriptors[i] == typeDescriptor)
+						{
+							return (WfInsType)i;
+						}
+					}
+				}
+				return WfInsType::Unknown;
+			}
+
+/***********************************************************************
+WfRuntimeValue
+***********************************************************************/
+
+			template<typename T>
+			bool DeserializeRuntimeValue(const WString& text, WfRuntimeValue& slot)
+			{
+				T value;
+				if (!TypedValueSerializerProvider<T>::Deserialize(text, value))
+				{
+					return false;
+				}
+				slot = WfRuntimeValue::From(value);
+				return true;
+			}
+
+			template<typename T>
+			Value SerializeRuntimeValue(const WfRuntimeValue& slot, const WfRuntimePrimitiveTypes& types)
+			{
+				WString text;
+				TypedValueSerializerProvider<T>::Serialize(WfRuntimeValueStorage<T>::Read(slot), text);
+				return Value::From(text, types.typeDescriptors[(vint)slot.type]);
+			}
+
+			bool WfRuntimeValue::IsNull()const
+			{
+				return type == WfInsType::Unknown && boxedValue.IsNull();
+			}
+
+			WfRuntimeValue WfRuntimeValue::From(const WString& value, const WfRuntimePrimitiveTypes& types)
+			{
+				WfRuntimeValue slot;
+				slot.type = WfInsType::String;
+				slot.boxedValue = Value::From(value, types.typeDescriptors[(vint)WfInsType::String]);
+				return slot;
+			}
+
+			WfRuntimeValue WfRuntimeValue::FromValue(const reflection::description::Value& value, const WfRuntimePrimitiveTypes& types)
+			{
+				WfRuntimeValue slot;
+				if (value.GetValueType() == Value::Text)
+				{
+					const auto& text = value.GetText();
+					switch (types.GetInsType(value.GetTypeDescriptor()))
+					{
+					case WfInsType::Bool:
+						if (text == L"true" || text == L"false")
+						{
+							return From(text == L"true");
+						}
+						break;
+					case WfInsType::I1:
+						if (DeserializeRuntimeValue<vint8_t>(text, slot)) return slot;
+						break;
+					case WfInsType::I2:
+						if (DeserializeRuntimeValue<vint16_t>(text, slot)) return slot;
+						break;
+					case WfInsType::I4:
+						if (DeserializeRuntimeValue<vint32_t>(text, slot)) return slot;
+						break;
+					case WfInsType::I8:
+						if (DeserializeRuntimeValue<vint64_t>(text, slot)) return slot;
+						break;
+					case WfInsType::U1:
+						if (DeserializeRuntimeValue<vuint8_t>(text, slot)) return slot;
+						break;
+					case WfInsType::U2:
+						if (DeserializeRuntimeValue<vuint16_t>(text, slot)) return slot;
+						break;
+					case WfInsType::U4:
+						if (DeserializeRuntimeValue<vuint32_t>(text, slot)) return slot;
+						break;
+					case WfInsType::U8:
+						if (DeserializeRuntimeValue<vuint64_t>(text, slot)) return slot;
+						break;
+					case WfInsType::F4:
+						if (DeserializeRuntimeValue<float>(text, slot)) return slot;
+						break;
+					case WfInsType::F8:
+						if (DeserializeRuntimeValue<double>(text, slot)) return slot;
+						break;
+					case WfInsType::String:
+						slot.type = WfInsType::String;
+						break;
+					default:;
+					}
+				}
+				slot.boxedValue = value;
+				return slot;
+			}
+
+			reflection::description::Value WfRuntimeValue::ToValue()const
+			{
+				switch (type)
+				{
+				case WfInsType::Bool:	return BoxValue<bool>(boolValue);
+				case WfInsType::I1:		return BoxValue<vint8_t>(Get<vint8_t>());
+				case WfInsType::I2:		return BoxValue<vint16_t>(Get<vint16_t>());
+				case WfInsType::I4:		return BoxValue<vint32_t>(Get<vint32_t>());
+				case WfInsType::I8:		return BoxValue<vint64_t>(Get<vint64_t>());
+				case WfInsType::U1:		return BoxValue<vuint8_t>(Get<vuint8_t>());
+				case WfInsType::U2:		return BoxValue<vuint16_t>(Get<vuint16_t>());
+				case WfInsType::U4:		return BoxValue<vuint32_t>(Get<vuint32_t>());
+				case WfInsType::U8:		return BoxValue<vuint64_t>(Get<vuint64_t>());
+				case WfInsType::F4:		return BoxValue<float>(Get<float>());
+				case WfInsType::F8:		return BoxValue<double>(Get<double>());
+				default:				return boxedValue;
+				}
+			}
+
+			reflection::description::Value WfRuntimeValue::ToValue(const WfRuntimePrimitiveTypes& types)const
+			{
+				switch (type)
+				{
+				case WfInsType::Bool:	return Value::From(boolValue ? L"true" : L"false", types.typeDescriptors[(vint)WfInsType::Bool]);
+				case WfInsType::I1:		return SerializeRuntimeValue<vint8_t>(*this, types);
+				case WfInsType::I2:		return SerializeRuntimeValue<vint16_t>(*this, types);
+				case WfInsType::I4:		return SerializeRuntimeValue<vint32_t>(*this, types);
+				case WfInsType::I8:		return SerializeRuntimeValue<vint64_t>(*this, types);
+				case WfInsType::U1:		return SerializeRuntimeValue<vuint8_t>(*this, types);
+				case WfInsType::U2:		return SerializeRuntimeValue<vuint16_t>(*this, types);
+				case WfInsType::U4:		return SerializeRuntimeValue<vuint32_t>(*this, types);
+				case WfInsType::U8:		return SerializeRuntimeValue<vuint64_t>(*this, types);
+				case WfInsType::F4:		return SerializeRuntimeValue<float>(*this, types);
+				case WfInsType::F8:		return SerializeRuntimeValue<double>(*this, types);
+				default:				return boxedValue;
+				}
+			}
+
+/***********************************************************************
+WfRuntimeSwitchTable
+***********************************************************************/
+
+			bool GetSwitchTableKey(const WfRuntimeValue& value, vuint64_t& key)
+			{
+				switch (value.type)
+				{
+				case WfInsType::I1:
+				case WfInsType::I2:
+				case WfInsType::I4:
+				case WfInsType::I8:
+					key = (vuint64_t)value.intValue;
+					return true;
+				case WfInsType::U1:
+				case WfInsType::U2:
+				case WfInsType::U4:
+				case WfInsType::U8:
+					key = value.uintValue;
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			vint WfRuntimeSwitchTable::FindIntegerKey(vuint64_t key)const
+			{
+				if (buckets.Count() == 0) return -1;
+				vint mask = buckets.Count() - 1;
+				vint slot = (vint)(WfRuntimeHashMap::GetHash(key) & (vuint64_t)mask);
+				while (true)
+				{
+					vint index = buckets[slot];
+					if (index == -1 || integerKeys[index] == key) return index;
+					slot = (slot + 1) & mask;
+				}
+			}
+
+			vint WfRuntimeSwitchTable::FindStringKey(const WString& key)const
+			{
+				if (buckets.Count() == 0) return -1;
+				vint mask = buckets.Count() - 1;
+				vint slot = (vint)(WfRuntimeHashMap::GetHash(key) & (vuint64_t)mask);
+				while (true)
+				{
+					vint index = buckets[slot];
+					if (index == -1 || stringKeys[index] == key) return index;
+					slot = (slot + 1) & mask;
+				}
+			}
+
+			void WfRuntimeSwitchTable::AddBucket(vuint64_t hash, vint index)
+			{
+				vint mask = buckets.Count() - 1;
+				vint slot = (vint)(hash & (vuint64_t)mask);
+				while (buckets[slot] != -1)
+				{
+					slot = (slot + 1) & mask;
+				}
+				buckets[slot] = (vint32_t)index;
+			}
+
+			void WfRuntimeSwitchTable::AddKeys(const collections::List<reflection::description::Value>& keys, const collections::List<vint>* labels, const WfRuntimePrimitiveTypes& types)
+			{
+				// keep at least half of the slots empty, the first label of duplicated keys is used
+				vint bucketCount = 16;
+				while (bucketCount < keys.Count() * 2)
+				{
+					bucketCount *= 2;
+				}
+				buckets.Resize(bucketCount);
+				for (vint i = 0; i < buckets.Count(); i++)
+				{
+					buckets[i] = -1;
+				}
+
+				if (type == WfInsType::String)
+				{
+					FOREACH_INDEXER(Value, key, index, keys)
+					{
+						auto& text = key.GetText();
+						if (FindStringKey(text) == -1)
+						{
+							AddBucket(WfRuntimeHashMap::GetHash(text), stringKeys.Add(text));
+							hashedLabels.Add(labels ? (vint32_t)labels->Get(index) : 0);
+						}
+					}
+					return;
+				}
+
+				bool isSigned = type == WfInsType::I1 || type == WfInsType::I2 || type == WfInsType::I4 || type == WfInsType::I8;
+				vuint64_t minKey = 0, maxKey = 0;
+				FOREACH_INDEXER(Value, value, index, keys)
+				{
+					vuint64_t key = 0;
+					auto slot = WfRuntimeValue::FromValue(value, types);
+					if (slot.type == type && GetSwitchTableKey(slot, key) && FindIntegerKey(key) == -1)
+					{
+						AddBucket(WfRuntimeHashMap::GetHash(key), integerKeys.Add(key));
+						hashedLabels.Add(labels ? (vint32_t)labels->Get(index) : 0);
+						if (integerKeys.Count() == 1)
+						{
+							minKey = key;
+							maxKey = key;
+						}
+						else if (isSigned)
+						{
+							if ((vint64_t)key < (vint64_t)minKey) minKey = key;
+							if ((vint64_t)key > (vint64_t)maxKey) maxKey = key;
+						}
+						else
+						{
+							if (key < minKey) minKey = key;
+							if (key > maxKey) maxKey = key;
+						}
+					}
+				}
+
+				// keys are dense when at least half of the slots in the array are used
+				vint count = integerKeys.Count();
+				if (count > 0 && maxKey - minKey < (vuint64_t)count * 2)
+				{
+					firstKey = minKey;
+					denseLabels.Resize((vint)(maxKey - minKey + 1));
+					for (vint i = 0; i < denseLabels.Count(); i++)
+					{
+						denseLabels[i] = -1;
+					}
+					for (vint i = 0; i < count; i++)
+					{
+						denseLabels[(vint)(integerKeys[i] - minKey)] = hashedLabels[i];
+					}
+					integerKeys.Clear();
+					hashedLabels.Clear();
+					buckets.Resize(0);
+				}
+			}
+
+			WfRuntimeSwitchTable::WfRuntimeSwitchTable(WfSwitchTable* table, const WfRuntimePrimitiveTypes& types)
+				:type(table->type)
+			{
+				AddKeys(table->keys, &table->labels, types);
+			}
+
+			WfRuntimeSwitchTable::WfRuntimeSwitchTable(WfConstantSet* set, const WfRuntimePrimitiveTypes& types)
+				:type(set->type)
+			{
+				AddKeys(set->keys, nullptr, types);
+			}
+
+			vint WfRuntimeSwitchTable::FindLabel(const WfRuntimeValue& value, const WfRuntimePrimitiveTypes& types)const
+			{
+				if (value.type != type)
+				{
+					// values that are not stored in the expected type are converted before looking up
+					auto converted = WfRuntimeValue::FromValue(value.ToValue(types), types);
+					if (converted.type != type)
+					{
+						return -1;
+					}
+					return FindLabel(converted, types);
+				}
+
+				if (type == WfInsType::String)
+				{
+					vint index = FindStringKey(value.boxedValue.GetText());
+					return index == -1 ? -1 : hashedLabels[index];
+				}
+
+				vuint64_t key = 0;
+				if (!GetSwitchTableKey(value, key))
+				{
+					return -1;
+				}
+				if (denseLabels.Count() > 0)
+				{
+					vuint64_t offset = key - firstKey;
+					return offset < (vuint64_t)denseLabels.Count() ? denseLabels[(vint)offset] : -1;
+				}
+				vint index = FindIntegerKey(key);
+				return index == -1 ? -1 : hashedLabels[index];
+			}
+
+/***********************************************************************
+WfRuntimeMethodTable
+***********************************************************************/
+
+			WfRuntimeMethodTable::WfRuntimeMethodTable(WfMethodTable* table)
+			{
+				slots.Resize(table->methods.Count());
+				for (vint i = 0; i < slots.Count(); i++)
+				{
+					auto& slot = slots[i];
+					slot.table = this;
+					slot.methodInfo = table->methods[i];
+					slot.functionIndex = table->functions[i];
+					slotsByMethod.Add(slot.methodInfo, i);
+
+					// interface proxies only pass the method name, the first method wins
+					if (!slotsByName.Keys().Contains(slot.methodInfo->GetName()))
 					{
-						codeInstructionMapping.Add(Tuple<vint, vint>(range.codeIndex, range.start.row), i);
+						slotsByName.Add(slot.methodInfo->GetName(), i);
 					}
 				}
 			}
 
+			const WfRuntimeMethodSlot* WfRuntimeMethodTable::FindSlot(IMethodInfo* methodInfo)const
+			{
+				vint index = slotsByMethod.Keys().IndexOf(methodInfo);
+				return index == -1 ? nullptr : &slots[slotsByMethod.Values()[index]];
+			}
+
 /***********************************************************************
-WfAssembly
+WfRuntimeMethodThunk
 ***********************************************************************/
 
-			template<typename TIO>
-			void WfAssembly::IO(TIO& io)
+			WfRuntimeValue ThunkReadonlyListGetCount(DescriptableObject* thisObject, WfRuntimeValue* arguments, const WfRuntimePrimitiveTypes& types)
 			{
-				io
-					<< insBeforeCodegen
-					<< insAfterCodegen
-					<< variableNames
-					<< functionByName
-					<< functions
-					<< instructions
-					;
+				auto list = dynamic_cast<IValueReadonlyList*>(thisObject);
+				return WfRuntimeValue::From<vint>(list->GetCount());
 			}
 
-			WfAssembly::WfAssembly()
+			WfRuntimeValue ThunkReadonlyListGet(DescriptableObject* thisObject, WfRuntimeValue* arguments, const WfRuntimePrimitiveTypes& types)
 			{
+				auto list = dynamic_cast<IValueReadonlyList*>(thisObject);
+				return WfRuntimeValue::FromValue(list->Get(arguments[0].Get<vint>()), types);
 			}
 
-			WfAssembly::WfAssembly(stream::IStream& input)
+			WfRuntimeValue ThunkListSet(DescriptableObject* thisObject, WfRuntimeValue* arguments, const WfRuntimePrimitiveTypes& types)
 			{
-				stream::internal::Reader reader(input);
-				IO(reader);
-				Initialize();
+				auto list = dynamic_cast<IValueList*>(thisObject);
+				list->Set(arguments[0].Get<vint>(), arguments[1].ToValue(types));
+				return WfRuntimeValue();
 			}
 
-			void WfAssembly::Initialize()
+			WfRuntimeValue ThunkListAdd(DescriptableObject* thisObject, WfRuntimeValue* arguments, const WfRuntimePrimitiveTypes& types)
 			{
-				insBeforeCodegen->Initialize();
-				insAfterCodegen->Initialize();
+				auto list = dynamic_cast<IValueList*>(thisObject);
+				return WfRuntimeValue::From<vint>(list->Add(arguments[0].ToValue(types)));
 			}
 
-			void WfAssembly::Serialize(stream::IStream& output)
+			WfRuntimeMethodThunk GetMethodThunk(IMethodInfo* methodInfo)
 			{
-				stream::internal::Writer writer(output);
-				IO(writer);
+				if (methodInfo->IsStatic())
+				{
+					return nullptr;
+				}
+
+				auto td = methodInfo->GetOwnerTypeDescriptor();
+				auto& name = methodInfo->GetName();
+				vint count = methodInfo->GetParameterCount();
+				if (td == description::GetTypeDescriptor<IValueReadonlyList>())
+				{
+					if (name == L"GetCount" && count == 0) return &ThunkReadonlyListGetCount;
+					if (name == L"Get" && count == 1) return &ThunkReadonlyListGet;
+				}
+				else if (td == description::GetTypeDescriptor<IValueList>())
+				{
+					if (name == L"Set" && count == 2) return &ThunkListSet;
+					if (name == L"Add" && count == 1) return &ThunkListAdd;
+				}
+				return nullptr;
+			}
+
+/***********************************************************************
+WfRuntimeInstructionArray
+***********************************************************************/
+
+			WfRuntimeInstruction* WfRuntimeInstructionArray::Allocate(vint _count)
+			{
+				ownedInstructions.Resize(_count);
+				auto result = _count == 0 ? nullptr : &ownedInstructions[0];
+				buffer = result;
+				count = _count;
+				return result;
+			}
+
+			void WfRuntimeInstructionArray::Attach(const WfRuntimeInstruction* _buffer, vint _count)
+			{
+				ownedInstructions.Resize(0);
+				buffer = _buffer;
+				count = _count;
 			}
 
 /***********************************************************************
 WfRuntimeGlobalContext
 ***********************************************************************/
 
-			WfRuntimeGlobalContext::WfRuntimeGlobalContext(Ptr<WfAssembly> _assembly)
-				:assembly(_assembly)
+			template<typename T>
+			vint32_t AddRuntimeTableItem(List<T*>& items, Dictionary<T*, vint>& indices, T* item)
+			{
+				vint index = indices.Keys().IndexOf(item);
+				if (index == -1)
+				{
+					index = items.Add(item);
+					indices.Add(item, index);
+					return (vint32_t)index;
+				}
+				return (vint32_t)indices.Values()[index];
+			}
+
+			// every call site has its own inline cache
+			WfRuntimeCallSite CreateRuntimeCallSite(IMethodInfo* methodInfo, IPropertyInfo* propertyInfo)
+			{
+				WfRuntimeCallSite callSite;
+				callSite.propertyInfo = propertyInfo;
+				if (propertyInfo)
+				{
+					// only properties implemented by a getter are read by calling the getter
+					if (dynamic_cast<PropertyInfoImpl*>(propertyInfo))
+					{
+						methodInfo = propertyInfo->GetGetter();
+					}
+				}
+				if (methodInfo)
+				{
+					callSite.methodInfo = methodInfo;
+					callSite.uncheckedMethod = dynamic_cast<MethodInfoImpl*>(methodInfo);
+					callSite.thunk = GetMethodThunk(methodInfo);
+
+					bool acceptProxy = false;
+					callSite.proxyMethod = !methodInfo->IsStatic() && IsInterfaceType(methodInfo->GetOwnerTypeDescriptor(), acceptProxy) && acceptProxy;
+				}
+				return callSite;
+			}
+
+			WfRuntimeFastInsCode GetRuntimeFastCode(WfInsCode code)
+			{
+				switch (code)
+				{
+#define DECODE(NAME)					case WfInsCode::NAME: return WfRuntimeFastInsCode::NAME;
+#define DECODE_SPECIALIZED(NAME, TYPE)	case WfInsCode::NAME##_##TYPE: return WfRuntimeFastInsCode::NAME##_##TYPE;
+					RUNTIME_FAST_INSTRUCTION_CASES(DECODE, DECODE_SPECIALIZED)
+#undef DECODE
+#undef DECODE_SPECIALIZED
+				default:
+					return WfRuntimeFastInsCode::Generic;
+				}
+			}
+
+			void WfRuntimeGlobalContext::InitializeTables()
 			{
 				globalVariables = new WfRuntimeVariableContext;
 				globalVariables->variables.Resize(assembly->variableNames.Count());
+
+				FOREACH(Ptr<WfSwitchTable>, table, assembly->switchTables)
+				{
+					switchTables.Add(new WfRuntimeSwitchTable(table.Obj(), primitiveTypes));
+				}
+
+				FOREACH(Ptr<WfMethodTable>, table, assembly->methodTables)
+				{
+					methodTables.Add(new WfRuntimeMethodTable(table.Obj()));
+				}
+
+				FOREACH(Ptr<WfConstantSet>, set, assembly->constantSets)
+				{
+					constantSets.Add(new WfRuntimeSwitchTable(set.Obj(), primitiveTypes));
+				}
+			}
+
+			WfRuntimeGlobalContext::WfRuntimeGlobalContext(Ptr<WfAssembly> _assembly)
+				:assembly(_assembly)
+			{
+				InitializeTables();
+
+				// null and serializable constants are shared by all LoadValue instructions with the same value
+				Dictionary<Pair<ITypeDescriptor*, WString>, vint> constantIndices;
+				Dictionary<ITypeDescriptor*, vint> typeDescriptorIndices;
+				Dictionary<IEventInfo*, vint> eventIndices;
+
+				auto addConstant = [&](const Value& value)->vint32_t
+				{
+					if (value.GetValueType() != Value::Null && value.GetValueType() != Value::Text)
+					{
+						return (vint32_t)constants.Add(WfRuntimeValue::FromValue(value, primitiveTypes));
+					}
+
+					Pair<ITypeDescriptor*, WString> key(value.GetTypeDescriptor(), value.GetText());
+					vint index = constantIndices.Keys().IndexOf(key);
+					if (index == -1)
+					{
+						index = constants.Add(WfRuntimeValue::FromValue(value, primitiveTypes));
+						constantIndices.Add(key, index);
+						return (vint32_t)index;
+					}
+					return (vint32_t)constantIndices.Values()[index];
+				};
+
+				auto addCallSite = [&](IMethodInfo* methodInfo, IPropertyInfo* propertyInfo)->vint32_t
+				{
+					return (vint32_t)callSites.Add(CreateRuntimeCallSite(methodInfo, propertyInfo));
+				};
+
+				functions.Resize(assembly->functions.Count());
+				for (vint i = 0; i < functions.Count(); i++)
+				{
+					auto meta = assembly->functions[i];
+					auto& function = functions[i];
+					function.firstInstruction = meta->firstInstruction;
+					function.argumentCount = meta->argumentNames.Count();
+					function.capturedVariableCount = meta->capturedVariableNames.Count();
+					function.localVariableCount = meta->localVariableNames.Count();
+					function.maxStackDepth = meta->maxStackDepth;
+				}
+
+				auto packedInstructions = instructions.Allocate(assembly->instructions.Count());
+				for (vint i = 0; i < instructions.Count(); i++)
+				{
+					auto& ins = assembly->instructions[i];
+					auto& packed = packedInstructions[i];
+					packed.code = ins.code;
+
+#define DECODE(NAME)						case WfInsCode::NAME: break;
+#define DECODE_VALUE(NAME)					case WfInsCode::NAME: packed.indexParameter = addConstant(ins.valueParameter); break;
+#define DECODE_FUNCTION(NAME)				case WfInsCode::NAME: packed.indexParameter = (vint32_t)ins.indexParameter; break;
+#define DECODE_FUNCTION_COUNT(NAME)			case WfInsCode::NAME: packed.indexParameter = (vint32_t)ins.indexParameter; packed.countParameter = (vint32_t)ins.countParameter; break;
+#define DECODE_VARIABLE(NAME)				case WfInsCode::NAME: packed.indexParameter = (vint32_t)ins.indexParameter; break;
+#define DECODE_COUNT(NAME)					case WfInsCode::NAME: packed.countParameter = (vint32_t)ins.countParameter; break;
+#define DECODE_FLAG_TYPEDESCRIPTOR(NAME)	case WfInsCode::NAME: packed.flagParameter = (vuint8_t)ins.flagParameter; packed.indexParameter = AddRuntimeTableItem(typeDescriptors, typeDescriptorIndices, ins.typeDescriptorParameter); break;
+#define DECODE_PROPERTY(NAME)				case WfInsCode::NAME: packed.indexParameter = addCallSite(nullptr, ins.propertyParameter); break;
+#define DECODE_METHOD_COUNT(NAME)			case WfInsCode::NAME: packed.indexParameter = addCallSite(ins.methodParameter, nullptr); packed.countParameter = (vint32_t)ins.countParameter; break;
+#define DECODE_EVENT(NAME)					case WfInsCode::NAME: packed.indexParameter = AddRuntimeTableItem(events, eventIndices, ins.eventParameter); break;
+#define DECODE_LABEL(NAME)					case WfInsCode::NAME: packed.indexParameter = (vint32_t)ins.indexParameter; break;
+#define DECODE_TYPE(NAME)					case WfInsCode::NAME: break;
+#define DECODE_VARIABLE_VARIABLE(NAME)		case WfInsCode::NAME: packed.indexParameter = (vint32_t)ins.indexParameter; packed.countParameter = (vint32_t)ins.countParameter; break;
+#define DECODE_VARIABLE_VALUE(NAME)			case WfInsCode::NAME: packed.indexParameter = (vint32_t)ins.indexParameter; packed.countParameter = addConstant(ins.valueParameter); packed.flagParameter = (vuint8_t)constants[packed.countParameter].type; break;
+#define DECODE_LABEL_TYPE(NAME)				case WfInsCode::NAME: packed.indexParameter = (vint32_t)ins.indexParameter; packed.flagParameter = (vuint8_t)ins.typeParameter; break;
+#define DECODE_TABLE(NAME)					case WfInsCode::NAME: packed.indexParameter = (vint32_t)ins.indexParameter; break;
+#define DECODE_METHOD_TABLE_COUNT(NAME)		case WfInsCode::NAME: packed.indexParameter = (vint32_t)ins.indexParameter; packed.countParameter = (vint32_t)ins.countParameter; break;
+#define DECODE_CONSTANT_SET(NAME)			case WfInsCode::NAME: packed.indexParameter = (vint32_t)ins.indexParameter; break;
+#define DECODE_SPECIALIZED(NAME, TYPE)		case WfInsCode::NAME##_##TYPE: break;
+
+					switch (ins.code)
+					{
+						INSTRUCTION_CASES(
+							DECODE,
+							DECODE_VALUE,
+							DECODE_FUNCTION,
+							DECODE_FUNCTION_COUNT,
+							DECODE_VARIABLE,
+							DECODE_COUNT,
+							DECODE_FLAG_TYPEDESCRIPTOR,
+							DECODE_PROPERTY,
+							DECODE_METHOD_COUNT,
+							DECODE_EVENT,
+							DECODE_LABEL,
+							DECODE_TYPE,
+							DECODE_VARIABLE_VARIABLE,
+							DECODE_VARIABLE_VALUE,
+							DECODE_LABEL_TYPE,
+							DECODE_TABLE,
+							DECODE_METHOD_TABLE_COUNT,
+							DECODE_CONSTANT_SET,
+							DECODE_SPECIALIZED)
+					default:;
+					}
+
+#undef DECODE
+#undef DECODE_VALUE
+#undef DECODE_FUNCTION
+#undef DECODE_FUNCTION_COUNT
+#undef DECODE_VARIABLE
+#undef DECODE_COUNT
+#undef DECODE_FLAG_TYPEDESCRIPTOR
+#undef DECODE_PROPERTY
+#undef DECODE_METHOD_COUNT
+#undef DECODE_EVENT
+#undef DECODE_LABEL
+#undef DECODE_TYPE
+#undef DECODE_VARIABLE_VARIABLE
+#undef DECODE_VARIABLE_VALUE
+#undef DECODE_LABEL_TYPE
+#undef DECODE_TABLE
+#undef DECODE_METHOD_TABLE_COUNT
+#undef DECODE_CONSTANT_SET
+#undef DECODE_SPECIALIZED
+
+					// only verified instructions are executed without checking the stack and variable indexes
+					if (assembly->verified)
+					{
+						packed.fastCode = GetRuntimeFastCode(ins.code);
+					}
+				}
+			}
+
+			WfRuntimeGlobalContext::WfRuntimeGlobalContext(Ptr<WfAssemblyImage> _image)
+				:assembly(_image->assembly)
+				, image(_image)
+			{
+				InitializeTables();
+
+				functions.Resize(assembly->functions.Count());
+				for (vint i = 0; i < functions.Count(); i++)
+				{
+					functions[i] = image->functions[i];
+				}
+
+				FOREACH(Value, value, image->constants)
+				{
+					constants.Add(WfRuntimeValue::FromValue(value, primitiveTypes));
+				}
+				CopyFrom(typeDescriptors, image->typeDescriptors);
+				FOREACH_INDEXER(IMethodInfo*, methodInfo, index, image->callSiteMethods)
+				{
+					callSites.Add(CreateRuntimeCallSite(methodInfo, image->callSiteProperties[index]));
+				}
+				CopyFrom(events, image->events);
+
+				instructions.Attach(image->instructions, image->instructionCount);
+			}
+
+/***********************************************************************
+WfAssemblyImage
+***********************************************************************/
+
+			// an image is a header followed by packed instructions, stack frame layouts and serialized metadata, each section is aligned to 8 bytes
+			struct WfAssemblyImageHeader
+			{
+				vint32_t										magic;
+				vint32_t										version;
+				vint32_t										instructionSize;
+				vint32_t										functionSize;
+				vint64_t										instructionOffset;
+				vint64_t										instructionCount;
+				vint64_t										functionOffset;
+				vint64_t										functionCount;
+				vint64_t										metadataOffset;
+				vint64_t										metadataSize;
+			};
+
+			const vint32_t										WfAssemblyImageMagic = 0x4D494657;	// "WFIM"
+			const vint64_t										WfAssemblyImageAlignment = 8;
+
+			vint64_t AlignImageSection(vint64_t offset)
+			{
+				return (offset + WfAssemblyImageAlignment - 1) / WfAssemblyImageAlignment * WfAssemblyImageAlignment;
+			}
+
+			WfAssemblyImage::WfAssemblyImage(const void* buffer, vint size)
+			{
+				auto bytes = (const char*)buffer;
+				CHECK_ERROR(size >= (vint)sizeof(WfAssemblyImageHeader), L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The data is not an assembly image.");
+				CHECK_ERROR((size_t)bytes % WfAssemblyImageAlignment == 0, L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The image is not aligned.");
+
+				auto header = (const WfAssemblyImageHeader*)bytes;
+				CHECK_ERROR(header->magic == WfAssemblyImageMagic, L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The data is not an assembly image.");
+				CHECK_ERROR(
+					header->version == WfAssembly::BinaryVersion &&
+					header->instructionSize == (vint32_t)sizeof(WfRuntimeInstruction) &&
+					header->functionSize == (vint32_t)sizeof(WfRuntimeFunction),
+					L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The image is written in an incompatible version or platform.");
+				CHECK_ERROR(
+					header->instructionOffset + header->instructionCount * header->instructionSize <= header->functionOffset &&
+					header->functionOffset + header->functionCount * header->functionSize <= header->metadataOffset &&
+					header->metadataOffset + header->metadataSize <= size,
+					L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The image is truncated.");
+
+				instructions = (const WfRuntimeInstruction*)(bytes + header->instructionOffset);
+				instructionCount = (vint)header->instructionCount;
+				functions = (const WfRuntimeFunction*)(bytes + header->functionOffset);
+
+				stream::MemoryWrapperStream metadata((void*)(bytes + header->metadataOffset), (vint)header->metadataSize);
+				stream::internal::WfAssemblyReader reader(metadata);
+				reader.ReadSymbols();
+				assembly = new WfAssembly;
+				assembly->IO(reader, false);
+				reader << constants << typeDescriptors << callSiteMethods << callSiteProperties << events;
+
+				// debug informations are deserialized from the image on first use
+				vint32_t debugInfoSize = 0;
+				reader << debugInfoSize;
+				if (debugInfoSize > 0)
+				{
+					CHECK_ERROR(metadata.Position() + debugInfoSize <= header->metadataSize, L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The image is truncated.");
+					assembly->serializedDebugInfo = new stream::MemoryWrapperStream((void*)(bytes + header->metadataOffset + metadata.Position()), debugInfoSize);
+				}
+				CHECK_ERROR(assembly->functions.Count() == header->functionCount, L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The image is corrupted.");
+
+				// packed instructions are executed in place, so they are decoded back and verified again instead of trusting the image
+				if (callSiteMethods.Count() != callSiteProperties.Count())
+				{
+					CHECK_FAIL(L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The image is corrupted.");
+				}
+				WfRuntimePrimitiveTypes primitiveTypes;
+				for (vint i = 0; i < instructionCount; i++)
+				{
+					auto& packed = instructions[i];
+					WfInstruction ins;
+					ins.code = packed.code;
+					bool corrupted = false;
+
+#define UNPACK_ITEM(ITEMS, INDEX)			if (INDEX < 0 || INDEX >= ITEMS.Count()) { corrupted = true; break; }
+#define UNPACK(NAME)						case WfInsCode::NAME: break;
+#define UNPACK_VALUE(NAME)					case WfInsCode::NAME: UNPACK_ITEM(constants, packed.indexParameter) ins.valueParameter = constants[packed.indexParameter]; break;
+#define UNPACK_FUNCTION(NAME)				case WfInsCode::NAME: ins.indexParameter = packed.indexParameter; break;
+#define UNPACK_FUNCTION_COUNT(NAME)			case WfInsCode::NAME: ins.indexParameter = packed.indexParameter; ins.countParameter = packed.countParameter; break;
+#define UNPACK_VARIABLE(NAME)				case WfInsCode::NAME: ins.indexParameter = packed.indexParameter; break;
+#define UNPACK_COUNT(NAME)					case WfInsCode::NAME: ins.countParameter = packed.countParameter; break;
+#define UNPACK_FLAG_TYPEDESCRIPTOR(NAME)	case WfInsCode::NAME: UNPACK_ITEM(typeDescriptors, packed.indexParameter) ins.flagParameter = (Value::ValueType)packed.flagParameter; ins.typeDescriptorParameter = typeDescriptors[packed.indexParameter]; break;
+#define UNPACK_PROPERTY(NAME)				case WfInsCode::NAME: UNPACK_ITEM(callSiteProperties, packed.indexParameter) ins.propertyParameter = callSiteProperties[packed.indexParameter]; corrupted = !ins.propertyParameter; break;
+#define UNPACK_METHOD_COUNT(NAME)			case WfInsCode::NAME: UNPACK_ITEM(callSiteMethods, packed.indexParameter) ins.methodParameter = callSiteMethods[packed.indexParameter]; ins.countParameter = packed.countParameter; corrupted = !ins.methodParameter; break;
+#define UNPACK_EVENT(NAME)					case WfInsCode::NAME: UNPACK_ITEM(events, packed.indexParameter) ins.eventParameter = events[packed.indexParameter]; break;
+#define UNPACK_LABEL(NAME)					case WfInsCode::NAME: ins.indexParameter = packed.indexParameter; break;
+#define UNPACK_TYPE(NAME)					case WfInsCode::NAME: break;
+#define UNPACK_VARIABLE_VARIABLE(NAME)		case WfInsCode::NAME: ins.indexParameter = packed.indexParameter; ins.countParameter = packed.countParameter; break;
+#define UNPACK_VARIABLE_VALUE(NAME)			case WfInsCode::NAME: UNPACK_ITEM(constants, packed.countParameter) ins.indexParameter = packed.indexParameter; ins.valueParameter = constants[packed.countParameter]; corrupted = packed.flagParameter != (vuint8_t)WfRuntimeValue::FromValue(ins.valueParameter, primitiveTypes).type; break;
+#define UNPACK_LABEL_TYPE(NAME)				case WfInsCode::NAME: ins.indexParameter = packed.indexParameter; ins.typeParameter = (WfInsType)packed.flagParameter; corrupted = packed.flagParameter > (vuint8_t)WfInsType::Unknown; break;
+#define UNPACK_TABLE(NAME)					case WfInsCode::NAME: UNPACK_ITEM(assembly->switchTables, packed.indexParameter) ins.indexParameter = packed.indexParameter; break;
+#define UNPACK_METHOD_TABLE_COUNT(NAME)		case WfInsCode::NAME: UNPACK_ITEM(assembly->methodTables, packed.indexParameter) ins.indexParameter = packed.indexParameter; ins.countParameter = packed.countParameter; break;
+#define UNPACK_CONSTANT_SET(NAME)			case WfInsCode::NAME: UNPACK_ITEM(assembly->constantSets, packed.indexParameter) ins.indexParameter = packed.indexParameter; break;
+#define UNPACK_SPECIALIZED(NAME, TYPE)		case WfInsCode::NAME##_##TYPE: ins.typeParameter = WfInsType::TYPE; break;
+
+					switch (packed.code)
+					{
+						INSTRUCTION_CASES(
+							UNPACK,
+							UNPACK_VALUE,
+							UNPACK_FUNCTION,
+							UNPACK_FUNCTION_COUNT,
+							UNPACK_VARIABLE,
+							UNPACK_COUNT,
+							UNPACK_FLAG_TYPEDESCRIPTOR,
+							UNPACK_PROPERTY,
+							UNPACK_METHOD_COUNT,
+							UNPACK_EVENT,
+							UNPACK_LABEL,
+							UNPACK_TYPE,
+							UNPACK_VARIABLE_VARIABLE,
+							UNPACK_VARIABLE_VALUE,
+							UNPACK_LABEL_TYPE,
+							UNPACK_TABLE,
+							UNPACK_METHOD_TABLE_COUNT,
+							UNPACK_CONSTANT_SET,
+							UNPACK_SPECIALIZED)
+					default:
+						corrupted = true;
+					}
+
+#undef UNPACK_ITEM
+#undef UNPACK
+#undef UNPACK_VALUE
+#undef UNPACK_FUNCTION
+#undef UNPACK_FUNCTION_COUNT
+#undef UNPACK_VARIABLE
+#undef UNPACK_COUNT
+#undef UNPACK_FLAG_TYPEDESCRIPTOR
+#undef UNPACK_PROPERTY
+#undef UNPACK_METHOD_COUNT
+#undef UNPACK_EVENT
+#undef UNPACK_LABEL
+#undef UNPACK_TYPE
+#undef UNPACK_VARIABLE_VARIABLE
+#undef UNPACK_VARIABLE_VALUE
+#undef UNPACK_LABEL_TYPE
+#undef UNPACK_TABLE
+#undef UNPACK_METHOD_TABLE_COUNT
+#undef UNPACK_CONSTANT_SET
+#undef UNPACK_SPECIALIZED
+
+					if (corrupted)
+					{
+						CHECK_FAIL(L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The image is corrupted.");
+					}
+					assembly->instructions.Add(ins);
+				}
+
+				// the image must be packed exactly as a global context packs the verified instructions
+				assembly->Initialize();
+				for (vint i = 0; i < instructionCount; i++)
+				{
+					if (instructions[i].fastCode != GetRuntimeFastCode(instructions[i].code))
+					{
+						CHECK_FAIL(L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The image is corrupted.");
+					}
+				}
+				for (vint i = 0; i < assembly->functions.Count(); i++)
+				{
+					auto meta = assembly->functions[i];
+					auto& function = functions[i];
+					if (function.firstInstruction != meta->firstInstruction ||
+						function.argumentCount != meta->argumentNames.Count() ||
+						function.capturedVariableCount != meta->capturedVariableNames.Count() ||
+						function.localVariableCount != meta->localVariableNames.Count() ||
+						function.maxStackDepth != meta->maxStackDepth)
+					{
+						CHECK_FAIL(L"vl::workflow::runtime::WfAssemblyImage::WfAssemblyImage(const void*, vint)#The image is corrupted.");
+					}
+				}
+			}
+
+			void WfAssemblyImage::Write(WfRuntimeGlobalContext* context, stream::IStream& output)
+			{
+				stream::MemoryStream metadata;
+				stream::internal::WriteWithSymbols(metadata, [&](stream::internal::WfAssemblyWriter& writer)
+				{
+					List<Value> constants;
+					FOREACH(WfRuntimeValue, constant, context->constants)
+					{
+						constants.Add(constant.ToValue(context->primitiveTypes));
+					}
+
+					List<IMethodInfo*> callSiteMethods;
+					List<IPropertyInfo*> callSiteProperties;
+					FOREACH(WfRuntimeCallSite, callSite, context->callSites)
+					{
+						callSiteMethods.Add(callSite.propertyInfo ? nullptr : callSite.methodInfo);
+						callSiteProperties.Add(callSite.propertyInfo);
+					}
+
+					stream::MemoryStream debugInfo;
+					context->assembly->SerializeDebugInfo(debugInfo);
+					stream::IStream& debugInfoStream = debugInfo;
+
+					context->assembly->IO(writer, false);
+					writer << constants << context->typeDescriptors << callSiteMethods << callSiteProperties << context->events << debugInfoStream;
+				});
+
+				WfAssemblyImageHeader header;
+				header.magic = WfAssemblyImageMagic;
+				header.version = WfAssembly::BinaryVersion;
+				header.instructionSize = (vint32_t)sizeof(WfRuntimeInstruction);
+				header.functionSize = (vint32_t)sizeof(WfRuntimeFunction);
+				header.instructionOffset = AlignImageSection(sizeof(header));
+				header.instructionCount = context->instructions.Count();
+				header.functionOffset = AlignImageSection(header.instructionOffset + header.instructionCount * header.instructionSize);
+				header.functionCount = context->functions.Count();
+				header.metadataOffset = AlignImageSection(header.functionOffset + header.functionCount * header.functionSize);
+				header.metadataSize = metadata.Size();
+
+				vint64_t position = 0;
+				auto writeSection = [&](vint64_t offset, const void* data, vint64_t size)
+				{
+					static const char padding[WfAssemblyImageAlignment] = { 0 };
+					vint paddingSize = (vint)(offset - position);
+					if (paddingSize > 0 && output.Write((void*)padding, paddingSize) != paddingSize)
+					{
+						CHECK_FAIL(L"vl::workflow::runtime::WfAssemblyImage::Write(WfRuntimeGlobalContext*, IStream&)#Failed to write the image.");
+					}
+					if (size > 0 && output.Write((void*)data, (vint)size) != size)
+					{
+						CHECK_FAIL(L"vl::workflow::runtime::WfAssemblyImage::Write(WfRuntimeGlobalContext*, IStream&)#Failed to write the image.");
+					}
+					position = offset + size;
+				};
+
+				writeSection(0, &header, sizeof(header));
+				writeSection(header.instructionOffset, header.instructionCount == 0 ? nullptr : &context->instructions[0], header.instructionCount * header.instructionSize);
+				writeSection(header.functionOffset, header.functionCount == 0 ? nullptr : &context->functions[0], header.functionCount * header.functionSize);
+				writeSection(header.metadataOffset, metadata.GetInternalBuffer(), header.metadataSize);
 			}
 
 /***********************************************************************
@@ -483,7 +1891,7 @@ WfRuntimeCallStackInfo
 						Dictionary<WString, Value> map;
 						FOREACH_INDEXER(WString, name, index, names)
 						{
-							map.Add(name, context->variables[index]);
+							map.Add(name, context->variables[index].ToValue());
 						}
 						cache = IValueDictionary::Create(
 							From(map)
@@ -576,49 +1984,53 @@ WfRuntimeCallStackInfo
 
 			WString WfRuntimeCallStackInfo::GetSourceCodeBeforeCodegen()
 			{
-				if (!assembly)
+				auto debugInfo = assembly ? assembly->GetDebugInfo(true) : nullptr;
+				if (!debugInfo)
 				{
 					return L"";
 				}
-				const auto& range = assembly->insBeforeCodegen->instructionCodeMapping[instruction];
+				const auto& range = debugInfo->instructionCodeMapping[instruction];
 				if (range.codeIndex == -1)
 				{
 					return L"";
 				}
-				return assembly->insBeforeCodegen->moduleCodes[range.codeIndex];
+				return debugInfo->moduleCodes[range.codeIndex];
 			}
 
 			WString WfRuntimeCallStackInfo::GetSourceCodeAfterCodegen()
 			{
-				if (!assembly)
+				auto debugInfo = assembly ? assembly->GetDebugInfo(false) : nullptr;
+				if (!debugInfo)
 				{
 					return L"";
 				}
-				const auto& range = assembly->insAfterCodegen->instructionCodeMapping[instruction];
+				const auto& range = debugInfo->instructionCodeMapping[instruction];
 				if (range.codeIndex == -1)
 				{
 					return L"";
 				}
-				return assembly->insAfterCodegen->moduleCodes[range.codeIndex];
+				return debugInfo->moduleCodes[range.codeIndex];
 			}
 
 			vint WfRuntimeCallStackInfo::GetRowBeforeCodegen()
 			{
-				if (!assembly)
+				auto debugInfo = assembly ? assembly->GetDebugInfo(true) : nullptr;
+				if (!debugInfo)
 				{
 					return -1;
 				}
-				const auto& range = assembly->insBeforeCodegen->instructionCodeMapping[instruction];
+				const auto& range = debugInfo->instructionCodeMapping[instruction];
 				return range.start.row;
 			}
 
 			vint WfRuntimeCallStackInfo::GetRowAfterCodegen()
 			{
-				if (!assembly)
+				auto debugInfo = assembly ? assembly->GetDebugInfo(false) : nullptr;
+				if (!debugInfo)
 				{
 					return -1;
 				}
-				const auto& range = assembly->insAfterCodegen->instructionCodeMapping[instruction];
+				const auto& range = debugInfo->instructionCodeMapping[instruction];
 				return range.start.row;
 			}
 
@@ -676,6 +2088,8 @@ WfRuntimeThreadContext
 			{
 				stack.SetLessMemoryMode(false);
 				stackFrames.SetLessMemoryMode(false);
+				trapFrames.SetLessMemoryMode(false);
+				proxyArguments.SetLessMemoryMode(false);
 			}
 
 			WfRuntimeThreadContext::WfRuntimeThreadContext(Ptr<WfAssembly> _assembly)
@@ -683,6 +2097,8 @@ WfRuntimeThreadContext
 			{
 				stack.SetLessMemoryMode(false);
 				stackFrames.SetLessMemoryMode(false);
+				trapFrames.SetLessMemoryMode(false);
+				proxyArguments.SetLessMemoryMode(false);
 			}
 
 			WfRuntimeStackFrame& WfRuntimeThreadContext::GetCurrentStackFrame()
@@ -690,33 +2106,23 @@ WfRuntimeThreadContext
 				return stackFrames[stackFrames.Count() - 1];
 			}
 
-			WfRuntimeThreadContextError WfRuntimeThreadContext::PushStackFrame(vint functionIndex, vint argumentCount, Ptr<WfRuntimeVariableContext> capturedVariables)
+			WfRuntimeThreadContextError CheckStackFrameArguments(WfRuntimeThreadContext& context, vint functionIndex, vint argumentCount, WfRuntimeVariableContext* capturedVariables)
 			{
-				if (stackFrames.Count() == 0)
-				{
-					if (stack.Count() < argumentCount)
-					{
-						return WfRuntimeThreadContextError::StackCorrupted;
-					}
-				}
-				else
+				vint stackBase = context.stackFrames.Count() == 0 ? 0 : context.GetCurrentStackFrame().freeStackBase;
+				if (context.stack.Count() - stackBase < argumentCount)
 				{
-					auto& frame = GetCurrentStackFrame();
-					if (stack.Count() - frame.freeStackBase < argumentCount)
-					{
-						return WfRuntimeThreadContextError::StackCorrupted;
-					}
+					return WfRuntimeThreadContextError::StackCorrupted;
 				}
-				if (functionIndex < 0 || functionIndex >= globalContext->assembly->functions.Count())
+				if (functionIndex < 0 || functionIndex >= context.globalContext->functions.Count())
 				{
 					return WfRuntimeThreadContextError::WrongFunctionIndex;
 				}
-				auto meta = globalContext->assembly->functions[functionIndex];
-				if (meta->argumentNames.Count() != argumentCount)
+				auto& function = context.globalContext->functions[functionIndex];
+				if (function.argumentCount != argumentCount)
 				{
 					return WfRuntimeThreadContextError::WrongArgumentCount;
 				}
-				if (meta->capturedVariableNames.Count() == 0)
+				if (function.capturedVariableCount == 0)
 				{
 					if (capturedVariables)
 					{
@@ -725,26 +2131,45 @@ WfRuntimeThreadContext
 				}
 				else
 				{
-					if (!capturedVariables || capturedVariables->variables.Count() != meta->capturedVariableNames.Count())
+					if (!capturedVariables || capturedVariables->variables.Count() != function.capturedVariableCount)
 					{
 						return WfRuntimeThreadContextError::WrongCapturedVariableCount;
 					}
 				}
+				return WfRuntimeThreadContextError::Success;
+			}
 
-				WfRuntimeStackFrame frame;
-				frame.capturedVariables = capturedVariables;
+			void InitializeStackFrame(WfRuntimeThreadContext& context, WfRuntimeStackFrame& frame, vint functionIndex)
+			{
+				auto& function = context.globalContext->functions[functionIndex];
 				frame.functionIndex = functionIndex;
-				frame.nextInstructionIndex = globalContext->assembly->functions[functionIndex]->firstInstruction;
-				frame.stackBase = stack.Count() - argumentCount;
-
-				frame.fixedVariableCount = meta->argumentNames.Count() + meta->localVariableNames.Count();
+				frame.nextInstructionIndex = function.firstInstruction;
+				frame.fixedVariableCount = function.argumentCount + function.localVariableCount;
 				frame.freeStackBase = frame.stackBase + frame.fixedVariableCount;
-				stackFrames.Add(frame);
 
-				for (vint i = 0; i < meta->localVariableNames.Count(); i++)
+				context.stack.PushDefaultValues(function.localVariableCount);
+				if (function.maxStackDepth != -1 && context.reservedStackSize < frame.freeStackBase + function.maxStackDepth)
+				{
+					// the stack never shrinks its buffer, so executing the function will not reallocate it
+					context.reservedStackSize = frame.freeStackBase + function.maxStackDepth;
+					context.stack.Reserve(context.reservedStackSize);
+				}
+			}
+
+			WfRuntimeThreadContextError WfRuntimeThreadContext::PushStackFrame(vint functionIndex, vint argumentCount, Ptr<WfRuntimeVariableContext> capturedVariables)
+			{
+				auto result = CheckStackFrameArguments(*this, functionIndex, argumentCount, capturedVariables.Obj());
+				if (result != WfRuntimeThreadContextError::Success)
 				{
-					stack.Add(Value());
+					return result;
 				}
+
+				WfRuntimeStackFrame frame;
+				frame.capturedVariables = capturedVariables;
+				frame.stackBase = stack.Count() - argumentCount;
+				InitializeStackFrame(*this, frame, functionIndex);
+				stackFrames.Add(frame);
+
 				if (status == WfRuntimeExecutionStatus::Finished || status == WfRuntimeExecutionStatus::FatalError)
 				{
 					status = WfRuntimeExecutionStatus::Ready;
@@ -752,7 +2177,45 @@ WfRuntimeThreadContext
 				return WfRuntimeThreadContextError::Success;
 			}
 
-			WfRuntimeThreadContextError WfRuntimeThreadContext::PopStackFrame()
+			WfRuntimeThreadContextError WfRuntimeThreadContext::ReplaceStackFrame(vint functionIndex, vint argumentCount)
+			{
+				if (stackFrames.Count() == 0) return WfRuntimeThreadContextError::EmptyStackFrame;
+				auto& frame = GetCurrentStackFrame();
+				if (trapFrames.Count() > 0)
+				{
+					WfRuntimeTrapFrame& trapFrame = GetCurrentTrapFrame();
+					if (trapFrame.stackFrameIndex == stackFrames.Count() - 1)
+					{
+						return WfRuntimeThreadContextError::TrapFrameCorrupted;
+					}
+				}
+				auto result = CheckStackFrameArguments(*this, functionIndex, argumentCount, nullptr);
+				if (result != WfRuntimeThreadContextError::Success)
+				{
+					return result;
+				}
+
+				// move arguments to the bottom of the stack frame, and discard everything else in the stack frame
+				vint argumentBase = stack.Count() - argumentCount;
+				for (vint i = 0; i < argumentCount; i++)
+				{
+					if (frame.stackBase + i != argumentBase + i)
+					{
+						stack[frame.stackBase + i] = stack[argumentBase + i];
+					}
+				}
+
+				vint stackTop = frame.stackBase + argumentCount;
+				if (stack.Count() > stackTop)
+				{
+					stack.RemoveRange(stackTop, stack.Count() - stackTop);
+				}
+				frame.capturedVariables = nullptr;
+				InitializeStackFrame(*this, frame, functionIndex);
+				return WfRuntimeThreadContextError::Success;
+			}
+
+			WfRuntimeThreadContextError WfRuntimeThreadContext::PopStackFrame(vint saveStackPatternCount)
 			{
 				if (stackFrames.Count() == 0) return WfRuntimeThreadContextError::EmptyStackFrame;
 				WfRuntimeStackFrame frame = GetCurrentStackFrame();
@@ -764,11 +2227,27 @@ WfRuntimeThreadContext
 						return WfRuntimeThreadContextError::TrapFrameCorrupted;
 					}
 				}
+
+				vint saveBase = stack.Count() - saveStackPatternCount;
+				if (saveStackPatternCount < 0 || (saveStackPatternCount > 0 && saveBase < frame.freeStackBase))
+				{
+					return WfRuntimeThreadContextError::StackCorrupted;
+				}
 				stackFrames.RemoveAt(stackFrames.Count() - 1);
 
-				if (stack.Count() > frame.stackBase)
+				// move saved values to the bottom of the stack frame, so that they stay after the stack frame is removed
+				for (vint i = 0; i < saveStackPatternCount; i++)
+				{
+					if (frame.stackBase + i != saveBase + i)
+					{
+						stack[frame.stackBase + i] = stack[saveBase + i];
+					}
+				}
+
+				vint stackTop = frame.stackBase + saveStackPatternCount;
+				if (stack.Count() > stackTop)
 				{
-					stack.RemoveRange(frame.stackBase, stack.Count() - frame.stackBase);
+					stack.RemoveRange(stackTop, stack.Count() - stackTop);
 				}
 				return WfRuntimeThreadContextError::Success;
 			}
@@ -808,13 +2287,66 @@ WfRuntimeThreadContext
 				return WfRuntimeThreadContextError::Success;
 			}
 
-			WfRuntimeThreadContextError WfRuntimeThreadContext::PushValue(const reflection::description::Value& value)
+			WfRuntimeThreadContextError WfRuntimeThreadContext::PushValue(const WfRuntimeValue& value)
 			{
 				stack.Add(value);
 				return WfRuntimeThreadContextError::Success;
 			}
 
+			WfRuntimeThreadContextError WfRuntimeThreadContext::PushValue(const reflection::description::Value& value)
+			{
+				stack.Add(WfRuntimeValue::FromValue(value, globalContext->primitiveTypes));
+				return WfRuntimeThreadContextError::Success;
+			}
+
 			WfRuntimeThreadContextError WfRuntimeThreadContext::PopValue(reflection::description::Value& value)
+			{
+				WfRuntimeValue slot;
+				auto result = PopValue(slot);
+				if (result == WfRuntimeThreadContextError::Success)
+				{
+					value = slot.ToValue(globalContext->primitiveTypes);
+				}
+				return result;
+			}
+
+			WfRuntimeValue& WfRuntimeThreadContext::PushValue()
+			{
+				stack.PushDefaultValues(1);
+				return stack[stack.Count() - 1];
+			}
+
+			WfRuntimeThreadContextError WfRuntimeThreadContext::GetTopValues(vint count, WfRuntimeValue*& values)
+			{
+				vint stackBase = stackFrames.Count() == 0 ? 0 : GetCurrentStackFrame().freeStackBase;
+				if (count < 0 || stack.Count() - count < stackBase)
+				{
+					return stackFrames.Count() == 0 ? WfRuntimeThreadContextError::EmptyStack : WfRuntimeThreadContextError::StackCorrupted;
+				}
+				values = count == 0 ? nullptr : &stack[stack.Count() - count];
+				return WfRuntimeThreadContextError::Success;
+			}
+
+			WfRuntimeThreadContextError WfRuntimeThreadContext::PopValues(vint count)
+			{
+				WfRuntimeValue* values = nullptr;
+				auto result = GetTopValues(count, values);
+				if (result == WfRuntimeThreadContextError::Success)
+				{
+					PopValuesUnchecked(count);
+				}
+				return result;
+			}
+
+			void WfRuntimeThreadContext::PopValuesUnchecked(vint count)
+			{
+				if (count > 0)
+				{
+					stack.RemoveRange(stack.Count() - count, count);
+				}
+			}
+
+			WfRuntimeThreadContextError WfRuntimeThreadContext::PopValue(WfRuntimeValue& value)
 			{
 				if (stackFrames.Count() == 0)
 				{
@@ -881,7 +2413,7 @@ WfRuntimeThreadContext
 				return WfRuntimeThreadContextError::Success;
 			}
 
-			WfRuntimeThreadContextError WfRuntimeThreadContext::LoadStackValue(vint stackItemIndex, reflection::description::Value& value)
+			WfRuntimeThreadContextError WfRuntimeThreadContext::LoadStackValue(vint stackItemIndex, WfRuntimeValue& value)
 			{
 				if (stackFrames.Count() == 0) return WfRuntimeThreadContextError::EmptyStackFrame;
 				auto frame = GetCurrentStackFrame();
@@ -894,7 +2426,7 @@ WfRuntimeThreadContext
 				return WfRuntimeThreadContextError::Success;
 			}
 
-			WfRuntimeThreadContextError WfRuntimeThreadContext::LoadGlobalVariable(vint variableIndex, reflection::description::Value& value)
+			WfRuntimeThreadContextError WfRuntimeThreadContext::LoadGlobalVariable(vint variableIndex, WfRuntimeValue& value)
 			{
 				if (variableIndex < 0 || variableIndex >= globalContext->globalVariables->variables.Count())
 				{
@@ -905,7 +2437,7 @@ WfRuntimeThreadContext
 				return WfRuntimeThreadContextError::Success;
 			}
 
-			WfRuntimeThreadContextError WfRuntimeThreadContext::StoreGlobalVariable(vint variableIndex, const reflection::description::Value& value)
+			WfRuntimeThreadContextError WfRuntimeThreadContext::StoreGlobalVariable(vint variableIndex, const WfRuntimeValue& value)
 			{
 				if (variableIndex < 0 || variableIndex >= globalContext->globalVariables->variables.Count())
 				{
@@ -916,7 +2448,7 @@ WfRuntimeThreadContext
 				return WfRuntimeThreadContextError::Success;
 			}
 
-			WfRuntimeThreadContextError WfRuntimeThreadContext::LoadCapturedVariable(vint variableIndex, reflection::description::Value& value)
+			WfRuntimeThreadContextError WfRuntimeThreadContext::LoadCapturedVariable(vint variableIndex, WfRuntimeValue& value)
 			{
 				if (stackFrames.Count() == 0) return WfRuntimeThreadContextError::EmptyStackFrame;
 				auto frame = GetCurrentStackFrame();
@@ -929,7 +2461,7 @@ WfRuntimeThreadContext
 				return WfRuntimeThreadContextError::Success;
 			}
 
-			WfRuntimeThreadContextError WfRuntimeThreadContext::LoadLocalVariable(vint variableIndex, reflection::description::Value& value)
+			WfRuntimeThreadContextError WfRuntimeThreadContext::LoadLocalVariable(vint variableIndex, WfRuntimeValue& value)
 			{
 				if (stackFrames.Count() == 0) return WfRuntimeThreadContextError::EmptyStackFrame;
 				auto frame = GetCurrentStackFrame();
@@ -942,7 +2474,7 @@ WfRuntimeThreadContext
 				return WfRuntimeThreadContextError::Success;
 			}
 
-			WfRuntimeThreadContextError WfRuntimeThreadContext::StoreLocalVariable(vint variableIndex, const reflection::description::Value& value)
+			WfRuntimeThreadContextError WfRuntimeThreadContext::StoreLocalVariable(vint variableIndex, const WfRuntimeValue& value)
 			{
 				if (stackFrames.Count() == 0) return WfRuntimeThreadContextError::EmptyStackFrame;
 				auto frame = GetCurrentStackFrame();
@@ -961,11 +2493,12 @@ WfRuntimeThreadContext
 				if (callback)
 				{
 					callback->EnterThreadContext(this);
+					while (Execute(callback) != WfRuntimeExecutionAction::Nop);
+					callback->LeaveThreadContext(this);
 				}
-				while (Execute(callback) != WfRuntimeExecutionAction::Nop);
-				if (callback)
+				else
 				{
-					callback->LeaveThreadContext(this);
+					ExecuteFast();
 				}
 			}
 		}
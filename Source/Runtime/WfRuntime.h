@@ -10,6 +10,7 @@ Interfaces:
 #define VCZH_WORKFLOW_RUNTIME_WFRUNTIME
 
 #include "../WorkflowVlppReferences.h"
+#include <atomic>
 
 namespace vl
 {
@@ -42,7 +43,7 @@ Instruction
 				Return,				// 						: Value -> Value								; (exit function)
 				CreateArray,		// count				: Value-count, ..., Value-1 -> <array>			; {1 2 3} -> <3 2 1>
 				CreateMap,			// count				: Value-count, ..., Value-1 -> <map>			; {1:2 3:4} -> <3 4 1 2>
-				CreateInterface,	// count				: Value-count, ..., Value-1 -> <map>			; {"Get":a "Set":b} -> InterfaceProxy^
+				CreateInterface,	// methodTable, count	: Value-count, ..., Value-1 -> InterfaceProxy^	; captured values shared by all methods
 				CreateRange,		// I1248/U1248			: Value-begin, Value-end -> <enumerable>		;
 				ReverseEnumerable,	//						: Value -> Value								;
 				DeleteRawPtr,		//						: Value -> ()									;
@@ -87,9 +88,77 @@ Instruction
 				OpGE,				// 						: <int> -> <bool>								;
 				OpEQ,				// 						: <int> -> <bool>								;
 				OpNE,				// 						: <int> -> <bool>								;
+
+				// Type-specialized instructions. Each one has the same stack pattern as the generic instruction with the type suffix as the type argument.
+				// The generic instructions above with a type argument only name the operation, constructors always create the specialized instruction, and the verifier rejects them.
+				CreateRange_I1, CreateRange_I2, CreateRange_I4, CreateRange_I8, CreateRange_U1, CreateRange_U2, CreateRange_U4, CreateRange_U8,
+				CompareLiteral_Bool, CompareLiteral_I1, CompareLiteral_I2, CompareLiteral_I4, CompareLiteral_I8, CompareLiteral_U1, CompareLiteral_U2, CompareLiteral_U4, CompareLiteral_U8, CompareLiteral_F4, CompareLiteral_F8, CompareLiteral_String,
+				OpNot_Bool, OpNot_I1, OpNot_I2, OpNot_I4, OpNot_I8, OpNot_U1, OpNot_U2, OpNot_U4, OpNot_U8,
+				OpPositive_I1, OpPositive_I2, OpPositive_I4, OpPositive_I8, OpPositive_U1, OpPositive_U2, OpPositive_U4, OpPositive_U8,
+				OpNegative_I1, OpNegative_I2, OpNegative_I4, OpNegative_I8,
+				OpExp_F4, OpExp_F8,
+				OpAdd_I1, OpAdd_I2, OpAdd_I4, OpAdd_I8, OpAdd_U1, OpAdd_U2, OpAdd_U4, OpAdd_U8, OpAdd_F4, OpAdd_F8,
+				OpSub_I1, OpSub_I2, OpSub_I4, OpSub_I8, OpSub_U1, OpSub_U2, OpSub_U4, OpSub_U8, OpSub_F4, OpSub_F8,
+				OpMul_I1, OpMul_I2, OpMul_I4, OpMul_I8, OpMul_U1, OpMul_U2, OpMul_U4, OpMul_U8, OpMul_F4, OpMul_F8,
+				OpDiv_I1, OpDiv_I2, OpDiv_I4, OpDiv_I8, OpDiv_U1, OpDiv_U2, OpDiv_U4, OpDiv_U8, OpDiv_F4, OpDiv_F8,
+				OpMod_I1, OpMod_I2, OpMod_I4, OpMod_I8, OpMod_U1, OpMod_U2, OpMod_U4, OpMod_U8,
+				OpShl_I1, OpShl_I2, OpShl_I4, OpShl_I8, OpShl_U1, OpShl_U2, OpShl_U4, OpShl_U8,
+				OpShr_I1, OpShr_I2, OpShr_I4, OpShr_I8, OpShr_U1, OpShr_U2, OpShr_U4, OpShr_U8,
+				OpXor_Bool, OpXor_I1, OpXor_I2, OpXor_I4, OpXor_I8, OpXor_U1, OpXor_U2, OpXor_U4, OpXor_U8,
+				OpAnd_Bool, OpAnd_I1, OpAnd_I2, OpAnd_I4, OpAnd_I8, OpAnd_U1, OpAnd_U2, OpAnd_U4, OpAnd_U8,
+				OpOr_Bool, OpOr_I1, OpOr_I2, OpOr_I4, OpOr_I8, OpOr_U1, OpOr_U2, OpOr_U4, OpOr_U8,
+
+				// Superinstructions. They replace common instruction sequences emitted by the code generator.
+				LoadLocalVar2,		// variable, variable	: () -> Value-1, Value-2						; LoadLocalVar, LoadLocalVar
+				IncreaseLocalVar,	// variable, value		: () -> ()										; LoadLocalVar, LoadValue, OpAdd, StoreLocalVar
+				JumpIfLT,			// label, type			: Value, Value -> ()							; CompareLiteral, OpLT, JumpIf
+				JumpIfGT,			// label, type			: Value, Value -> ()							; CompareLiteral, OpGT, JumpIf
+				JumpIfLE,			// label, type			: Value, Value -> ()							; CompareLiteral, OpLE, JumpIf
+				JumpIfGE,			// label, type			: Value, Value -> ()							; CompareLiteral, OpGE, JumpIf
+				JumpIfEQ,			// label, type			: Value, Value -> ()							; CompareLiteral, OpEQ, JumpIf
+				JumpIfNE,			// label, type			: Value, Value -> ()							; CompareLiteral, OpNE, JumpIf
+
+				// Dispatch instructions.
+				SwitchTable,		// table				: Value -> ()									; jump to the label of the value in the table, or to the next instruction if the value is not a key
+
+				// Call instructions.
+				TailInvoke,			// function, count		: Value-1, ..., Value-n -> ()					; (exit function) Invoke, Return, reusing the current stack frame
+
+				// String instructions.
+				ConcatN,			// count				: <string>-1, ..., <string>-n -> <string>		; OpConcat repeated, copying each string only once
+
+				// Set instructions.
+				TestElementInConstantSet,	// set			: Value-element -> <bool>						; TestElementInSet with a set of constant keys
+
+				// Collection instructions.
+				CreateHashMap,		// count				: Value-count, ..., Value-1 -> <map>			; CreateMap creating a WfRuntimeHashMap
 			};
 
-#define INSTRUCTION_CASES(APPLY, APPLY_VALUE, APPLY_FUNCTION, APPLY_FUNCTION_COUNT, APPLY_VARIABLE, APPLY_COUNT, APPLY_FLAG_TYPEDESCRIPTOR, APPLY_PROPERTY, APPLY_METHOD_COUNT, APPLY_EVENT, APPLY_LABEL, APPLY_TYPE)\
+#define INSTRUCTION_TYPES_B(APPLY, NAME)		APPLY(NAME, Bool)
+#define INSTRUCTION_TYPES_I(APPLY, NAME)		APPLY(NAME, I1) APPLY(NAME, I2) APPLY(NAME, I4) APPLY(NAME, I8)
+#define INSTRUCTION_TYPES_U(APPLY, NAME)		APPLY(NAME, U1) APPLY(NAME, U2) APPLY(NAME, U4) APPLY(NAME, U8)
+#define INSTRUCTION_TYPES_F(APPLY, NAME)		APPLY(NAME, F4) APPLY(NAME, F8)
+#define INSTRUCTION_TYPES_S(APPLY, NAME)		APPLY(NAME, String)
+
+#define INSTRUCTION_SPECIALIZED_CASES(APPLY_SPECIALIZED)\
+			INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, CreateRange) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, CreateRange)\
+			INSTRUCTION_TYPES_B(APPLY_SPECIALIZED, CompareLiteral) INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, CompareLiteral) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, CompareLiteral) INSTRUCTION_TYPES_F(APPLY_SPECIALIZED, CompareLiteral) INSTRUCTION_TYPES_S(APPLY_SPECIALIZED, CompareLiteral)\
+			INSTRUCTION_TYPES_B(APPLY_SPECIALIZED, OpNot) INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpNot) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpNot)\
+			INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpPositive) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpPositive)\
+			INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpNegative)\
+			INSTRUCTION_TYPES_F(APPLY_SPECIALIZED, OpExp)\
+			INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpAdd) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpAdd) INSTRUCTION_TYPES_F(APPLY_SPECIALIZED, OpAdd)\
+			INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpSub) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpSub) INSTRUCTION_TYPES_F(APPLY_SPECIALIZED, OpSub)\
+			INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpMul) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpMul) INSTRUCTION_TYPES_F(APPLY_SPECIALIZED, OpMul)\
+			INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpDiv) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpDiv) INSTRUCTION_TYPES_F(APPLY_SPECIALIZED, OpDiv)\
+			INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpMod) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpMod)\
+			INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpShl) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpShl)\
+			INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpShr) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpShr)\
+			INSTRUCTION_TYPES_B(APPLY_SPECIALIZED, OpXor) INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpXor) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpXor)\
+			INSTRUCTION_TYPES_B(APPLY_SPECIALIZED, OpAnd) INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpAnd) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpAnd)\
+			INSTRUCTION_TYPES_B(APPLY_SPECIALIZED, OpOr) INSTRUCTION_TYPES_I(APPLY_SPECIALIZED, OpOr) INSTRUCTION_TYPES_U(APPLY_SPECIALIZED, OpOr)\
+
+#define INSTRUCTION_CASES(APPLY, APPLY_VALUE, APPLY_FUNCTION, APPLY_FUNCTION_COUNT, APPLY_VARIABLE, APPLY_COUNT, APPLY_FLAG_TYPEDESCRIPTOR, APPLY_PROPERTY, APPLY_METHOD_COUNT, APPLY_EVENT, APPLY_LABEL, APPLY_TYPE, APPLY_VARIABLE_VARIABLE, APPLY_VARIABLE_VALUE, APPLY_LABEL_TYPE, APPLY_TABLE, APPLY_METHOD_TABLE_COUNT, APPLY_CONSTANT_SET, APPLY_SPECIALIZED)\
 			APPLY(Nop)\
 			APPLY_VALUE(LoadValue)\
 			APPLY_FUNCTION_COUNT(LoadClosure)\
@@ -104,7 +173,7 @@ Instruction
 			APPLY(Return)\
 			APPLY_COUNT(CreateArray)\
 			APPLY_COUNT(CreateMap)\
-			APPLY_COUNT(CreateInterface)\
+			APPLY_METHOD_TABLE_COUNT(CreateInterface)\
 			APPLY_TYPE(CreateRange)\
 			APPLY(ReverseEnumerable)\
 			APPLY(DeleteRawPtr)\
@@ -149,6 +218,20 @@ Instruction
 			APPLY(OpGE)\
 			APPLY(OpEQ)\
 			APPLY(OpNE)\
+			INSTRUCTION_SPECIALIZED_CASES(APPLY_SPECIALIZED)\
+			APPLY_VARIABLE_VARIABLE(LoadLocalVar2)\
+			APPLY_VARIABLE_VALUE(IncreaseLocalVar)\
+			APPLY_LABEL_TYPE(JumpIfLT)\
+			APPLY_LABEL_TYPE(JumpIfGT)\
+			APPLY_LABEL_TYPE(JumpIfLE)\
+			APPLY_LABEL_TYPE(JumpIfGE)\
+			APPLY_LABEL_TYPE(JumpIfEQ)\
+			APPLY_LABEL_TYPE(JumpIfNE)\
+			APPLY_TABLE(SwitchTable)\
+			APPLY_FUNCTION_COUNT(TailInvoke)\
+			APPLY_COUNT(ConcatN)\
+			APPLY_CONSTANT_SET(TestElementInConstantSet)\
+			APPLY_COUNT(CreateHashMap)\
 
 			enum class WfInsType
 			{
@@ -172,6 +255,7 @@ Instruction
 				WfInsCode											code = WfInsCode::Nop;
 				reflection::description::Value						valueParameter;
 				vint												countParameter = 0;
+				WfInsType											typeParameter = WfInsType::Unknown;
 				union
 				{
 					struct
@@ -179,7 +263,6 @@ Instruction
 						reflection::description::Value::ValueType		flagParameter;
 						reflection::description::ITypeDescriptor*		typeDescriptorParameter;
 					};
-					WfInsType											typeParameter;
 					vint												indexParameter;
 					reflection::description::IPropertyInfo*				propertyParameter;
 					reflection::description::IMethodInfo*				methodParameter;
@@ -188,6 +271,9 @@ Instruction
 
 				WfInstruction();
 
+				static WfInsCode									GetSpecializedCode(WfInsCode code, WfInsType type);
+				static WfInsCode									GetGenericCode(WfInsCode code);
+
 				#define CTOR(NAME)						static WfInstruction NAME();
 				#define CTOR_VALUE(NAME)				static WfInstruction NAME(const reflection::description::Value& value);
 				#define CTOR_FUNCTION(NAME)				static WfInstruction NAME(vint function);
@@ -200,6 +286,13 @@ Instruction
 				#define CTOR_EVENT(NAME)				static WfInstruction NAME(reflection::description::IEventInfo* eventInfo);
 				#define CTOR_LABEL(NAME)				static WfInstruction NAME(vint label);
 				#define CTOR_TYPE(NAME)					static WfInstruction NAME(WfInsType type);
+				#define CTOR_VARIABLE_VARIABLE(NAME)	static WfInstruction NAME(vint variable1, vint variable2);
+				#define CTOR_VARIABLE_VALUE(NAME)		static WfInstruction NAME(vint variable, const reflection::description::Value& value);
+				#define CTOR_LABEL_TYPE(NAME)			static WfInstruction NAME(vint label, WfInsType type);
+				#define CTOR_TABLE(NAME)				static WfInstruction NAME(vint table);
+				#define CTOR_METHOD_TABLE_COUNT(NAME)	static WfInstruction NAME(vint methodTable, vint count);
+				#define CTOR_CONSTANT_SET(NAME)			static WfInstruction NAME(vint set);
+				#define CTOR_SPECIALIZED(NAME, TYPE)	static WfInstruction NAME##_##TYPE();
 
 				INSTRUCTION_CASES(
 					CTOR,
@@ -213,7 +306,14 @@ Instruction
 					CTOR_METHOD_COUNT,
 					CTOR_EVENT,
 					CTOR_LABEL,
-					CTOR_TYPE)
+					CTOR_TYPE,
+					CTOR_VARIABLE_VARIABLE,
+					CTOR_VARIABLE_VALUE,
+					CTOR_LABEL_TYPE,
+					CTOR_TABLE,
+					CTOR_METHOD_TABLE_COUNT,
+					CTOR_CONSTANT_SET,
+					CTOR_SPECIALIZED)
 
 				#undef CTOR
 				#undef CTOR_VALUE
@@ -227,6 +327,13 @@ Instruction
 				#undef CTOR_EVENT
 				#undef CTOR_LABEL
 				#undef CTOR_TYPE
+				#undef CTOR_VARIABLE_VARIABLE
+				#undef CTOR_VARIABLE_VALUE
+				#undef CTOR_LABEL_TYPE
+				#undef CTOR_TABLE
+				#undef CTOR_METHOD_TABLE_COUNT
+				#undef CTOR_CONSTANT_SET
+				#undef CTOR_SPECIALIZED
 			};
 
 /***********************************************************************
@@ -249,6 +356,40 @@ Assembly
 				vint												firstInstruction = -1;
 				/// <summary>Last instruction index of the function. This index is for accessing [F:vl.workflow.runtime.WfAssembly.instructions].</summary>
 				vint												lastInstruction = -1;
+				/// <summary>Maximum number of values on the stack when executing the function, excluding arguments and local variables. It is -1 before the assembly is verified.</summary>
+				vint												maxStackDepth = -1;
+			};
+
+			/// <summary>Representing the jump table of a [F:vl.workflow.runtime.WfInsCode.SwitchTable] instruction.</summary>
+			class WfSwitchTable : public Object
+			{
+			public:
+				/// <summary>Type of all keys. It is an integer type or [F:vl.workflow.runtime.WfInsType.String].</summary>
+				WfInsType											type = WfInsType::Unknown;
+				/// <summary>Constant keys. When a key appears more than once, only the first label is used.</summary>
+				collections::List<reflection::description::Value>	keys;
+				/// <summary>Instruction index to jump to for each key.</summary>
+				collections::List<vint>								labels;
+			};
+
+			/// <summary>Representing the keys of a [F:vl.workflow.runtime.WfInsCode.TestElementInConstantSet] instruction.</summary>
+			class WfConstantSet : public Object
+			{
+			public:
+				/// <summary>Type of all keys. It is an integer type or [F:vl.workflow.runtime.WfInsType.String].</summary>
+				WfInsType											type = WfInsType::Unknown;
+				/// <summary>Constant keys.</summary>
+				collections::List<reflection::description::Value>	keys;
+			};
+
+			/// <summary>Representing the methods of an interface implemented by a [F:vl.workflow.runtime.WfInsCode.CreateInterface] instruction. All objects created by the instruction share the table.</summary>
+			class WfMethodTable : public Object
+			{
+			public:
+				/// <summary>Implemented interface methods.</summary>
+				collections::List<reflection::description::IMethodInfo*>	methods;
+				/// <summary>Function index implementing each method. Captured variables of all functions are the same.</summary>
+				collections::List<vint>								functions;
 			};
 
 			/// <summary>Representing debug informations.</summary>
@@ -266,16 +407,22 @@ Assembly
 				void												Initialize();
 			};
 
+			class WfAssemblyImage;
+
 			/// <summary>Representing a Workflow assembly.</summary>
 			class WfAssembly : public Object, public reflection::Description<WfAssembly>
 			{
+				friend class WfAssemblyImage;
 			protected:
+				Ptr<stream::IStream>								serializedDebugInfo;	// debug informations that are not deserialized yet
+				CriticalSection										debugInfoLock;			// debug informations could be loaded by any thread that reports an exception
+
 				template<typename TIO>
-				void IO(TIO& io);
+				void IO(TIO& io, bool withInstructions = true);
 			public:
-				/// <summary>Debug informations using the module code.</summary>
+				/// <summary>Debug informations using the module code. Debug informations of a deserialized assembly are loaded on first use, call <see cref="GetDebugInfo"/> instead of reading this field.</summary>
 				Ptr<WfInstructionDebugInfo>							insBeforeCodegen;
-				/// <summary>Debug informations using the module code from generated syntax trees from the final compiling pass.</summary>
+				/// <summary>Debug informations using the module code from generated syntax trees from the final compiling pass. Debug informations of a deserialized assembly are loaded on first use, call <see cref="GetDebugInfo"/> instead of reading this field.</summary>
 				Ptr<WfInstructionDebugInfo>							insAfterCodegen;
 				/// <summary>Global variable names. This index is for accessing [F:vl.workflow.runtime.WfRuntimeVariableContext.variables] in [F:vl.workflow.runtime.WfRuntimeCallStackInfo.global] when debugging.</summary>
 				collections::List<WString>							variableNames;
@@ -285,6 +432,19 @@ Assembly
 				collections::List<Ptr<WfAssemblyFunction>>			functions;
 				/// <summary>Instructions.</summary>
 				collections::List<WfInstruction>					instructions;
+				/// <summary>Jump tables for accessing from [F:vl.workflow.runtime.WfInsCode.SwitchTable] instructions.</summary>
+				collections::List<Ptr<WfSwitchTable>>				switchTables;
+				/// <summary>Method tables for accessing from [F:vl.workflow.runtime.WfInsCode.CreateInterface] instructions.</summary>
+				collections::List<Ptr<WfMethodTable>>				methodTables;
+				/// <summary>Constant sets for accessing from [F:vl.workflow.runtime.WfInsCode.TestElementInConstantSet] instructions.</summary>
+				collections::List<Ptr<WfConstantSet>>				constantSets;
+				/// <summary>True if <see cref="Verify"/> succeeded. Instructions of a verified assembly are executed without checking the stack and variable indexes.</summary>
+				bool												verified = false;
+				/// <summary>Error messages from the verification in <see cref="Initialize"/>. An assembly that fails the verification is rejected.</summary>
+				collections::List<WString>							verificationErrors;
+
+				/// <summary>Version of the binary format written by <see cref="Serialize"/>. Assemblies serialized in other versions cannot be loaded.</summary>
+				static const vint32_t								BinaryVersion = 3;
 
 				/// <summary>Create an empty assembly.</summary>
 				WfAssembly();
@@ -292,10 +452,232 @@ Assembly
 				/// <param name="input">Serialized binary data.</param>
 				WfAssembly(stream::IStream& input);
 				
+				/// <summary>Prepare debug informations and verify the assembly. A [T:vl.workflow.runtime.WfRuntimeException] with all error messages from the verification is thrown if the assembly fails the verification, the messages are also stored in <see cref="verificationErrors"/>.</summary>
 				void												Initialize();
-				/// <summary>Serialize an assembly.</summary>
+				/// <summary>Verify stack balance, variable indexes, jump targets and trap frames of all functions, and calculate [F:vl.workflow.runtime.WfAssemblyFunction.maxStackDepth].</summary>
+				/// <returns>Returns true if all functions pass the verification.</returns>
+				/// <param name="errors">Error messages for functions that fail the verification.</param>
+				bool												Verify(collections::List<WString>& errors);
+				/// <summary>Serialize an assembly. Strings used by reflection objects and constants are stored once in a string table, and each type and member is stored once in a symbol table.</summary>
 				/// <param name="output">Serialized binary data.</param>
-				void												Serialize(stream::IStream& output);
+				/// <param name="withDebugInfo">Set to false to write debug informations to a side file by <see cref="SerializeDebugInfo"/>, or to leave them out.</param>
+				void												Serialize(stream::IStream& output, bool withDebugInfo = true);
+
+				/// <summary>Get debug informations, deserialize them on first use. This function could be called in any thread.</summary>
+				/// <returns>The debug informations, or null if the assembly has no debug informations or they are serialized in an incompatible version.</returns>
+				/// <param name="beforeCodegen">Set to true to get <see cref="insBeforeCodegen"/>, otherwise <see cref="insAfterCodegen"/>.</param>
+				Ptr<WfInstructionDebugInfo>							GetDebugInfo(bool beforeCodegen);
+				/// <summary>Serialize debug informations only, for loading by <see cref="AttachDebugInfo"/>.</summary>
+				/// <param name="output">Serialized binary data, empty if the assembly has no debug informations.</param>
+				void												SerializeDebugInfo(stream::IStream& output);
+				/// <summary>Use debug informations from data written by <see cref="SerializeDebugInfo"/>. They are deserialized on first use.</summary>
+				/// <param name="input">Serialized binary data.</param>
+				void												AttachDebugInfo(stream::IStream& input);
+				/// <summary>Remove debug informations.</summary>
+				void												StripDebugInfo();
+			};
+
+/***********************************************************************
+RuntimeValue
+***********************************************************************/
+
+			/// <summary>Type descriptors of all primitive types that are stored unboxed in a <see cref="WfRuntimeValue"/>, indexed by <see cref="WfInsType"/>.</summary>
+			struct WfRuntimePrimitiveTypes
+			{
+				reflection::description::ITypeDescriptor*			typeDescriptors[(vint)WfInsType::Unknown];
+
+				WfRuntimePrimitiveTypes();
+
+				WfInsType											GetInsType(reflection::description::ITypeDescriptor* typeDescriptor)const;
+			};
+
+			/// <summary>A slot in the stack or in a variable context. Primitive values are stored unboxed, strings and all other values are stored in <see cref="boxedValue"/>. Values are only converted from or to [T:vl.reflection.description.Value] when they are passed through the reflection.</summary>
+			struct WfRuntimeValue
+			{
+				/// <summary>Type of the stored value. <see cref="boxedValue"/> is used for [F:vl.workflow.runtime.WfInsType.String] and [F:vl.workflow.runtime.WfInsType.Unknown].</summary>
+				WfInsType											type = WfInsType::Unknown;
+				union
+				{
+					bool											boolValue;
+					vint64_t										intValue;
+					vuint64_t										uintValue;
+					double											floatValue;
+				};
+				/// <summary>The stored string or object.</summary>
+				reflection::description::Value						boxedValue;
+
+				WfRuntimeValue()
+					:intValue(0)
+				{
+				}
+
+				/// <summary>Copy a slot. <see cref="boxedValue"/> is only touched when one of the slots is boxed, so copying primitive values costs no reference counting.</summary>
+				/// <param name="value">The slot to copy.</param>
+				WfRuntimeValue(const WfRuntimeValue& value)
+					:type(value.type)
+					, intValue(value.intValue)
+				{
+					if (value.IsBoxed())
+					{
+						boxedValue = value.boxedValue;
+					}
+				}
+
+				WfRuntimeValue& operator=(const WfRuntimeValue& value)
+				{
+					if (IsBoxed() || value.IsBoxed())
+					{
+						boxedValue = value.boxedValue;
+					}
+					type = value.type;
+					intValue = value.intValue;
+					return *this;
+				}
+
+				/// <summary>Test if the value is stored in <see cref="boxedValue"/>.</summary>
+				/// <returns>Returns true if the value is stored in <see cref="boxedValue"/>.</returns>
+				bool												IsBoxed()const
+				{
+					return type == WfInsType::String || type == WfInsType::Unknown;
+				}
+
+				bool												IsNull()const;
+				template<typename T>
+				T													Get()const;
+				/// <summary>Overwrite the slot with a primitive value in place.</summary>
+				/// <param name="value">The primitive value.</param>
+				template<typename T>
+				void												Set(const T& value);
+				template<typename T>
+				static WfRuntimeValue								From(const T& value);
+				static WfRuntimeValue								From(const WString& value, const WfRuntimePrimitiveTypes& types);
+				static WfRuntimeValue								FromValue(const reflection::description::Value& value, const WfRuntimePrimitiveTypes& types);
+
+				/// <summary>Convert to a boxed value.</summary>
+				/// <returns>The boxed value.</returns>
+				reflection::description::Value						ToValue()const;
+				/// <summary>Convert to a boxed value using cached type descriptors.</summary>
+				/// <returns>The boxed value.</returns>
+				/// <param name="types">Type descriptors of all primitive types.</param>
+				reflection::description::Value						ToValue(const WfRuntimePrimitiveTypes& types)const;
+			};
+
+			template<typename T>
+			struct WfRuntimeValueStorage
+			{
+			};
+
+#define DEFINE_RUNTIME_VALUE_STORAGE(TYPE, INSTYPE, FIELD)\
+			template<>\
+			struct WfRuntimeValueStorage<TYPE>\
+			{\
+				static const WfInsType Type = WfInsType::INSTYPE;\
+				static TYPE Read(const WfRuntimeValue& slot) { return (TYPE)slot.FIELD; }\
+				static void Write(WfRuntimeValue& slot, TYPE value) { slot.FIELD = value; }\
+			};\
+
+			DEFINE_RUNTIME_VALUE_STORAGE(bool,		Bool,	boolValue)
+			DEFINE_RUNTIME_VALUE_STORAGE(vint8_t,	I1,		intValue)
+			DEFINE_RUNTIME_VALUE_STORAGE(vint16_t,	I2,		intValue)
+			DEFINE_RUNTIME_VALUE_STORAGE(vint32_t,	I4,		intValue)
+			DEFINE_RUNTIME_VALUE_STORAGE(vint64_t,	I8,		intValue)
+			DEFINE_RUNTIME_VALUE_STORAGE(vuint8_t,	U1,		uintValue)
+			DEFINE_RUNTIME_VALUE_STORAGE(vuint16_t,	U2,		uintValue)
+			DEFINE_RUNTIME_VALUE_STORAGE(vuint32_t,	U4,		uintValue)
+			DEFINE_RUNTIME_VALUE_STORAGE(vuint64_t,	U8,		uintValue)
+			DEFINE_RUNTIME_VALUE_STORAGE(float,		F4,		floatValue)
+			DEFINE_RUNTIME_VALUE_STORAGE(double,	F8,		floatValue)
+
+#undef DEFINE_RUNTIME_VALUE_STORAGE
+
+			template<>
+			struct WfRuntimeValueStorage<WString>
+			{
+				static const WfInsType Type = WfInsType::String;
+				static WString Read(const WfRuntimeValue& slot) { return slot.boxedValue.GetText(); }
+			};
+
+			template<typename T>
+			T WfRuntimeValue::Get()const
+			{
+				if (type == WfRuntimeValueStorage<T>::Type)
+				{
+					return WfRuntimeValueStorage<T>::Read(*this);
+				}
+				return reflection::description::UnboxValue<T>(ToValue());
+			}
+
+			template<typename T>
+			void WfRuntimeValue::Set(const T& value)
+			{
+				if (IsBoxed())
+				{
+					boxedValue = reflection::description::Value();
+				}
+				type = WfRuntimeValueStorage<T>::Type;
+				WfRuntimeValueStorage<T>::Write(*this, value);
+			}
+
+			template<typename T>
+			WfRuntimeValue WfRuntimeValue::From(const T& value)
+			{
+				WfRuntimeValue slot;
+				slot.type = WfRuntimeValueStorage<T>::Type;
+				WfRuntimeValueStorage<T>::Write(slot, value);
+				return slot;
+			}
+
+/***********************************************************************
+RuntimeMap
+***********************************************************************/
+
+			/// <summary>A map created by [F:vl.workflow.runtime.WfInsCode.CreateHashMap]. Keys are found by hashing instead of binary searching, so setting or removing a key does not move other keys. Keys are equal in the same way as [M:vl.reflection.description.Value.Compare]: texts are hashed by characters, objects are hashed by pointers. Keys and values are enumerated in inserting order.</summary>
+			class WfRuntimeHashMap : public Object, public virtual reflection::description::IValueDictionary
+			{
+				typedef collections::List<reflection::description::Value>		ValueList;
+				typedef collections::Array<vint>								BucketArray;
+
+				class EntryList;
+				class KeyList;
+			protected:
+				ValueList										keys;			// keys in inserting order, removed keys are null until compacted
+				ValueList										values;
+				BucketArray										buckets;		// hash slot -> index in keys, -1 for empty slots, -2 for removed keys
+				vint											removedCount = 0;
+				Ptr<reflection::description::IValueReadonlyList>	keyList;
+				Ptr<reflection::description::IValueReadonlyList>	valueList;
+
+				void											Rehash(vint bucketCount);
+				void											Compact();
+				vint											FindSlot(const reflection::description::Value& key);
+			public:
+				WfRuntimeHashMap();
+
+				/// <summary>Compute the hash of an integer.</summary>
+				/// <returns>The hash.</returns>
+				/// <param name="number">The integer.</param>
+				static vuint64_t								GetHash(vuint64_t number);
+				/// <summary>Compute the hash of a text.</summary>
+				/// <returns>The hash.</returns>
+				/// <param name="text">The text.</param>
+				static vuint64_t								GetHash(const WString& text);
+				/// <summary>Compute the hash of a value.</summary>
+				/// <returns>The hash.</returns>
+				/// <param name="value">The value.</param>
+				static vuint64_t								GetHash(const reflection::description::Value& value);
+
+				/// <summary>Find a key. Keys are compacted after removing, so the index is only valid until the next call to <see cref="Remove"/>.</summary>
+				/// <returns>The index of the key in <see cref="GetKeys"/>, or -1 if the key does not exist.</returns>
+				/// <param name="key">The key.</param>
+				vint											IndexOf(const reflection::description::Value& key);
+
+				reflection::description::IValueReadonlyList*	GetKeys()override;
+				reflection::description::IValueReadonlyList*	GetValues()override;
+				vint											GetCount()override;
+				reflection::description::Value					Get(const reflection::description::Value& key)override;
+				void											Set(const reflection::description::Value& key, const reflection::description::Value& value)override;
+				bool											Remove(const reflection::description::Value& key)override;
+				void											Clear()override;
 			};
 
 /***********************************************************************
@@ -304,22 +686,268 @@ RuntimeEnvironment
 
 			class WfRuntimeVariableContext : public Object
 			{
-				typedef collections::Array<reflection::description::Value>		VariableArray;
+				typedef collections::Array<WfRuntimeValue>						VariableArray;
 
 			public:
 				VariableArray					variables;
 			};
 
+#define RUNTIME_FAST_INSTRUCTION_CASES(APPLY, APPLY_SPECIALIZED)\
+			APPLY(LoadValue)\
+			APPLY(LoadLocalVar)\
+			APPLY(LoadCapturedVar)\
+			APPLY(LoadGlobalVar)\
+			APPLY(StoreLocalVar)\
+			APPLY(StoreGlobalVar)\
+			APPLY(Duplicate)\
+			APPLY(Pop)\
+			APPLY(Jump)\
+			APPLY(JumpIf)\
+			APPLY(OpLT)\
+			APPLY(OpGT)\
+			APPLY(OpLE)\
+			APPLY(OpGE)\
+			APPLY(OpEQ)\
+			APPLY(OpNE)\
+			INSTRUCTION_SPECIALIZED_CASES(APPLY_SPECIALIZED)\
+			APPLY(LoadLocalVar2)\
+			APPLY(IncreaseLocalVar)\
+			APPLY(JumpIfLT)\
+			APPLY(JumpIfGT)\
+			APPLY(JumpIfLE)\
+			APPLY(JumpIfGE)\
+			APPLY(JumpIfEQ)\
+			APPLY(JumpIfNE)\
+			APPLY(SwitchTable)\
+			APPLY(Invoke)\
+			APPLY(TailInvoke)\
+			APPLY(Return)\
+
+			/// <summary>Instruction handlers of the execution loop that runs without a debugger. Instructions without a dedicated handler use Generic.</summary>
+			enum class WfRuntimeFastInsCode : vuint8_t
+			{
+				Generic,
+#define FAST_INSCODE(NAME)						NAME,
+#define FAST_INSCODE_SPECIALIZED(NAME, TYPE)	NAME##_##TYPE,
+				RUNTIME_FAST_INSTRUCTION_CASES(FAST_INSCODE, FAST_INSCODE_SPECIALIZED)
+#undef FAST_INSCODE
+#undef FAST_INSCODE_SPECIALIZED
+			};
+
+			/// <summary>A packed instruction executed by the runtime, decoded from a <see cref="WfInstruction"/> when a <see cref="WfRuntimeGlobalContext"/> is created. Constants and reflection objects are stored in tables of the global context, <see cref="indexParameter"/> is the index in the table.</summary>
+			struct WfRuntimeInstruction
+			{
+				WfInsCode						code = WfInsCode::Nop;
+				WfRuntimeFastInsCode			fastCode = WfRuntimeFastInsCode::Generic;
+				vuint8_t						flagParameter = 0;
+				vint32_t						countParameter = 0;
+				vint32_t						indexParameter = 0;
+			};
+
+			/// <summary>A jump table decoded from a <see cref="WfSwitchTable"/> or a <see cref="WfConstantSet"/>. Integer keys in a small range are looked up in an array, other keys are looked up in a hash table using [M:vl.workflow.runtime.WfRuntimeHashMap.GetHash].</summary>
+			class WfRuntimeSwitchTable : public Object
+			{
+				typedef collections::Array<vint32_t>											LabelArray;
+				typedef collections::List<vuint64_t>											IntegerKeyList;
+				typedef collections::List<WString>												StringKeyList;
+				typedef collections::List<vint32_t>												LabelList;
+				typedef collections::Array<vint32_t>											BucketArray;
+
+				vint							FindIntegerKey(vuint64_t key)const;
+				vint							FindStringKey(const WString& key)const;
+				void							AddBucket(vuint64_t hash, vint index);
+				void							AddKeys(const collections::List<reflection::description::Value>& keys, const collections::List<vint>* labels, const WfRuntimePrimitiveTypes& types);
+			public:
+				WfInsType						type = WfInsType::Unknown;
+				vuint64_t						firstKey = 0;		// the smallest key when denseLabels is used
+				LabelArray						denseLabels;		// key - firstKey -> label, -1 for values that are not keys
+				IntegerKeyList					integerKeys;		// integer keys when denseLabels is not used
+				StringKeyList					stringKeys;			// string keys
+				LabelList						hashedLabels;		// index in integerKeys or stringKeys -> label
+				BucketArray						buckets;			// hash slot -> index in integerKeys or stringKeys, -1 for empty slots
+
+				WfRuntimeSwitchTable(WfSwitchTable* table, const WfRuntimePrimitiveTypes& types);
+				/// <summary>Create a table for a constant set. The label of all keys is 0.</summary>
+				/// <param name="set">The constant set.</param>
+				/// <param name="types">Type descriptors of all primitive types.</param>
+				WfRuntimeSwitchTable(WfConstantSet* set, const WfRuntimePrimitiveTypes& types);
+
+				/// <summary>Find the label for a value.</summary>
+				/// <returns>The instruction index to jump to, or -1 if the value is not a key.</returns>
+				/// <param name="value">The value.</param>
+				/// <param name="types">Type descriptors of all primitive types.</param>
+				vint							FindLabel(const WfRuntimeValue& value, const WfRuntimePrimitiveTypes& types)const;
+			};
+
+			class WfRuntimeMethodTable;
+
+			/// <summary>A method in a <see cref="WfRuntimeMethodTable"/>.</summary>
+			struct WfRuntimeMethodSlot
+			{
+				WfRuntimeMethodTable*							table = nullptr;
+				reflection::description::IMethodInfo*			methodInfo = nullptr;
+				vint											functionIndex = -1;
+			};
+
+			/// <summary>A method table decoded from a <see cref="WfMethodTable"/>. Script calls find a slot by the method, calls from C++ through an interface proxy find a slot by the method name.</summary>
+			class WfRuntimeMethodTable : public Object
+			{
+				typedef collections::Array<WfRuntimeMethodSlot>									SlotArray;
+				typedef collections::Dictionary<reflection::description::IMethodInfo*, vint>	SlotIndexMap;
+				typedef collections::Dictionary<WString, vint>									SlotNameMap;
+			public:
+				SlotArray						slots;
+				SlotIndexMap					slotsByMethod;		// method -> slot
+				SlotNameMap						slotsByName;		// method name -> slot
+
+				WfRuntimeMethodTable(WfMethodTable* table);
+
+				/// <summary>Find the slot for a method.</summary>
+				/// <returns>The slot, or null if the method is not implemented.</returns>
+				/// <param name="methodInfo">The method.</param>
+				const WfRuntimeMethodSlot*		FindSlot(reflection::description::IMethodInfo* methodInfo)const;
+			};
+
+			/// <summary>A typed C++ implementation of a reflected method. Arguments are read from the stack without boxing.</summary>
+			/// <returns>The return value.</returns>
+			/// <param name="thisObject">The receiver, which has been checked against the owner type of the method.</param>
+			/// <param name="arguments">Arguments in the order of parameters.</param>
+			/// <param name="types">Type descriptors of all primitive types.</param>
+			typedef WfRuntimeValue(*WfRuntimeMethodThunk)(reflection::DescriptableObject* thisObject, WfRuntimeValue* arguments, const WfRuntimePrimitiveTypes& types);
+
+			/// <summary>A pointer shared by all threads executing the same global context, and read and written without locking. Copying it copies the current value.</summary>
+			/// <typeparam name="T">Type of the object the pointer points to.</typeparam>
+			template<typename T>
+			class WfRuntimeCachedPointer
+			{
+			protected:
+				std::atomic<T*>									value;
+			public:
+				WfRuntimeCachedPointer(T* _value = nullptr) :value(_value) {}
+				WfRuntimeCachedPointer(const WfRuntimeCachedPointer<T>& pointer) :value(pointer.Load()) {}
+				WfRuntimeCachedPointer<T>& operator=(const WfRuntimeCachedPointer<T>& pointer) { Store(pointer.Load()); return *this; }
+
+				// objects stored in caches are created before any instruction is executed, so the pointer is the only value to order
+				T*												Load()const { return value.load(std::memory_order_relaxed); }
+				void											Store(T* _value) { value.store(_value, std::memory_order_relaxed); }
+			};
+
+			/// <summary>A call site of InvokeMethod or GetProperty. Arguments are proved by the analyzer, so after the receiver is checked, the method is called without checking arguments again.</summary>
+			struct WfRuntimeCallSite
+			{
+				reflection::description::IMethodInfo*			methodInfo = nullptr;		// the method to call, or the getter of the property
+				reflection::description::IPropertyInfo*			propertyInfo = nullptr;		// the property to read when the call site is GetProperty
+				reflection::description::MethodInfoImpl*		uncheckedMethod = nullptr;	// methodInfo if arguments could skip checking
+				WfRuntimeMethodThunk							thunk = nullptr;			// a typed implementation of methodInfo
+				WfRuntimeCachedPointer<reflection::description::ITypeDescriptor>	receiverType;	// the monomorphic inline cache: type of the last receiver that passed the check
+				bool											proxyMethod = false;		// true if the method could be implemented by CreateInterface
+				WfRuntimeCachedPointer<const WfRuntimeMethodSlot>				methodSlot;		// the monomorphic inline cache: slot of the last receiver created by CreateInterface
+			};
+
+			/// <summary>Stack frame layout of a function, decoded from a <see cref="WfAssemblyFunction"/>.</summary>
+			struct WfRuntimeFunction
+			{
+				vint											firstInstruction = -1;
+				vint											argumentCount = 0;
+				vint											capturedVariableCount = 0;
+				vint											localVariableCount = 0;
+				vint											maxStackDepth = -1;
+			};
+
+			/// <summary>Packed instructions of a global context. Instructions are either decoded into an owned array, or used in place from a <see cref="WfAssemblyImage"/>.</summary>
+			class WfRuntimeInstructionArray : public Object
+			{
+				typedef collections::Array<WfRuntimeInstruction>								InstructionArray;
+			protected:
+				InstructionArray				ownedInstructions;
+				const WfRuntimeInstruction*		buffer = nullptr;
+				vint							count = 0;
+			public:
+				vint							Count()const { return count; }
+				const WfRuntimeInstruction&		operator[](vint index)const { return buffer[index]; }
+
+				/// <summary>Allocate owned instructions.</summary>
+				/// <returns>The first instruction to fill.</returns>
+				/// <param name="_count">The number of instructions.</param>
+				WfRuntimeInstruction*			Allocate(vint _count);
+				/// <summary>Use instructions in place. The buffer is not copied, it must be alive until this object is destroyed.</summary>
+				/// <param name="_buffer">The first instruction.</param>
+				/// <param name="_count">The number of instructions.</param>
+				void							Attach(const WfRuntimeInstruction* _buffer, vint _count);
+			};
+
 			/// <summary>Global context for executing a Workflow program. After the context is prepared, use [M:vl.workflow.runtime.LoadFunction] to call any functions inside the assembly. Function "&lt;initialize&gt;" should be the first to execute.</summary>
 			class WfRuntimeGlobalContext : public Object
 			{
+				typedef collections::Array<WfRuntimeFunction>									FunctionArray;
+				typedef collections::List<WfRuntimeValue>										ConstantList;
+				typedef collections::List<reflection::description::ITypeDescriptor*>			TypeDescriptorList;
+				typedef collections::List<WfRuntimeCallSite>									CallSiteList;
+				typedef collections::List<reflection::description::IEventInfo*>				EventList;
+				typedef collections::List<Ptr<WfRuntimeSwitchTable>>							SwitchTableList;
+				typedef collections::List<Ptr<WfRuntimeMethodTable>>							MethodTableList;
+
+				void							InitializeTables();
 			public:
 				Ptr<WfAssembly>					assembly;
+				Ptr<WfAssemblyImage>			image;				// the image that owns instructions, if the context is created from an image
 				Ptr<WfRuntimeVariableContext>	globalVariables;
-				
+				WfRuntimePrimitiveTypes			primitiveTypes;
+				WfRuntimeInstructionArray		instructions;		// instruction -> packed instruction
+				FunctionArray					functions;			// function -> stack frame layout
+				ConstantList					constants;			// LoadValue
+				TypeDescriptorList				typeDescriptors;	// ConvertToType, TryConvertToType, TestType
+				CallSiteList					callSites;			// InvokeMethod, GetProperty
+				EventList						events;				// AttachEvent
+				SwitchTableList					switchTables;		// SwitchTable
+				MethodTableList					methodTables;		// CreateInterface
+				SwitchTableList					constantSets;		// TestElementInConstantSet
+
 				/// <summary>Create a global context for executing a Workflow program.</summary>
 				/// <param name="_assembly">The assembly.</param>
 				WfRuntimeGlobalContext(Ptr<WfAssembly> _assembly);
+				/// <summary>Create a global context for executing a Workflow program from an image. Packed instructions are used in place.</summary>
+				/// <param name="_image">The image.</param>
+				WfRuntimeGlobalContext(Ptr<WfAssemblyImage> _image);
+			};
+
+			/// <summary>
+			/// A compiled assembly laid out to be used in place, for example from a read-only memory mapped file.
+			/// Packed instructions are not copied, so all global contexts created from the same image share them.
+			/// Only metadata, constants and reflection objects are loaded into writable memory.
+			/// An image can only be loaded on a platform with the same pointer size and byte order as the one that wrote it, and its instructions are verified again when it is loaded.
+			/// </summary>
+			class WfAssemblyImage : public Object
+			{
+			public:
+				/// <summary>The assembly for function names, tables and debug informations. Its instructions are decoded from the packed instructions and verified again when the image is loaded.</summary>
+				Ptr<WfAssembly>										assembly;
+				/// <summary>Packed instructions in the image.</summary>
+				const WfRuntimeInstruction*							instructions = nullptr;
+				/// <summary>The number of packed instructions.</summary>
+				vint												instructionCount = 0;
+				/// <summary>Stack frame layouts of functions in the image.</summary>
+				const WfRuntimeFunction*							functions = nullptr;
+				/// <summary>Constants for [F:vl.workflow.runtime.WfRuntimeGlobalContext.constants].</summary>
+				collections::List<reflection::description::Value>	constants;
+				/// <summary>Types for [F:vl.workflow.runtime.WfRuntimeGlobalContext.typeDescriptors].</summary>
+				collections::List<reflection::description::ITypeDescriptor*>	typeDescriptors;
+				/// <summary>Methods of call sites, null for call sites that read properties.</summary>
+				collections::List<reflection::description::IMethodInfo*>		callSiteMethods;
+				/// <summary>Properties of call sites, null for call sites that call methods.</summary>
+				collections::List<reflection::description::IPropertyInfo*>	callSiteProperties;
+				/// <summary>Events for [F:vl.workflow.runtime.WfRuntimeGlobalContext.events].</summary>
+				collections::List<reflection::description::IEventInfo*>		events;
+
+				/// <summary>Load an image. The buffer is not copied, it must be alive until this image and all global contexts created from it are destroyed. An image that does not match its verified instructions is rejected.</summary>
+				/// <param name="buffer">The image, aligned to at least 8 bytes.</param>
+				/// <param name="size">Size of the image in bytes.</param>
+				WfAssemblyImage(const void* buffer, vint size);
+
+				/// <summary>Write the image of a global context.</summary>
+				/// <param name="context">The global context created from an assembly.</param>
+				/// <param name="output">The image.</param>
+				static void											Write(WfRuntimeGlobalContext* context, stream::IStream& output);
 			};
 
 			struct WfRuntimeStackFrame
@@ -497,11 +1125,42 @@ RuntimeThreadContext
 				StackCorrupted,
 			};
 
+			/// <summary>The value stack of a thread context. Slots after the top are always reset by the list, so they are pushed without initialization.</summary>
+			class WfRuntimeValueStack : public collections::List<WfRuntimeValue>
+			{
+			public:
+				/// <summary>Push null values.</summary>
+				/// <param name="_count">The number of values.</param>
+				void PushDefaultValues(vint _count)
+				{
+					if (_count > 0)
+					{
+						MakeRoom(count, _count);
+					}
+				}
+
+				/// <summary>Grow the buffer without changing the stack.</summary>
+				/// <param name="_capacity">The number of values the buffer should hold.</param>
+				void Reserve(vint _capacity)
+				{
+					if (_capacity > count)
+					{
+						vint oldCount = count;
+						MakeRoom(count, _capacity - count);
+						count = oldCount;
+					}
+				}
+			};
+
 			struct WfRuntimeThreadContext
 			{
-				typedef collections::List<reflection::description::Value>		VariableList;
+				typedef WfRuntimeValueStack										VariableList;
 				typedef collections::List<WfRuntimeStackFrame>					StackFrameList;
 				typedef collections::List<WfRuntimeTrapFrame>					TrapFrameList;
+				typedef collections::List<reflection::description::Value>		ArgumentList;
+				typedef collections::Array<reflection::description::Value>		ArgumentArray;
+
+				static const vint				CachedArgumentCount = 8;
 
 				Ptr<WfRuntimeGlobalContext>		globalContext;
 				Ptr<WfRuntimeExceptionInfo>		exceptionInfo;
@@ -509,30 +1168,46 @@ RuntimeThreadContext
 				StackFrameList					stackFrames;
 				TrapFrameList					trapFrames;
 				WfRuntimeExecutionStatus		status = WfRuntimeExecutionStatus::Finished;
+				vint							reservedStackSize = 0;
+
+				// the thread context is blocked during a call into C++, so argument containers are reused by all calls
+				ArgumentList					proxyArguments;								// arguments for InvokeProxy
+				Ptr<reflection::description::IValueList>	proxyArgumentList;				// a wrapper of proxyArguments
+				ArgumentArray					methodArguments[CachedArgumentCount + 1];	// argument count -> arguments for InvokeMethod
+				collections::Array<wchar_t>		concatBuffer;								// characters for ConcatN
 
 				WfRuntimeThreadContext(Ptr<WfRuntimeGlobalContext> _context);
 				WfRuntimeThreadContext(Ptr<WfAssembly> _assembly);
 
 				WfRuntimeStackFrame&			GetCurrentStackFrame();
 				WfRuntimeThreadContextError		PushStackFrame(vint functionIndex, vint argumentCount, Ptr<WfRuntimeVariableContext> capturedVariables = 0);
-				WfRuntimeThreadContextError		PopStackFrame();
+				WfRuntimeThreadContextError		ReplaceStackFrame(vint functionIndex, vint argumentCount);
+				WfRuntimeThreadContextError		PopStackFrame(vint saveStackPatternCount = 0);
 				WfRuntimeTrapFrame&				GetCurrentTrapFrame();
 				WfRuntimeThreadContextError		PushTrapFrame(vint instructionIndex);
 				WfRuntimeThreadContextError		PopTrapFrame(vint saveStackPatternCount);
+				WfRuntimeThreadContextError		PushValue(const WfRuntimeValue& value);
 				WfRuntimeThreadContextError		PushValue(const reflection::description::Value& value);
+				WfRuntimeThreadContextError		PopValue(WfRuntimeValue& value);
 				WfRuntimeThreadContextError		PopValue(reflection::description::Value& value);
+				WfRuntimeValue&					PushValue();
+				WfRuntimeThreadContextError		GetTopValues(vint count, WfRuntimeValue*& values);
+				WfRuntimeThreadContextError		PopValues(vint count);
+				void							PopValuesUnchecked(vint count);
 				WfRuntimeThreadContextError		RaiseException(const WString& exception, bool fatalError, bool skipDebugger = false);
 				WfRuntimeThreadContextError		RaiseException(Ptr<WfRuntimeExceptionInfo> info, bool skipDebugger = false);
 
-				WfRuntimeThreadContextError		LoadStackValue(vint stackItemIndex, reflection::description::Value& value);
-				WfRuntimeThreadContextError		LoadGlobalVariable(vint variableIndex, reflection::description::Value& value);
-				WfRuntimeThreadContextError		StoreGlobalVariable(vint variableIndex, const reflection::description::Value& value);
-				WfRuntimeThreadContextError		LoadCapturedVariable(vint variableIndex, reflection::description::Value& value);
-				WfRuntimeThreadContextError		LoadLocalVariable(vint variableIndex, reflection::description::Value& value);
-				WfRuntimeThreadContextError		StoreLocalVariable(vint variableIndex, const reflection::description::Value& value);
+				WfRuntimeThreadContextError		LoadStackValue(vint stackItemIndex, WfRuntimeValue& value);
+				WfRuntimeThreadContextError		LoadGlobalVariable(vint variableIndex, WfRuntimeValue& value);
+				WfRuntimeThreadContextError		StoreGlobalVariable(vint variableIndex, const WfRuntimeValue& value);
+				WfRuntimeThreadContextError		LoadCapturedVariable(vint variableIndex, WfRuntimeValue& value);
+				WfRuntimeThreadContextError		LoadLocalVariable(vint variableIndex, WfRuntimeValue& value);
+				WfRuntimeThreadContextError		StoreLocalVariable(vint variableIndex, const WfRuntimeValue& value);
 
-				WfRuntimeExecutionAction		ExecuteInternal(WfInstruction& ins, WfRuntimeStackFrame& stackFrame, IWfDebuggerCallback* callback);
+				WfRuntimeExecutionAction		ExecuteInternal(const WfRuntimeInstruction& ins, WfRuntimeStackFrame& stackFrame, IWfDebuggerCallback* callback);
 				WfRuntimeExecutionAction		Execute(IWfDebuggerCallback* callback);
+				WfRuntimeExecutionAction		ExecuteFastInternal();
+				void							ExecuteFast();
 				void							ExecuteToEnd();
 			};
 
@@ -864,6 +1539,10 @@ Helper Functions
 			/// <param name="context">The context to the evaluation environment.</param>
 			/// <param name="name">The function name.</param>
 			extern Ptr<reflection::description::IValueFunctionProxy>		LoadFunction(Ptr<WfRuntimeGlobalContext> context, const WString& name);
+
+			/// <summary>Get the number of idle thread contexts kept by the current thread for calling functions from C++.</summary>
+			/// <returns>The number of idle thread contexts.</returns>
+			extern vint														GetIdleThreadContextCount();
 			
 			/// <summary>Load a C++ friendly function from a global context, raise an exception if multiple functions are found under the same name. Function "&gt;initialize&lt;" should be the first to execute.</summary>
 			/// <typeparam name="TFunction">Type of the function.</typeparam>
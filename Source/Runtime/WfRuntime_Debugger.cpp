@@ -105,7 +105,8 @@ InstructionLocation
 				if (assembly != il.assembly) return true;
 				if (stackFrameIndex != il.stackFrameIndex) return stackFrameIndex > il.stackFrameIndex;
 
-				auto debugInfo = (beforeCodegen ? assembly->insBeforeCodegen : assembly->insAfterCodegen);
+				auto debugInfo = assembly->GetDebugInfo(beforeCodegen);
+				if (!debugInfo) return true;
 				auto& range1 = debugInfo->instructionCodeMapping[instruction];
 				auto& range2 = debugInfo->instructionCodeMapping[il.instruction];
 
@@ -121,7 +122,8 @@ InstructionLocation
 				if (assembly != il.assembly) return true;
 				if (stackFrameIndex != il.stackFrameIndex) return true;
 
-				auto debugInfo = (beforeCodegen ? assembly->insBeforeCodegen : assembly->insAfterCodegen);
+				auto debugInfo = assembly->GetDebugInfo(beforeCodegen);
+				if (!debugInfo) return true;
 				auto& range1 = debugInfo->instructionCodeMapping[instruction];
 				auto& range2 = debugInfo->instructionCodeMapping[il.instruction];
 
@@ -489,7 +491,13 @@ WfDebugger
 
 			vint WfDebugger::AddCodeLineBreakPoint(WfAssembly* assembly, vint codeIndex, vint row, bool beforeCodegen)
 			{
-				auto& codeInsMap = (beforeCodegen ? assembly->insBeforeCodegen : assembly->insAfterCodegen)->codeInstructionMapping;
+				auto debugInfo = assembly->GetDebugInfo(beforeCodegen);
+				if (!debugInfo)
+				{
+					return -1;
+				}
+
+				auto& codeInsMap = debugInfo->codeInstructionMapping;
 				Tuple<vint, vint> key(codeIndex, row);
 				vint index = codeInsMap.Keys().IndexOf(key);
 				if (index == -1)
@@ -659,7 +667,12 @@ WfDebugger
 
 				auto& stackFrame = context->stackFrames[callStackIndex];
 				auto ins = stackFrame.nextInstructionIndex;
-				auto debugInfo = (beforeCodegen ? context->globalContext->assembly->insBeforeCodegen : context->globalContext->assembly->insAfterCodegen);
+				auto debugInfo = context->globalContext->assembly->GetDebugInfo(beforeCodegen);
+				if (!debugInfo)
+				{
+					static const parsing::ParsingTextRange emptyRange;
+					return emptyRange;
+				}
 				return debugInfo->instructionCodeMapping[ins];
 			}
 
@@ -680,25 +693,25 @@ WfDebugger
 				vint index = function->argumentNames.IndexOf(name);
 				if (index != -1)
 				{
-					return context->stack[stackFrame.stackBase + index];
+					return context->stack[stackFrame.stackBase + index].ToValue(context->globalContext->primitiveTypes);
 				}
 
 				index = function->localVariableNames.IndexOf(name);
 				if (index != -1)
 				{
-					return context->stack[stackFrame.stackBase + function->argumentNames.Count() + index];
+					return context->stack[stackFrame.stackBase + function->argumentNames.Count() + index].ToValue(context->globalContext->primitiveTypes);
 				}
 
 				index = function->capturedVariableNames.IndexOf(name);
 				if (index != -1)
 				{
-					return stackFrame.capturedVariables->variables[index];
+					return stackFrame.capturedVariables->variables[index].ToValue(context->globalContext->primitiveTypes);
 				}
 
 				index = context->globalContext->assembly->variableNames.IndexOf(name);
 				if (index != -1)
 				{
-					return context->globalContext->globalVariables->variables[index];
+					return context->globalContext->globalVariables->variables[index].ToValue(context->globalContext->primitiveTypes);
 				}
 
 				return Value();
@@ -15,6 +15,19 @@ namespace vl
 WfRuntimeThreadContext (Operators)
 ***********************************************************************/
 
+#define TYPE_OF_Bool							bool
+#define TYPE_OF_I1								vint8_t
+#define TYPE_OF_I2								vint16_t
+#define TYPE_OF_I4								vint32_t
+#define TYPE_OF_I8								vint64_t
+#define TYPE_OF_U1								vuint8_t
+#define TYPE_OF_U2								vuint16_t
+#define TYPE_OF_U4								vuint32_t
+#define TYPE_OF_U8								vuint64_t
+#define TYPE_OF_F4								float
+#define TYPE_OF_F8								double
+#define TYPE_OF_String							WString
+
 #define INTERNAL_ERROR(MESSAGE)\
 				do{\
 					context.RaiseException(WString(L"Internal error: " MESSAGE), true);\
@@ -35,10 +48,10 @@ WfRuntimeThreadContext (Operators)
 			template<typename T>\
 			WfRuntimeExecutionAction OPERATOR_##NAME(WfRuntimeThreadContext& context)\
 			{\
-				Value operand;\
-				CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");\
-				T value = OPERATOR UnboxValue<T>(operand);\
-				context.PushValue(BoxValue(value));\
+				WfRuntimeValue* operand;\
+				CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");\
+				T value = OPERATOR operand->Get<T>();\
+				operand->Set(value);\
 				return WfRuntimeExecutionAction::ExecuteInstruction;\
 			}\
 
@@ -46,11 +59,11 @@ WfRuntimeThreadContext (Operators)
 			template<typename T>\
 			WfRuntimeExecutionAction OPERATOR_##NAME(WfRuntimeThreadContext& context)\
 			{\
-				Value first, second;\
-				CONTEXT_ACTION(PopValue(second), L"failed to pop a value from the stack.");\
-				CONTEXT_ACTION(PopValue(first), L"failed to pop a value from the stack.");\
-				T value = UnboxValue<T>(first) OPERATOR UnboxValue<T>(second);\
-				context.PushValue(BoxValue(value));\
+				WfRuntimeValue* operands;\
+				CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");\
+				T value = operands[0].Get<T>() OPERATOR operands[1].Get<T>();\
+				operands[0].Set(value);\
+				context.PopValuesUnchecked(1);\
 				return WfRuntimeExecutionAction::ExecuteInstruction;\
 			}\
 
@@ -69,77 +82,113 @@ WfRuntimeThreadContext (Operators)
 			BINARY_OPERATOR(OpShl, <<)
 			BINARY_OPERATOR(OpShr, >>)
 			BINARY_OPERATOR(OpAnd, &)
-			BINARY_OPERATOR(OpAnd_Bool, &&)
 			BINARY_OPERATOR(OpOr, |)
-			BINARY_OPERATOR(OpOr_Bool, ||)
 			BINARY_OPERATOR(OpXor, ^)
 
+			template<>
+			WfRuntimeExecutionAction OPERATOR_OpNot<bool>(WfRuntimeThreadContext& context)
+			{
+				return OPERATOR_OpNot_Bool<bool>(context);
+			}
+
 			template<typename T>
 			WfRuntimeExecutionAction OPERATOR_OpExp(WfRuntimeThreadContext& context)
 			{
-				Value first, second;
-				CONTEXT_ACTION(PopValue(second), L"failed to pop a value from the stack.");
-				CONTEXT_ACTION(PopValue(first), L"failed to pop a value from the stack.");
-				T firstValue = UnboxValue<T>(first);
-				T secondValue = UnboxValue<T>(second);
+				WfRuntimeValue* operands;
+				CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");
+				T firstValue = operands[0].Get<T>();
+				T secondValue = operands[1].Get<T>();
 				T value = exp(secondValue * log(firstValue));
-				context.PushValue(BoxValue(value));
+				operands[0].Set(value);
+				context.PopValuesUnchecked(1);
 				return WfRuntimeExecutionAction::ExecuteInstruction;
 			}
 			
 			template<typename T>
-			WfRuntimeExecutionAction OPERATOR_OpCompare(WfRuntimeThreadContext& context)
+			vint OPERATOR_CompareLiteral(const WfRuntimeValue& first, const WfRuntimeValue& second)
 			{
-				Value first, second;
-				CONTEXT_ACTION(PopValue(second), L"failed to pop a value from the stack.");
-				CONTEXT_ACTION(PopValue(first), L"failed to pop a value from the stack.");
-
-				bool firstNull = first.GetValueType() == Value::Null;
-				bool secondNull = second.GetValueType() == Value::Null;
+				vint result = 0;
+				bool firstNull = first.IsNull();
+				bool secondNull = second.IsNull();
 				if (firstNull)
 				{
-					if (secondNull)
-					{
-						context.PushValue(BoxValue((vint)0));
-					}
-					else
-					{
-						context.PushValue(BoxValue((vint)-1));
-					}
+					result = secondNull ? 0 : -1;
+				}
+				else if (secondNull)
+				{
+					result = 1;
 				}
 				else
 				{
-					if (secondNull)
-					{context.PushValue(BoxValue((vint)1));
+					T firstValue = first.Get<T>();
+					T secondValue = second.Get<T>();
+					if (firstValue < secondValue)
+					{
+						result = -1;
 					}
-					else
+					else if (firstValue > secondValue)
 					{
-						T firstValue = UnboxValue<T>(first);
-						T secondValue = UnboxValue<T>(second);
-						if (firstValue < secondValue)
-						{
-							context.PushValue(BoxValue((vint)-1));
-						}
-						else if (firstValue > secondValue)
-						{
-							context.PushValue(BoxValue((vint)1));
-						}
-						else
-						{
-							context.PushValue(BoxValue((vint)0));
-						}
+						result = 1;
 					}
 				}
+				return result;
+			}
+
+			template<typename T>
+			WfRuntimeExecutionAction OPERATOR_CompareLiteral(WfRuntimeThreadContext& context)
+			{
+				WfRuntimeValue* operands;
+				CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");
+				vint result = OPERATOR_CompareLiteral<T>(operands[0], operands[1]);
+				operands[0].Set(result);
+				context.PopValuesUnchecked(1);
 				return WfRuntimeExecutionAction::ExecuteInstruction;
 			}
+
+			bool OPERATOR_CompareLiteral(WfInsType type, const WfRuntimeValue& first, const WfRuntimeValue& second, vint& result)
+			{
+				switch (type)
+				{
+#define COMPARE_LITERAL(NAME, TYPE)		case WfInsType::TYPE: result = OPERATOR_CompareLiteral<TYPE_OF_##TYPE>(first, second); return true;
+					INSTRUCTION_TYPES_B(COMPARE_LITERAL, CompareLiteral)
+					INSTRUCTION_TYPES_I(COMPARE_LITERAL, CompareLiteral)
+					INSTRUCTION_TYPES_U(COMPARE_LITERAL, CompareLiteral)
+					INSTRUCTION_TYPES_F(COMPARE_LITERAL, CompareLiteral)
+					INSTRUCTION_TYPES_S(COMPARE_LITERAL, CompareLiteral)
+#undef COMPARE_LITERAL
+				default:
+					return false;
+				}
+			}
+
+			bool OPERATOR_IncreaseValue(WfRuntimeValue& variable, const WfRuntimeValue& value)
+			{
+				switch (value.type)
+				{
+#define INCREASE_VALUE(NAME, TYPE)\
+				case WfInsType::TYPE:\
+					{\
+						TYPE_OF_##TYPE result = variable.Get<TYPE_OF_##TYPE>() + value.Get<TYPE_OF_##TYPE>();\
+						variable.Set(result);\
+					}\
+					return true;\
+
+					INSTRUCTION_TYPES_I(INCREASE_VALUE, IncreaseValue)
+					INSTRUCTION_TYPES_U(INCREASE_VALUE, IncreaseValue)
+					INSTRUCTION_TYPES_F(INCREASE_VALUE, IncreaseValue)
+#undef INCREASE_VALUE
+				default:
+					return false;
+				}
+			}
 			
 /***********************************************************************
 WfRuntimeThreadContext (TypeConversion)
 ***********************************************************************/
 
-			bool OPERATOR_OpConvertToType(const Value& result, Value& converted, const WfInstruction& ins)
+			bool OPERATOR_OpConvertToType(const Value& result, Value& converted, Value::ValueType flag, ITypeDescriptor* typeDescriptor)
 			{
-				switch (ins.flagParameter)
+				switch (flag)
 				{
 				case Value::Null:
 					return false;
@@ -150,7 +199,7 @@ WfRuntimeThreadContext (TypeConversion)
 					}
 					else if (result.GetRawPtr())
 					{
-						if (result.GetTypeDescriptor()->CanConvertTo(ins.typeDescriptorParameter))
+						if (result.GetTypeDescriptor()->CanConvertTo(typeDescriptor))
 						{
 							converted = Value::From(result.GetRawPtr());
 						}
@@ -167,7 +216,7 @@ WfRuntimeThreadContext (TypeConversion)
 					}
 					else if (result.GetRawPtr())
 					{
-						if (result.GetTypeDescriptor()->CanConvertTo(ins.typeDescriptorParameter))
+						if (result.GetTypeDescriptor()->CanConvertTo(typeDescriptor))
 						{
 							converted = Value::From(Ptr<DescriptableObject>(result.GetRawPtr()));
 						}
@@ -182,7 +231,7 @@ WfRuntimeThreadContext (TypeConversion)
 					{
 						return false;
 					}
-					else if (ins.typeDescriptorParameter == GetTypeDescriptor<void>())
+					else if (typeDescriptor == GetTypeDescriptor<void>())
 					{
 						if (result.GetText() != L"")
 						{
@@ -191,7 +240,7 @@ WfRuntimeThreadContext (TypeConversion)
 					}
 					else
 					{
-						auto serializer = ins.typeDescriptorParameter->GetValueSerializer();
+						auto serializer = typeDescriptor->GetValueSerializer();
 						if (!serializer)
 						{
 							return false;
@@ -260,15 +309,15 @@ WfRuntimeThreadContext (Range)
 			};
 			
 			template<typename T>
-			WfRuntimeExecutionAction OPERATOR_OpCreateRange(WfRuntimeThreadContext& context)
+			WfRuntimeExecutionAction OPERATOR_CreateRange(WfRuntimeThreadContext& context)
 			{
-				Value first, second;
-				CONTEXT_ACTION(PopValue(second), L"failed to pop a value from the stack.");
-				CONTEXT_ACTION(PopValue(first), L"failed to pop a value from the stack.");
-				T firstValue = UnboxValue<T>(first);
-				T secondValue = UnboxValue<T>(second);
+				WfRuntimeValue* operands;
+				CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");
+				T firstValue = operands[0].Get<T>();
+				T secondValue = operands[1].Get<T>();
 				auto enumerable = MakePtr<WfRuntimeRange<T>>(firstValue, secondValue);
-				context.PushValue(Value::From(enumerable));
+				operands[0] = WfRuntimeValue::FromValue(Value::From(enumerable), context.globalContext->primitiveTypes);
+				context.PopValuesUnchecked(1);
 				return WfRuntimeExecutionAction::ExecuteInstruction;
 			}
 			
@@ -336,6 +385,100 @@ WfRuntimeThreadContext (ReverseEnumerable)
 WfRuntimeThreadContext (Lambda)
 ***********************************************************************/
 
+			/// <summary>Idle thread contexts of the current thread. A context keeps its buffers after it is returned, so calling a function from C++ again does not allocate them.</summary>
+			class WfRuntimeThreadContextPool : public Object
+			{
+			public:
+				static const vint					MaxIdleContexts = 16;
+
+				collections::List<Ptr<WfRuntimeThreadContext>>	idleContexts;
+			};
+
+			ThreadVariable<Ptr<WfRuntimeThreadContextPool>> threadContextPool;
+
+			/// <summary>Borrow an idle thread context of the current thread, and return it when the call finishes. Nested calls borrow different contexts.</summary>
+			class WfRuntimeThreadContextLease : public Object
+			{
+			public:
+				Ptr<WfRuntimeThreadContext>			context;
+
+				WfRuntimeThreadContextLease(Ptr<WfRuntimeGlobalContext> globalContext)
+				{
+					if (threadContextPool.HasData())
+					{
+						auto& idleContexts = threadContextPool.Get()->idleContexts;
+						if (idleContexts.Count() > 0)
+						{
+							context = idleContexts[idleContexts.Count() - 1];
+							idleContexts.RemoveAt(idleContexts.Count() - 1);
+							context->globalContext = globalContext;
+							return;
+						}
+					}
+					context = new WfRuntimeThreadContext(globalContext);
+				}
+
+				~WfRuntimeThreadContextLease()
+				{
+					// values and the global context are released, buffers are kept for the next call
+					context->stack.Clear();
+					context->stackFrames.Clear();
+					context->trapFrames.Clear();
+					context->exceptionInfo = nullptr;
+					context->globalContext = nullptr;
+					context->status = WfRuntimeExecutionStatus::Finished;
+
+					if (!threadContextPool.HasData())
+					{
+						threadContextPool.Set(new WfRuntimeThreadContextPool);
+					}
+					auto& idleContexts = threadContextPool.Get()->idleContexts;
+					if (idleContexts.Count() < WfRuntimeThreadContextPool::MaxIdleContexts)
+					{
+						idleContexts.Add(context);
+					}
+				}
+			};
+
+			/// <summary>Call a function in a leased thread context.</summary>
+			template<typename TArguments>
+			WfRuntimeValue InvokeRuntimeFunction(Ptr<WfRuntimeGlobalContext> globalContext, vint functionIndex, Ptr<WfRuntimeVariableContext> capturedVariables, vint count, const TArguments& pushArguments)
+			{
+				WfRuntimeThreadContextLease lease(globalContext);
+				auto& context = *lease.context.Obj();
+				pushArguments(context);
+
+				if (context.PushStackFrame(functionIndex, count, capturedVariables) != WfRuntimeThreadContextError::Success)
+				{
+					throw WfRuntimeException(L"Internal error: failed to invoke a function.", true);
+				}
+
+				context.ExecuteToEnd();
+				if (context.status != WfRuntimeExecutionStatus::Finished)
+				{
+					throw WfRuntimeException(context.exceptionInfo);
+				}
+
+				WfRuntimeValue result;
+				if (context.PopValue(result) != WfRuntimeThreadContextError::Success)
+				{
+					throw WfRuntimeException(L"Internal error: failed to pop the function result.", true);
+				}
+				return result;
+			}
+
+			WfRuntimeValue InvokeRuntimeFunction(Ptr<WfRuntimeGlobalContext> globalContext, vint functionIndex, Ptr<WfRuntimeVariableContext> capturedVariables, Ptr<IValueList> arguments)
+			{
+				vint count = arguments->GetCount();
+				return InvokeRuntimeFunction(globalContext, functionIndex, capturedVariables, count, [&](WfRuntimeThreadContext& context)
+				{
+					for (vint i = 0; i < count; i++)
+					{
+						context.PushValue(arguments->Get(i));
+					}
+				});
+			}
+
 			class WfRuntimeLambda : public Object, public IValueFunctionProxy
 			{
 			public:
@@ -350,34 +493,46 @@ WfRuntimeThreadContext (Lambda)
 				{
 				}
 
+				template<typename TArguments>
+				WfRuntimeValue Invoke(vint count, const TArguments& pushArguments)
+				{
+					return InvokeRuntimeFunction(globalContext, functionIndex, capturedVariables, count, pushArguments);
+				}
+
 				Value Invoke(Ptr<IValueList> arguments)override
 				{
-					WfRuntimeThreadContext context(globalContext);
-					vint count = arguments->GetCount();
-					for (vint i = 0; i < count; i++)
-					{
-						context.PushValue(arguments->Get(i));
-					}
-					
-					WString message;
-					if (context.PushStackFrame(functionIndex, count, capturedVariables) != WfRuntimeThreadContextError::Success)
-					{
-						throw WfRuntimeException(L"Internal error: failed to invoke a function.", true);
-					}
+					auto result = InvokeRuntimeFunction(globalContext, functionIndex, capturedVariables, arguments);
+					return result.ToValue(globalContext->primitiveTypes);
+				}
+			};
 
-					context.ExecuteToEnd();
-					if (context.status != WfRuntimeExecutionStatus::Finished)
-					{
-						throw WfRuntimeException(context.exceptionInfo);
-					}
+			/// <summary>Release values in a reused argument container when a call into C++ returns or throws.</summary>
+			template<typename TArguments>
+			struct WfRuntimeArgumentScope
+			{
+				TArguments&							arguments;
+
+				WfRuntimeArgumentScope(TArguments& _arguments)
+					:arguments(_arguments)
+				{
+				}
 
-					Value result;
-					if (context.PopValue(result) != WfRuntimeThreadContextError::Success)
+				~WfRuntimeArgumentScope()
+				{
+					ClearArguments(arguments);
+				}
+
+				static void ClearArguments(collections::List<Value>& arguments)
+				{
+					arguments.Clear();
+				}
+
+				static void ClearArguments(collections::Array<Value>& arguments)
+				{
+					for (vint i = 0; i < arguments.Count(); i++)
 					{
-						throw WfRuntimeException(L"Internal error: failed to pop the function result.", true);
+						arguments[i] = Value();
 					}
-					
-					return result;
 				}
 			};
 			
@@ -387,24 +542,113 @@ WfRuntimeThreadContext (Lambda)
 
 			class WfRuntimeInterface : public Object, public IValueInterfaceProxy
 			{
-				typedef collections::Dictionary<WString, Ptr<IValueFunctionProxy>>		FunctionMap;
 			public:
-				FunctionMap							functions;
+				Ptr<WfRuntimeGlobalContext>			globalContext;
+				WfRuntimeMethodTable*				methodTable;			// shared by all objects created by the same instruction
+				Ptr<WfRuntimeVariableContext>		capturedVariables;		// shared by all methods
+
+				WfRuntimeInterface(Ptr<WfRuntimeGlobalContext> _globalContext, WfRuntimeMethodTable* _methodTable, Ptr<WfRuntimeVariableContext> _capturedVariables)
+					:globalContext(_globalContext)
+					, methodTable(_methodTable)
+					, capturedVariables(_capturedVariables)
+				{
+				}
 
 				Value Invoke(const WString& name, Ptr<IValueList> arguments)override
 				{
-					vint index = functions.Keys().IndexOf(name);
+					vint index = methodTable->slotsByName.Keys().IndexOf(name);
 					if (index == -1)
 					{
 						throw WfRuntimeException(L"Internal error: failed to invoke the interface method \"" + name + L"\"", true);
 					}
-					else
-					{
-						return functions.Values()[index]->Invoke(arguments);
-					}
+
+					auto& slot = methodTable->slots[methodTable->slotsByName.Values()[index]];
+					auto result = InvokeRuntimeFunction(globalContext, slot.functionIndex, capturedVariables, arguments);
+					return result.ToValue(globalContext->primitiveTypes);
 				}
 			};
 
+/***********************************************************************
+WfRuntimeThreadContext (CallSite)
+***********************************************************************/
+
+			/// <summary>Call a reflected method without checking arguments again.</summary>
+			class WfRuntimeUncheckedInvoker : public MethodInfoImpl
+			{
+			public:
+				static Value Invoke(MethodInfoImpl* methodInfo, const Value& thisObject, collections::Array<Value>& arguments)
+				{
+					// MethodInfoImpl::Invoke checks all arguments before calling the protected virtual function InvokeInternal, and Vlpp offers no public way to skip it.
+					// Naming the member through this derived class passes the protected access check, and since the member is declared in MethodInfoImpl,
+					// the expression is a pointer to a member of MethodInfoImpl, which is called on any MethodInfoImpl object with virtual dispatch.
+					// The class is never instantiated.
+					return (methodInfo->*&WfRuntimeUncheckedInvoker::InvokeInternal)(thisObject, arguments);
+				}
+			};
+
+			bool CheckCallSiteReceiver(WfRuntimeCallSite& callSite, const Value& thisValue)
+			{
+				if (!callSite.uncheckedMethod)
+				{
+					return false;
+				}
+
+				auto thisObject = thisValue.GetRawPtr();
+				if (!thisObject)
+				{
+					return thisValue.IsNull() && callSite.uncheckedMethod->IsStatic();
+				}
+
+				// the cache is written without locking, every type stored in it has passed the check
+				auto td = thisObject->GetTypeDescriptor();
+				if (td == callSite.receiverType.Load())
+				{
+					return true;
+				}
+				if (thisValue.CanConvertTo(callSite.methodInfo->GetOwnerTypeDescriptor(), Value::RawPtr))
+				{
+					callSite.receiverType.Store(td);
+					return true;
+				}
+				return false;
+			}
+
+			WfRuntimeInterface* GetRuntimeInterface(const Value& thisValue)
+			{
+				if (auto root = dynamic_cast<ValueInterfaceRoot*>(thisValue.GetRawPtr()))
+				{
+					return dynamic_cast<WfRuntimeInterface*>(root->GetProxy().Obj());
+				}
+				return nullptr;
+			}
+
+			const WfRuntimeMethodSlot* FindCallSiteSlot(WfRuntimeCallSite& callSite, const Value& thisValue, WfRuntimeGlobalContext* globalContext, WfRuntimeInterface*& proxy)
+			{
+				if (!callSite.proxyMethod)
+				{
+					return nullptr;
+				}
+
+				proxy = GetRuntimeInterface(thisValue);
+				if (!proxy || proxy->globalContext.Obj() != globalContext)
+				{
+					return nullptr;
+				}
+
+				// the cache is a single pointer written without locking, every slot stored in it implements the method
+				auto slot = callSite.methodSlot.Load();
+				if (slot && slot->table == proxy->methodTable)
+				{
+					return slot;
+				}
+				slot = proxy->methodTable->FindSlot(callSite.methodInfo);
+				if (slot)
+				{
+					callSite.methodSlot.Store(slot);
+				}
+				return slot;
+			}
+
 #undef INTERNAL_ERROR
 #undef CONTEXT_ACTION
 #undef UNARY_OPERATOR
@@ -423,6 +667,11 @@ Helper Functions
 				return lambda;
 			}
 
+			vint GetIdleThreadContextCount()
+			{
+				return threadContextPool.HasData() ? threadContextPool.Get()->idleContexts.Count() : 0;
+			}
+
 /***********************************************************************
 WfRuntimeThreadContext
 ***********************************************************************/
@@ -455,42 +704,30 @@ WfRuntimeThreadContext
 					}\
 				} while (0)\
 
-#define TYPE_OF_Bool							bool
-#define TYPE_OF_I1								vint8_t
-#define TYPE_OF_I2								vint16_t
-#define TYPE_OF_I4								vint32_t
-#define TYPE_OF_I8								vint64_t
-#define TYPE_OF_U1								vuint8_t
-#define TYPE_OF_U2								vuint16_t
-#define TYPE_OF_U4								vuint32_t
-#define TYPE_OF_U8								vuint64_t
-#define TYPE_OF_F4								float
-#define TYPE_OF_F8								double
-#define TYPE_OF_String							WString
-#define EXECUTE(OPERATION, TYPE)				case WfInsType::TYPE: return OPERATOR_##OPERATION<TYPE_OF_##TYPE>(*this);
-#define BEGIN_TYPE								switch(ins.typeParameter) {
-#define END_TYPE								default: INTERNAL_ERROR(L"unexpected type argument."); }
+#define EXECUTE(NAME, TYPE)						case WfInsCode::NAME##_##TYPE: return OPERATOR_##NAME<TYPE_OF_##TYPE>(*this);
 
-			WfRuntimeExecutionAction WfRuntimeThreadContext::ExecuteInternal(WfInstruction& ins, WfRuntimeStackFrame& stackFrame, IWfDebuggerCallback* callback)
+			WfRuntimeExecutionAction WfRuntimeThreadContext::ExecuteInternal(const WfRuntimeInstruction& ins, WfRuntimeStackFrame& stackFrame, IWfDebuggerCallback* callback)
 			{
+				auto& types = globalContext->primitiveTypes;
 				switch (ins.code)
 				{
 				case WfInsCode::LoadValue:
-					PushValue(ins.valueParameter);
+					PushValue() = globalContext->constants[ins.indexParameter];
 					return WfRuntimeExecutionAction::ExecuteInstruction;
 				case WfInsCode::LoadClosure:
 					{
 						Ptr<WfRuntimeVariableContext> capturedVariables;
 						if (ins.countParameter > 0)
 						{
+							WfRuntimeValue* operands;
+							CONTEXT_ACTION(GetTopValues(ins.countParameter, operands), L"failed to pop a value from the stack.");
 							capturedVariables = new WfRuntimeVariableContext;
 							capturedVariables->variables.Resize(ins.countParameter);
-							Value operand;
 							for (vint i = 0; i < ins.countParameter; i++)
 							{
-								CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-								capturedVariables->variables[ins.countParameter - 1 - i] = operand;
+								capturedVariables->variables[i] = operands[i];
 							}
+							PopValuesUnchecked(ins.countParameter);
 						}
 
 						auto lambda = MakePtr<WfRuntimeLambda>(globalContext, capturedVariables, ins.indexParameter);
@@ -504,61 +741,54 @@ WfRuntimeThreadContext
 					}
 				case WfInsCode::LoadLocalVar:
 					{
-						Value operand;
-						CONTEXT_ACTION(LoadLocalVariable(ins.indexParameter, operand), L"illegal local variable index.");
-						PushValue(operand);
+						CONTEXT_ACTION(LoadLocalVariable(ins.indexParameter, PushValue()), L"illegal local variable index.");
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::LoadCapturedVar:
 					{
-						Value operand;
-						CONTEXT_ACTION(LoadCapturedVariable(ins.indexParameter, operand), L"illegal captured variable index.");
-						PushValue(operand);
+						CONTEXT_ACTION(LoadCapturedVariable(ins.indexParameter, PushValue()), L"illegal captured variable index.");
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::LoadGlobalVar:
 					{
 						CALL_DEBUGGER(callback->BreakRead(globalContext->assembly.Obj(), ins.indexParameter));
-						Value operand;
-						CONTEXT_ACTION(LoadGlobalVariable(ins.indexParameter, operand), L"illegal global variable index.");
-						PushValue(operand);
+						CONTEXT_ACTION(LoadGlobalVariable(ins.indexParameter, PushValue()), L"illegal global variable index.");
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::StoreLocalVar:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						CONTEXT_ACTION(StoreLocalVariable(ins.indexParameter, operand), L"illegal local variable index.");
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						CONTEXT_ACTION(StoreLocalVariable(ins.indexParameter, *operand), L"illegal local variable index.");
+						PopValuesUnchecked(1);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::StoreGlobalVar:
 					{
 						CALL_DEBUGGER(callback->BreakWrite(globalContext->assembly.Obj(), ins.indexParameter));
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						CONTEXT_ACTION(StoreGlobalVariable(ins.indexParameter, operand), L"illegal global variable index.");
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						CONTEXT_ACTION(StoreGlobalVariable(ins.indexParameter, *operand), L"illegal global variable index.");
+						PopValuesUnchecked(1);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::Duplicate:
 					{
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(ins.countParameter + 1, operands), L"failed to duplicate a value from the stack.");
 						vint index = stack.Count() - 1 - ins.countParameter;
-						Value operand;
-						CONTEXT_ACTION(LoadStackValue(index, operand), L"failed to duplicate a value from the stack.");
-						PushValue(operand);
+						auto& operand = PushValue();
+						operand = stack[index];
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::Pop:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
+						CONTEXT_ACTION(PopValues(1), L"failed to pop a value from the stack.");
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::Return:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop the function result.");
-						CONTEXT_ACTION(PopStackFrame(), L"failed to pop the stack frame.");
-						PushValue(operand);
+						CONTEXT_ACTION(PopStackFrame(1), L"failed to pop the stack frame.");
 						if (stackFrames.Count() == 0)
 						{
 							status = WfRuntimeExecutionStatus::Finished;
@@ -568,118 +798,154 @@ WfRuntimeThreadContext
 				case WfInsCode::CreateArray:
 					{
 						auto list = IValueList::Create();
-						Value operand;
-						for (vint i = 0; i < ins.countParameter; i++)
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(ins.countParameter, operands), L"failed to pop a value from the stack.");
+						for (vint i = ins.countParameter - 1; i >= 0; i--)
 						{
-							CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-							list->Add(operand);
+							list->Add(operands[i].ToValue(types));
 						}
+						PopValuesUnchecked(ins.countParameter);
 						PushValue(Value::From(list));
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::CreateMap:
+				case WfInsCode::CreateHashMap:
 					{
-						auto map = IValueDictionary::Create();
-						Value key, value;
-						for (vint i = 0; i < ins.countParameter; i+=2)
+						Ptr<IValueDictionary> map;
+						if (ins.code == WfInsCode::CreateMap)
+						{
+							map = IValueDictionary::Create();
+						}
+						else
+						{
+							map = new WfRuntimeHashMap;
+						}
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(ins.countParameter, operands), L"failed to pop a value from the stack.");
+						for (vint i = ins.countParameter - 2; i >= 0; i -= 2)
 						{
-							CONTEXT_ACTION(PopValue(value), L"failed to pop a value from the stack.");
-							CONTEXT_ACTION(PopValue(key), L"failed to pop a value from the stack.");
-							map->Set(key, value);
+							map->Set(operands[i].ToValue(types), operands[i + 1].ToValue(types));
 						}
+						PopValuesUnchecked(ins.countParameter);
 						PushValue(Value::From(map));
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::CreateInterface:
 					{
-						auto proxy = MakePtr<WfRuntimeInterface>();
-						Value key, value;
-						for (vint i = 0; i < ins.countParameter; i+=2)
+						Ptr<WfRuntimeVariableContext> capturedVariables;
+						if (ins.countParameter > 0)
 						{
-							CONTEXT_ACTION(PopValue(value), L"failed to pop a value from the stack.");
-							CONTEXT_ACTION(PopValue(key), L"failed to pop a value from the stack.");
-							auto name = UnboxValue<WString>(key);
-							auto func = UnboxValue<Ptr<IValueFunctionProxy>>(value);
-							proxy->functions.Add(name, func);
+							WfRuntimeValue* operands;
+							CONTEXT_ACTION(GetTopValues(ins.countParameter, operands), L"failed to pop a value from the stack.");
+							capturedVariables = new WfRuntimeVariableContext;
+							capturedVariables->variables.Resize(ins.countParameter);
+							for (vint i = 0; i < ins.countParameter; i++)
+							{
+								capturedVariables->variables[i] = operands[i];
+							}
+							PopValuesUnchecked(ins.countParameter);
 						}
+
+						auto methodTable = globalContext->methodTables[ins.indexParameter].Obj();
+						auto proxy = MakePtr<WfRuntimeInterface>(globalContext, methodTable, capturedVariables);
 						PushValue(Value::From(proxy));
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
-				case WfInsCode::CreateRange:
-					BEGIN_TYPE
-						EXECUTE(OpCreateRange, I1)
-						EXECUTE(OpCreateRange, I2)
-						EXECUTE(OpCreateRange, I4)
-						EXECUTE(OpCreateRange, I8)
-						EXECUTE(OpCreateRange, U1)
-						EXECUTE(OpCreateRange, U2)
-						EXECUTE(OpCreateRange, U4)
-						EXECUTE(OpCreateRange, U8)
-					END_TYPE
 				case WfInsCode::ReverseEnumerable:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						Value reversedEnumerable = OPERATOR_OpReverseEnumerable(operand);
-						PushValue(reversedEnumerable);
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						Value reversedEnumerable = OPERATOR_OpReverseEnumerable(operand->boxedValue);
+						*operand = WfRuntimeValue::FromValue(reversedEnumerable, types);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::DeleteRawPtr:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						operand.DeleteRawPtr();
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						Value value = operand->boxedValue;
+						PopValuesUnchecked(1);
+						value.DeleteRawPtr();
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::ConvertToType:
 					{
-						Value result, converted;
-						CONTEXT_ACTION(PopValue(result), L"failed to pop a value from the stack.");
-						if (OPERATOR_OpConvertToType(result, converted, ins))
+						auto flag = (Value::ValueType)ins.flagParameter;
+						auto typeDescriptor = globalContext->typeDescriptors[ins.indexParameter];
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						if (operand->type != WfInsType::Unknown && flag == Value::Text && types.typeDescriptors[(vint)operand->type] == typeDescriptor)
 						{
-							PushValue(converted);
 							return WfRuntimeExecutionAction::ExecuteInstruction;
 						}
+
+						Value result = operand->ToValue(types), converted;
+						if (OPERATOR_OpConvertToType(result, converted, flag, typeDescriptor))
+						{
+							*operand = WfRuntimeValue::FromValue(converted, types);
+						}
 						else
 						{
+							PopValuesUnchecked(1);
 							WString from = result.IsNull() ? L"<null>" : L"<" + result.GetText() + L"> of " + result.GetTypeDescriptor()->GetTypeName();
-							WString to = ins.typeDescriptorParameter->GetTypeName();
+							WString to = typeDescriptor->GetTypeName();
 							RaiseException(L"Failed to convert from \"" + from + L"\" to \"" + to + L"\".", false);
 						}
+						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::TryConvertToType:
 					{
-						Value result, converted;
-						CONTEXT_ACTION(PopValue(result), L"failed to pop a value from the stack.");
-						if (OPERATOR_OpConvertToType(result, converted, ins))
+						auto flag = (Value::ValueType)ins.flagParameter;
+						auto typeDescriptor = globalContext->typeDescriptors[ins.indexParameter];
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						if (operand->type != WfInsType::Unknown && flag == Value::Text && types.typeDescriptors[(vint)operand->type] == typeDescriptor)
+						{
+							return WfRuntimeExecutionAction::ExecuteInstruction;
+						}
+
+						Value result = operand->ToValue(types), converted;
+						if (OPERATOR_OpConvertToType(result, converted, flag, typeDescriptor))
 						{
-							PushValue(converted);
+							*operand = WfRuntimeValue::FromValue(converted, types);
 						}
 						else
 						{
-							PushValue(Value());
+							*operand = WfRuntimeValue();
 						}
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::TestType:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						if (operand.GetTypeDescriptor() && operand.GetValueType() == ins.flagParameter && operand.GetTypeDescriptor()->CanConvertTo(ins.typeDescriptorParameter))
+						auto flag = (Value::ValueType)ins.flagParameter;
+						auto typeDescriptor = globalContext->typeDescriptors[ins.indexParameter];
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						bool result = false;
+						if (operand->type == WfInsType::Unknown)
 						{
-							PushValue(BoxValue(true));
+							auto& value = operand->boxedValue;
+							result = value.GetTypeDescriptor() && value.GetValueType() == flag && value.GetTypeDescriptor()->CanConvertTo(typeDescriptor);
 						}
 						else
 						{
-							PushValue(BoxValue(false));
+							result = flag == Value::Text && types.typeDescriptors[(vint)operand->type]->CanConvertTo(typeDescriptor);
 						}
+						operand->Set(result);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::GetType:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						PushValue(Value::From(operand.GetTypeDescriptor()));
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						if (operand->type == WfInsType::Unknown)
+						{
+							*operand = WfRuntimeValue::FromValue(Value::From(operand->boxedValue.GetTypeDescriptor()), types);
+						}
+						else
+						{
+							*operand = WfRuntimeValue::FromValue(Value::From(types.typeDescriptors[(vint)operand->type]), types);
+						}
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::Jump:
@@ -689,12 +955,13 @@ WfRuntimeThreadContext
 					}
 				case WfInsCode::JumpIf:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						if (UnboxValue<bool>(operand))
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						if (operand->Get<bool>())
 						{
 							stackFrame.nextInstructionIndex = ins.indexParameter;
 						}
+						PopValuesUnchecked(1);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::Invoke:
@@ -702,26 +969,50 @@ WfRuntimeThreadContext
 						CONTEXT_ACTION(PushStackFrame(ins.indexParameter, ins.countParameter), L"failed to invoke a function.");
 						return WfRuntimeExecutionAction::EnterStackFrame;
 					}
+				case WfInsCode::TailInvoke:
+					{
+						CONTEXT_ACTION(ReplaceStackFrame(ins.indexParameter, ins.countParameter), L"failed to invoke a function.");
+						return WfRuntimeExecutionAction::EnterStackFrame;
+					}
 				case WfInsCode::GetProperty:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						CALL_DEBUGGER(callback->BreakGet(operand.GetRawPtr(), ins.propertyParameter));
-						Value result = ins.propertyParameter->GetValue(operand);
-						PushValue(result);
+						auto& callSite = globalContext->callSites[ins.indexParameter];
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						Value thisValue = operand->ToValue(types);
+						CALL_DEBUGGER(callback->BreakGet(thisValue.GetRawPtr(), callSite.propertyInfo));
+						if (CheckCallSiteReceiver(callSite, thisValue))
+						{
+							if (callSite.thunk)
+							{
+								*operand = callSite.thunk(thisValue.GetRawPtr(), nullptr, types);
+							}
+							else
+							{
+								Array<Value> arguments;
+								Value result = WfRuntimeUncheckedInvoker::Invoke(callSite.uncheckedMethod, thisValue, arguments);
+								*operand = WfRuntimeValue::FromValue(result, types);
+							}
+						}
+						else
+						{
+							Value result = callSite.propertyInfo->GetValue(thisValue);
+							*operand = WfRuntimeValue::FromValue(result, types);
+						}
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::InvokeProxy:
 					{
-						Value thisValue;
-						CONTEXT_ACTION(PopValue(thisValue), L"failed to pop a value from the stack.");
-						auto proxy = UnboxValue<Ptr<IValueFunctionProxy>>(thisValue);
+						WfRuntimeValue* thisValue;
+						CONTEXT_ACTION(GetTopValues(1, thisValue), L"failed to pop a value from the stack.");
+						auto proxy = UnboxValue<Ptr<IValueFunctionProxy>>(thisValue->boxedValue);
+						PopValuesUnchecked(1);
 						if (!proxy)
 						{
 							INTERNAL_ERROR(L"failed to invoke a null function proxy.");
-							return WfRuntimeExecutionAction::Nop;
 						}
 
+						WfRuntimeValue* operands;
 						if (auto lambda = proxy.Cast<WfRuntimeLambda>())
 						{
 							if (lambda->globalContext == globalContext)
@@ -729,58 +1020,105 @@ WfRuntimeThreadContext
 								CONTEXT_ACTION(PushStackFrame(lambda->functionIndex, ins.countParameter, lambda->capturedVariables), L"failed to invoke a function.");
 								return WfRuntimeExecutionAction::EnterStackFrame;
 							}
+
+							// arguments are copied to the stack of the other global context without boxing
+							CONTEXT_ACTION(GetTopValues(ins.countParameter, operands), L"failed to pop a value from the stack.");
+							auto result = lambda->Invoke(ins.countParameter, [&](WfRuntimeThreadContext& context)
+							{
+								for (vint i = 0; i < ins.countParameter; i++)
+								{
+									context.PushValue(operands[i]);
+								}
+							});
+							PopValuesUnchecked(ins.countParameter);
+							PushValue(result);
+							return WfRuntimeExecutionAction::ExecuteInstruction;
 						}
 
-						List<Value> arguments;
+						if (!proxyArgumentList)
+						{
+							proxyArgumentList = new ValueListWrapper<List<Value>*>(&proxyArguments);
+						}
+						WfRuntimeArgumentScope<List<Value>> scope(proxyArguments);
+						CONTEXT_ACTION(GetTopValues(ins.countParameter, operands), L"failed to pop a value from the stack.");
 						for (vint i = 0; i < ins.countParameter; i++)
 						{
-							Value argument;
-							CONTEXT_ACTION(PopValue(argument), L"failed to pop a value from the stack.");
-							arguments.Insert(0, argument);
+							proxyArguments.Add(operands[i].ToValue(types));
 						}
+						PopValuesUnchecked(ins.countParameter);
 
-						Ptr<IValueList> list = new ValueListWrapper<List<Value>*>(&arguments);
-						Value result = proxy->Invoke(list);
+						Value result = proxy->Invoke(proxyArgumentList);
 						PushValue(result);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::InvokeMethod:
 					{
-						Value thisValue;
-						CONTEXT_ACTION(PopValue(thisValue), L"failed to pop a value from the stack.");
-						CALL_DEBUGGER(callback->BreakInvoke(thisValue.GetRawPtr(), ins.methodParameter));
+						auto& callSite = globalContext->callSites[ins.indexParameter];
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(ins.countParameter + 1, operands), L"failed to pop a value from the stack.");
+						Value thisValue = operands[ins.countParameter].ToValue(types);
+						CALL_DEBUGGER(callback->BreakInvoke(thisValue.GetRawPtr(), callSite.methodInfo));
+
+						// methods of objects created by CreateInterface in this assembly are called without reflection
+						WfRuntimeInterface* proxy = nullptr;
+						if (auto slot = FindCallSiteSlot(callSite, thisValue, globalContext.Obj(), proxy))
+						{
+							PopValuesUnchecked(1);
+							CONTEXT_ACTION(PushStackFrame(slot->functionIndex, ins.countParameter, proxy->capturedVariables), L"failed to invoke a function.");
+							return WfRuntimeExecutionAction::EnterStackFrame;
+						}
+
+						bool receiverChecked = CheckCallSiteReceiver(callSite, thisValue);
+						if (receiverChecked && callSite.thunk)
+						{
+							auto result = callSite.thunk(thisValue.GetRawPtr(), operands, types);
+							PopValuesUnchecked(ins.countParameter + 1);
+							PushValue(result);
+							return WfRuntimeExecutionAction::ExecuteInstruction;
+						}
 
-						Array<Value> arguments(ins.countParameter);
+						// only calls with many arguments allocate an array
+						Array<Value> allocatedArguments;
+						auto& arguments = ins.countParameter <= CachedArgumentCount ? methodArguments[ins.countParameter] : allocatedArguments;
+						if (arguments.Count() != ins.countParameter)
+						{
+							arguments.Resize(ins.countParameter);
+						}
+						WfRuntimeArgumentScope<Array<Value>> scope(arguments);
 						for (vint i = 0; i < ins.countParameter; i++)
 						{
-							Value argument;
-							CONTEXT_ACTION(PopValue(argument), L"failed to pop a value from the stack.");
-							arguments[ins.countParameter - i - 1] = argument;
+							arguments[i] = operands[i].ToValue(types);
 						}
+						PopValuesUnchecked(ins.countParameter + 1);
 
-						Value result = ins.methodParameter->Invoke(thisValue, arguments);
+						Value result = receiverChecked
+							? WfRuntimeUncheckedInvoker::Invoke(callSite.uncheckedMethod, thisValue, arguments)
+							: callSite.methodInfo->Invoke(thisValue, arguments);
 						PushValue(result);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::AttachEvent:
 					{
-						Value thisValue, function;
-						CONTEXT_ACTION(PopValue(function), L"failed to pop a value from the stack.");
-						CONTEXT_ACTION(PopValue(thisValue), L"failed to pop a value from the stack.");
-						CALL_DEBUGGER(callback->BreakAttach(thisValue.GetRawPtr(), ins.eventParameter));
-						auto proxy = UnboxValue<Ptr<IValueFunctionProxy>>(function);
-						auto handler = ins.eventParameter->Attach(thisValue, proxy);
-						PushValue(Value::From(handler));
+						auto eventInfo = globalContext->events[ins.indexParameter];
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");
+						auto& thisValue = operands[0];
+						auto& function = operands[1];
+						CALL_DEBUGGER(callback->BreakAttach(thisValue.boxedValue.GetRawPtr(), eventInfo));
+						auto proxy = UnboxValue<Ptr<IValueFunctionProxy>>(function.boxedValue);
+						auto handler = eventInfo->Attach(thisValue.boxedValue, proxy);
+						thisValue = WfRuntimeValue::FromValue(Value::From(handler), types);
+						PopValuesUnchecked(1);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::DetachEvent:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						auto handler = UnboxValue<Ptr<IEventHandler>>(operand);
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						auto handler = UnboxValue<Ptr<IEventHandler>>(operand->boxedValue);
 						CALL_DEBUGGER(callback->BreakDetach(handler->GetOwnerObject().GetRawPtr(), handler->GetOwnerEvent()));
 						auto result = handler->Detach();
-						PushValue(BoxValue(result));
+						operand->Set(result);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::InstallTry:
@@ -798,13 +1136,15 @@ WfRuntimeThreadContext
 					}
 				case WfInsCode::RaiseException:
 					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						if (operand.GetValueType() == Value::Text)
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						Value exception = operand->ToValue(types);
+						PopValuesUnchecked(1);
+						if (exception.GetValueType() == Value::Text)
 						{
-							RaiseException(operand.GetText(), false);
+							RaiseException(exception.GetText(), false);
 						}
-						else if (auto info = operand.GetSharedPtr().Cast<WfRuntimeExceptionInfo>())
+						else if (auto info = exception.GetSharedPtr().Cast<WfRuntimeExceptionInfo>())
 						{
 							RaiseException(info);
 						}
@@ -816,43 +1156,58 @@ WfRuntimeThreadContext
 					}
 				case WfInsCode::TestElementInSet:
 					{
-						Value element, set;
-						CONTEXT_ACTION(PopValue(set), L"failed to pop a value from the stack.");
-						CONTEXT_ACTION(PopValue(element), L"failed to pop a value from the stack.");
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");
 
-						auto enumerable = UnboxValue<Ptr<IValueEnumerable>>(set);
-						auto enumerator = enumerable->CreateEnumerator();
-						while (enumerator->Next())
+						Value elementValue = operands[0].ToValue(types);
+						auto enumerable = UnboxValue<Ptr<IValueEnumerable>>(operands[1].boxedValue);
+						bool result = false, searched = false;
+						if (auto list = dynamic_cast<IValueReadonlyList*>(enumerable.Obj()))
 						{
-							if (enumerator->GetCurrent() == element)
+							// lists search their own storage without creating an enumerator
+							// typed lists unbox the element in Contains, so it is only called for an element of the same type as the items
+							if (!elementValue.IsNull() && list->GetCount() > 0)
 							{
-								PushValue(BoxValue(true));
-								return WfRuntimeExecutionAction::ExecuteInstruction;
+								auto item = list->Get(0);
+								if (item.GetValueType() == elementValue.GetValueType() && item.GetTypeDescriptor() == elementValue.GetTypeDescriptor())
+								{
+									result = list->Contains(elementValue);
+									searched = true;
+								}
 							}
 						}
-						PushValue(BoxValue(false));
+						if (!searched)
+						{
+							auto enumerator = enumerable->CreateEnumerator();
+							while (enumerator->Next())
+							{
+								if (enumerator->GetCurrent() == elementValue)
+								{
+									result = true;
+									break;
+								}
+							}
+						}
+						operands[0].Set(result);
+						PopValuesUnchecked(1);
+						return WfRuntimeExecutionAction::ExecuteInstruction;
+					}
+				case WfInsCode::TestElementInConstantSet:
+					{
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						if (ins.indexParameter < 0 || ins.indexParameter >= globalContext->constantSets.Count())
+						{
+							INTERNAL_ERROR(L"illegal constant set index.");
+						}
+						operand->Set(globalContext->constantSets[ins.indexParameter]->FindLabel(*operand, types) != -1);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
-				case WfInsCode::CompareLiteral:
-					BEGIN_TYPE
-						EXECUTE(OpCompare, Bool)
-						EXECUTE(OpCompare, I1)
-						EXECUTE(OpCompare, I2)
-						EXECUTE(OpCompare, I4)
-						EXECUTE(OpCompare, I8)
-						EXECUTE(OpCompare, U1)
-						EXECUTE(OpCompare, U2)
-						EXECUTE(OpCompare, U4)
-						EXECUTE(OpCompare, U8)
-						EXECUTE(OpCompare, F4)
-						EXECUTE(OpCompare, F8)
-						EXECUTE(OpCompare, String)
-					END_TYPE
 				case WfInsCode::CompareStruct:
 					{
-						Value first, second;
-						CONTEXT_ACTION(PopValue(second), L"failed to pop a value from the stack.");
-						CONTEXT_ACTION(PopValue(first), L"failed to pop a value from the stack.");
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");
+						Value first = operands[0].ToValue(types), second = operands[1].ToValue(types);
 						if (!first.IsNull() && !first.GetTypeDescriptor()->GetValueSerializer())
 						{
 							INTERNAL_ERROR(L"type" + first.GetTypeDescriptor()->GetTypeName() + L" is not a struct.");
@@ -862,280 +1217,202 @@ WfRuntimeThreadContext
 							INTERNAL_ERROR(L"type" + second.GetTypeDescriptor()->GetTypeName() + L" is not a struct.");
 						}
 
+						bool result = false;
 						if (first.GetValueType() != second.GetValueType())
 						{
-							PushValue(BoxValue(false));
+							result = false;
 						}
 						else if (first.IsNull())
 						{
-							PushValue(BoxValue(true));
+							result = true;
 						}
 						else
 						{
-							PushValue(BoxValue(first.GetText() == second.GetText()));
+							result = first.GetText() == second.GetText();
 						}
+						operands[0].Set(result);
+						PopValuesUnchecked(1);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::CompareReference:
 					{
-						Value first, second;
-						CONTEXT_ACTION(PopValue(second), L"failed to pop a value from the stack.");
-						CONTEXT_ACTION(PopValue(first), L"failed to pop a value from the stack.");
-						bool result = first.GetValueType() != Value::Text && second.GetValueType() != Value::Text && first.GetRawPtr() == second.GetRawPtr();
-						PushValue(BoxValue(result));
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");
+						auto& first = operands[0];
+						auto& second = operands[1];
+						bool result =
+							first.type == WfInsType::Unknown && first.boxedValue.GetValueType() != Value::Text &&
+							second.type == WfInsType::Unknown && second.boxedValue.GetValueType() != Value::Text &&
+							first.boxedValue.GetRawPtr() == second.boxedValue.GetRawPtr();
+						first.Set(result);
+						PopValuesUnchecked(1);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
 				case WfInsCode::CompareValue:
 					{
-						Value first, second;
-						CONTEXT_ACTION(PopValue(second), L"failed to pop a value from the stack.");
-						CONTEXT_ACTION(PopValue(first), L"failed to pop a value from the stack.");
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");
+						Value first = operands[0].ToValue(types), second = operands[1].ToValue(types);
+						bool result = false;
 						switch (first.GetValueType())
 						{
 						case Value::RawPtr:
 						case Value::SharedPtr:
-							switch (first.GetValueType())
+							switch (second.GetValueType())
 							{
 							case Value::RawPtr:
 							case Value::SharedPtr:
-								PushValue(BoxValue(first.GetRawPtr() == second.GetRawPtr()));
+								result = first.GetRawPtr() == second.GetRawPtr();
 								break;
-							default:
-								PushValue(BoxValue(false));
+							default:;
 							}
 							break;
 						case Value::Text:
-							switch (first.GetValueType())
-							{
-							case Value::Text:
-								PushValue(BoxValue(first.GetText() == second.GetText()));
-							default:
-								PushValue(BoxValue(false));
-							}
+							result = second.GetValueType() == Value::Text && first.GetText() == second.GetText();
 							break;
 						default:
-							PushValue(BoxValue(second.IsNull()));
+							result = second.IsNull();
 						}
+						operands[0].Set(result);
+						PopValuesUnchecked(1);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
-				case WfInsCode::OpNot:
-					BEGIN_TYPE
-						EXECUTE(OpNot_Bool, Bool)
-						EXECUTE(OpNot, I1)
-						EXECUTE(OpNot, I2)
-						EXECUTE(OpNot, I4)
-						EXECUTE(OpNot, I8)
-						EXECUTE(OpNot, U1)
-						EXECUTE(OpNot, U2)
-						EXECUTE(OpNot, U4)
-						EXECUTE(OpNot, U8)
-					END_TYPE
-				case WfInsCode::OpPositive:
-					BEGIN_TYPE
-						EXECUTE(OpPositive, I1)
-						EXECUTE(OpPositive, I2)
-						EXECUTE(OpPositive, I4)
-						EXECUTE(OpPositive, I8)
-						EXECUTE(OpPositive, U1)
-						EXECUTE(OpPositive, U2)
-						EXECUTE(OpPositive, U4)
-						EXECUTE(OpPositive, U8)
-					END_TYPE
-				case WfInsCode::OpNegative:
-					BEGIN_TYPE
-						EXECUTE(OpNegative, I1)
-						EXECUTE(OpNegative, I2)
-						EXECUTE(OpNegative, I4)
-						EXECUTE(OpNegative, I8)
-					END_TYPE
 				case WfInsCode::OpConcat:
 					{
-						Value first, second;
-						CONTEXT_ACTION(PopValue(second), L"failed to pop a value from the stack.");
-						CONTEXT_ACTION(PopValue(first), L"failed to pop a value from the stack.");
-						PushValue(BoxValue(first.GetText() + second.GetText()));
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");
+						operands[0] = WfRuntimeValue::From(operands[0].ToValue(types).GetText() + operands[1].ToValue(types).GetText(), types);
+						PopValuesUnchecked(1);
 						return WfRuntimeExecutionAction::ExecuteInstruction;
 					}
+				case WfInsCode::ConcatN:
+					{
+						WfRuntimeValue* operands;
+						CONTEXT_ACTION(GetTopValues(ins.countParameter, operands), L"failed to pop a value from the stack.");
+						vint length = 0;
+						for (vint i = 0; i < ins.countParameter; i++)
+						{
+							if (operands[i].type != WfInsType::String)
+							{
+								operands[i] = WfRuntimeValue::From(operands[i].ToValue(types).GetText(), types);
+							}
+							length += operands[i].boxedValue.GetText().Length();
+						}
+
+						if (length == 0)
+						{
+							operands[0] = WfRuntimeValue::From(WString::Empty, types);
+						}
+						else
+						{
+							if (concatBuffer.Count() < length)
+							{
+								concatBuffer.Resize(length);
+							}
+							vint position = 0;
+							for (vint i = 0; i < ins.countParameter; i++)
+							{
+								auto& text = operands[i].boxedValue.GetText();
+								memcpy(&concatBuffer[position], text.Buffer(), sizeof(wchar_t) * text.Length());
+								position += text.Length();
+							}
+							operands[0] = WfRuntimeValue::From(WString(&concatBuffer[0], length), types);
+						}
+						PopValuesUnchecked(ins.countParameter - 1);
+						return WfRuntimeExecutionAction::ExecuteInstruction;
+					}
+#define EXECUTE_COMPARE(NAME, OPERATOR)\
+				case WfInsCode::NAME:\
+					{\
+						WfRuntimeValue* operand;\
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");\
+						operand->Set(operand->Get<vint>() OPERATOR 0);\
+						return WfRuntimeExecutionAction::ExecuteInstruction;\
+					}\
+
+				EXECUTE_COMPARE(OpLT, <)
+				EXECUTE_COMPARE(OpGT, >)
+				EXECUTE_COMPARE(OpLE, <=)
+				EXECUTE_COMPARE(OpGE, >=)
+				EXECUTE_COMPARE(OpEQ, ==)
+				EXECUTE_COMPARE(OpNE, !=)
+#undef EXECUTE_COMPARE
+				INSTRUCTION_SPECIALIZED_CASES(EXECUTE)
+				case WfInsCode::LoadLocalVar2:
+					{
+						CONTEXT_ACTION(LoadLocalVariable(ins.indexParameter, PushValue()), L"illegal local variable index.");
+						CONTEXT_ACTION(LoadLocalVariable(ins.countParameter, PushValue()), L"illegal local variable index.");
+						return WfRuntimeExecutionAction::ExecuteInstruction;
+					}
+				case WfInsCode::IncreaseLocalVar:
+					{
+						WfRuntimeValue variable;
+						CONTEXT_ACTION(LoadLocalVariable(ins.indexParameter, variable), L"illegal local variable index.");
+						if (!OPERATOR_IncreaseValue(variable, globalContext->constants[ins.countParameter]))
+						{
+							INTERNAL_ERROR(L"unexpected type argument.");
+						}
+						CONTEXT_ACTION(StoreLocalVariable(ins.indexParameter, variable), L"illegal local variable index.");
+						return WfRuntimeExecutionAction::ExecuteInstruction;
+					}
+#define EXECUTE_COMPARE_JUMP(NAME, OPERATOR)\
+				case WfInsCode::NAME:\
+					{\
+						WfRuntimeValue* operands;\
+						CONTEXT_ACTION(GetTopValues(2, operands), L"failed to pop a value from the stack.");\
+						vint result = 0;\
+						if (!OPERATOR_CompareLiteral((WfInsType)ins.flagParameter, operands[0], operands[1], result))\
+						{\
+							INTERNAL_ERROR(L"unexpected type argument.");\
+						}\
+						PopValuesUnchecked(2);\
+						if (result OPERATOR 0)\
+						{\
+							stackFrame.nextInstructionIndex = ins.indexParameter;\
+						}\
+						return WfRuntimeExecutionAction::ExecuteInstruction;\
+					}\
+
+				EXECUTE_COMPARE_JUMP(JumpIfLT, <)
+				EXECUTE_COMPARE_JUMP(JumpIfGT, >)
+				EXECUTE_COMPARE_JUMP(JumpIfLE, <=)
+				EXECUTE_COMPARE_JUMP(JumpIfGE, >=)
+				EXECUTE_COMPARE_JUMP(JumpIfEQ, ==)
+				EXECUTE_COMPARE_JUMP(JumpIfNE, !=)
+#undef EXECUTE_COMPARE_JUMP
+				case WfInsCode::SwitchTable:
+					{
+						if (ins.indexParameter < 0 || ins.indexParameter >= globalContext->switchTables.Count())
+						{
+							INTERNAL_ERROR(L"illegal switch table index.");
+						}
+						WfRuntimeValue* operand;
+						CONTEXT_ACTION(GetTopValues(1, operand), L"failed to pop a value from the stack.");
+						vint label = globalContext->switchTables[ins.indexParameter]->FindLabel(*operand, types);
+						PopValuesUnchecked(1);
+						if (label != -1)
+						{
+							stackFrame.nextInstructionIndex = label;
+						}
+						return WfRuntimeExecutionAction::ExecuteInstruction;
+					}
+				case WfInsCode::CreateRange:
+				case WfInsCode::CompareLiteral:
+				case WfInsCode::OpNot:
+				case WfInsCode::OpPositive:
+				case WfInsCode::OpNegative:
 				case WfInsCode::OpExp:
-					BEGIN_TYPE
-						EXECUTE(OpExp, F4)
-						EXECUTE(OpExp, F8)
-					END_TYPE
 				case WfInsCode::OpAdd:
-					BEGIN_TYPE
-						EXECUTE(OpAdd, I1)
-						EXECUTE(OpAdd, I2)
-						EXECUTE(OpAdd, I4)
-						EXECUTE(OpAdd, I8)
-						EXECUTE(OpAdd, U1)
-						EXECUTE(OpAdd, U2)
-						EXECUTE(OpAdd, U4)
-						EXECUTE(OpAdd, U8)
-						EXECUTE(OpAdd, F4)
-						EXECUTE(OpAdd, F8)
-					END_TYPE
 				case WfInsCode::OpSub:
-					BEGIN_TYPE
-						EXECUTE(OpSub, I1)
-						EXECUTE(OpSub, I2)
-						EXECUTE(OpSub, I4)
-						EXECUTE(OpSub, I8)
-						EXECUTE(OpSub, U1)
-						EXECUTE(OpSub, U2)
-						EXECUTE(OpSub, U4)
-						EXECUTE(OpSub, U8)
-						EXECUTE(OpSub, F4)
-						EXECUTE(OpSub, F8)
-					END_TYPE
 				case WfInsCode::OpMul:
-					BEGIN_TYPE
-						EXECUTE(OpMul, I1)
-						EXECUTE(OpMul, I2)
-						EXECUTE(OpMul, I4)
-						EXECUTE(OpMul, I8)
-						EXECUTE(OpMul, U1)
-						EXECUTE(OpMul, U2)
-						EXECUTE(OpMul, U4)
-						EXECUTE(OpMul, U8)
-						EXECUTE(OpMul, F4)
-						EXECUTE(OpMul, F8)
-					END_TYPE
 				case WfInsCode::OpDiv:
-					BEGIN_TYPE
-						EXECUTE(OpDiv, I1)
-						EXECUTE(OpDiv, I2)
-						EXECUTE(OpDiv, I4)
-						EXECUTE(OpDiv, I8)
-						EXECUTE(OpDiv, U1)
-						EXECUTE(OpDiv, U2)
-						EXECUTE(OpDiv, U4)
-						EXECUTE(OpDiv, U8)
-						EXECUTE(OpDiv, F4)
-						EXECUTE(OpDiv, F8)
-					END_TYPE
 				case WfInsCode::OpMod:
-					BEGIN_TYPE
-						EXECUTE(OpMod, I1)
-						EXECUTE(OpMod, I2)
-						EXECUTE(OpMod, I4)
-						EXECUTE(OpMod, I8)
-						EXECUTE(OpMod, U1)
-						EXECUTE(OpMod, U2)
-						EXECUTE(OpMod, U4)
-						EXECUTE(OpMod, U8)
-					END_TYPE
 				case WfInsCode::OpShl:
-					BEGIN_TYPE
-						EXECUTE(OpShl, I1)
-						EXECUTE(OpShl, I2)
-						EXECUTE(OpShl, I4)
-						EXECUTE(OpShl, I8)
-						EXECUTE(OpShl, U1)
-						EXECUTE(OpShl, U2)
-						EXECUTE(OpShl, U4)
-						EXECUTE(OpShl, U8)
-					END_TYPE
 				case WfInsCode::OpShr:
-					BEGIN_TYPE
-						EXECUTE(OpShr, I1)
-						EXECUTE(OpShr, I2)
-						EXECUTE(OpShr, I4)
-						EXECUTE(OpShr, I8)
-						EXECUTE(OpShr, U1)
-						EXECUTE(OpShr, U2)
-						EXECUTE(OpShr, U4)
-						EXECUTE(OpShr, U8)
-					END_TYPE
 				case WfInsCode::OpXor:
-					BEGIN_TYPE
-						EXECUTE(OpXor, Bool)
-						EXECUTE(OpXor, I1)
-						EXECUTE(OpXor, I2)
-						EXECUTE(OpXor, I4)
-						EXECUTE(OpXor, I8)
-						EXECUTE(OpXor, U1)
-						EXECUTE(OpXor, U2)
-						EXECUTE(OpXor, U4)
-						EXECUTE(OpXor, U8)
-					END_TYPE
 				case WfInsCode::OpAnd:
-					BEGIN_TYPE
-						EXECUTE(OpAnd_Bool, Bool)
-						EXECUTE(OpAnd, I1)
-						EXECUTE(OpAnd, I2)
-						EXECUTE(OpAnd, I4)
-						EXECUTE(OpAnd, I8)
-						EXECUTE(OpAnd, U1)
-						EXECUTE(OpAnd, U2)
-						EXECUTE(OpAnd, U4)
-						EXECUTE(OpAnd, U8)
-					END_TYPE
 				case WfInsCode::OpOr:
-					BEGIN_TYPE
-						EXECUTE(OpOr_Bool, Bool)
-						EXECUTE(OpOr, I1)
-						EXECUTE(OpOr, I2)
-						EXECUTE(OpOr, I4)
-						EXECUTE(OpOr, I8)
-						EXECUTE(OpOr, U1)
-						EXECUTE(OpOr, U2)
-						EXECUTE(OpOr, U4)
-						EXECUTE(OpOr, U8)
-					END_TYPE
-				case WfInsCode::OpLT:
-					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						vint value = UnboxValue<vint>(operand);
-						PushValue(BoxValue(value < 0));
-						return WfRuntimeExecutionAction::ExecuteInstruction;
-					}
-					break;
-				case WfInsCode::OpGT:
-					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						vint value = UnboxValue<vint>(operand);
-						PushValue(BoxValue(value > 0));
-						return WfRuntimeExecutionAction::ExecuteInstruction;
-					}
-					break;
-				case WfInsCode::OpLE:
-					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						vint value = UnboxValue<vint>(operand);
-						PushValue(BoxValue(value <= 0));
-						return WfRuntimeExecutionAction::ExecuteInstruction;
-					}
-					break;
-				case WfInsCode::OpGE:
-					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						vint value = UnboxValue<vint>(operand);
-						PushValue(BoxValue(value >= 0));
-						return WfRuntimeExecutionAction::ExecuteInstruction;
-					}
-					break;
-				case WfInsCode::OpEQ:
-					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						vint value = UnboxValue<vint>(operand);
-						PushValue(BoxValue(value == 0));
-						return WfRuntimeExecutionAction::ExecuteInstruction;
-					}
-					break;
-				case WfInsCode::OpNE:
-					{
-						Value operand;
-						CONTEXT_ACTION(PopValue(operand), L"failed to pop a value from the stack.");
-						vint value = UnboxValue<vint>(operand);
-						PushValue(BoxValue(value != 0));
-						return WfRuntimeExecutionAction::ExecuteInstruction;
-					}
-					break;
+					INTERNAL_ERROR(L"unexpected type argument.");
 				default:
 					return WfRuntimeExecutionAction::Nop;
 				}
@@ -1155,7 +1432,7 @@ WfRuntimeThreadContext
 								INTERNAL_ERROR(L"empty stack frame.");
 							}
 							auto& stackFrame = GetCurrentStackFrame();
-							if (stackFrame.nextInstructionIndex < 0 || stackFrame.nextInstructionIndex >= globalContext->assembly->instructions.Count())
+							if (stackFrame.nextInstructionIndex < 0 || stackFrame.nextInstructionIndex >= globalContext->instructions.Count())
 							{
 								INTERNAL_ERROR(L"illegal instruction index.");
 							}
@@ -1164,7 +1441,7 @@ WfRuntimeThreadContext
 							CALL_DEBUGGER(callback->BreakIns(globalContext->assembly.Obj(), insIndex));
 
 							stackFrame.nextInstructionIndex++;
-							auto& ins = globalContext->assembly->instructions[insIndex];
+							auto& ins = globalContext->instructions[insIndex];
 							return ExecuteInternal(ins, stackFrame, callback);
 						}
 						break;
@@ -1214,6 +1491,300 @@ WfRuntimeThreadContext
 				}
 			}
 
+/***********************************************************************
+WfRuntimeThreadContext (ExecuteFast)
+***********************************************************************/
+
+#define FAST_FETCH\
+				ins = instructions + insIndex;\
+				fastCode = ins->fastCode;\
+				stackFrame->nextInstructionIndex = ++insIndex;\
+
+#if defined(__GNUC__)
+#define FAST_BEGIN							FAST_NEXT;
+#define FAST_END
+#define FAST_CASE(NAME)						FAST_LABEL_##NAME:
+#define FAST_NEXT							do{ FAST_FETCH goto *fastLabels[(vint)fastCode]; } while (0)
+#else
+#define FAST_BEGIN							while (true) { FAST_FETCH switch (fastCode) {
+#define FAST_END							} }
+#define FAST_CASE(NAME)						case WfRuntimeFastInsCode::NAME:
+#define FAST_NEXT							continue
+#endif
+
+#define FAST_JUMP(INDEX)\
+				do {\
+					insIndex = INDEX;\
+					if (insIndex < 0 || insIndex >= insCount)\
+					{\
+						INTERNAL_ERROR(L"illegal instruction index.");\
+					}\
+				} while (0)\
+
+#define FAST_ACTION(ACTION)\
+				do {\
+					if ((ACTION) != WfRuntimeExecutionAction::ExecuteInstruction)\
+					{\
+						return WfRuntimeExecutionAction::Nop;\
+					}\
+				} while (0)\
+
+#define FAST_COMPARE(NAME, OPERATOR)\
+				FAST_CASE(NAME)\
+				{\
+					auto& operand = stack[stack.Count() - 1];\
+					operand.Set(operand.Get<vint>() OPERATOR 0);\
+					FAST_NEXT;\
+				}\
+
+#define FAST_COMPARE_JUMP(NAME, OPERATOR)\
+				FAST_CASE(NAME)\
+				{\
+					vint result = 0;\
+					OPERATOR_CompareLiteral((WfInsType)ins->flagParameter, stack[stack.Count() - 2], stack[stack.Count() - 1], result);\
+					PopValuesUnchecked(2);\
+					if (result OPERATOR 0)\
+					{\
+						FAST_JUMP(ins->indexParameter);\
+					}\
+					FAST_NEXT;\
+				}\
+
+#define FAST_SPECIALIZED(NAME, TYPE)\
+				FAST_CASE(NAME##_##TYPE)\
+				FAST_ACTION(OPERATOR_##NAME<TYPE_OF_##TYPE>(*this));\
+				FAST_NEXT;\
+
+			WfRuntimeExecutionAction WfRuntimeThreadContext::ExecuteFastInternal()
+			{
+#if defined(__GNUC__)
+#define FAST_LABEL(NAME)					&&FAST_LABEL_##NAME,
+#define FAST_LABEL_SPECIALIZED(NAME, TYPE)	&&FAST_LABEL_##NAME##_##TYPE,
+				static void* const fastLabels[] =
+				{
+					&&FAST_LABEL_Generic,
+					RUNTIME_FAST_INSTRUCTION_CASES(FAST_LABEL, FAST_LABEL_SPECIALIZED)
+				};
+#undef FAST_LABEL
+#undef FAST_LABEL_SPECIALIZED
+#endif
+
+				if (stackFrames.Count() == 0)
+				{
+					INTERNAL_ERROR(L"empty stack frame.");
+				}
+
+				auto& types = globalContext->primitiveTypes;
+				auto instructions = &globalContext->instructions[0];
+				vint insCount = globalContext->instructions.Count();
+
+				auto stackFrame = &GetCurrentStackFrame();
+				vint insIndex = 0;
+				FAST_JUMP(stackFrame->nextInstructionIndex);
+				const WfRuntimeInstruction* ins = nullptr;
+				WfRuntimeFastInsCode fastCode = WfRuntimeFastInsCode::Generic;
+
+				FAST_BEGIN
+
+				FAST_CASE(Generic)
+				{
+					// instructions that change stack frames or call into reflection are handled by ExecuteInternal
+					ExecuteInternal(*ins, *stackFrame, nullptr);
+					if (status != WfRuntimeExecutionStatus::Ready && status != WfRuntimeExecutionStatus::Executing)
+					{
+						return WfRuntimeExecutionAction::ExecuteInstruction;
+					}
+					if (stackFrames.Count() == 0)
+					{
+						INTERNAL_ERROR(L"empty stack frame.");
+					}
+					stackFrame = &GetCurrentStackFrame();
+					FAST_JUMP(stackFrame->nextInstructionIndex);
+					FAST_NEXT;
+				}
+				FAST_CASE(LoadValue)
+				{
+					PushValue() = globalContext->constants[ins->indexParameter];
+					FAST_NEXT;
+				}
+				// the assembly has been verified, so variable indices and stack depths are not checked again
+				FAST_CASE(LoadLocalVar)
+				{
+					auto& operand = PushValue();
+					operand = stack[stackFrame->stackBase + ins->indexParameter];
+					FAST_NEXT;
+				}
+				FAST_CASE(LoadCapturedVar)
+				{
+					PushValue() = stackFrame->capturedVariables->variables[ins->indexParameter];
+					FAST_NEXT;
+				}
+				FAST_CASE(LoadGlobalVar)
+				{
+					PushValue() = globalContext->globalVariables->variables[ins->indexParameter];
+					FAST_NEXT;
+				}
+				FAST_CASE(StoreLocalVar)
+				{
+					stack[stackFrame->stackBase + ins->indexParameter] = stack[stack.Count() - 1];
+					PopValuesUnchecked(1);
+					FAST_NEXT;
+				}
+				FAST_CASE(StoreGlobalVar)
+				{
+					globalContext->globalVariables->variables[ins->indexParameter] = stack[stack.Count() - 1];
+					PopValuesUnchecked(1);
+					FAST_NEXT;
+				}
+				FAST_CASE(Duplicate)
+				{
+					vint index = stack.Count() - 1 - ins->countParameter;
+					auto& operand = PushValue();
+					operand = stack[index];
+					FAST_NEXT;
+				}
+				FAST_CASE(Pop)
+				{
+					PopValuesUnchecked(1);
+					FAST_NEXT;
+				}
+				FAST_CASE(Jump)
+				{
+					FAST_JUMP(ins->indexParameter);
+					FAST_NEXT;
+				}
+				FAST_CASE(JumpIf)
+				{
+					bool condition = stack[stack.Count() - 1].Get<bool>();
+					PopValuesUnchecked(1);
+					if (condition)
+					{
+						FAST_JUMP(ins->indexParameter);
+					}
+					FAST_NEXT;
+				}
+				FAST_COMPARE(OpLT, <)
+				FAST_COMPARE(OpGT, >)
+				FAST_COMPARE(OpLE, <=)
+				FAST_COMPARE(OpGE, >=)
+				FAST_COMPARE(OpEQ, ==)
+				FAST_COMPARE(OpNE, !=)
+				INSTRUCTION_SPECIALIZED_CASES(FAST_SPECIALIZED)
+				FAST_CASE(LoadLocalVar2)
+				{
+					vint stackBase = stackFrame->stackBase;
+					auto& first = PushValue();
+					first = stack[stackBase + ins->indexParameter];
+					auto& second = PushValue();
+					second = stack[stackBase + ins->countParameter];
+					FAST_NEXT;
+				}
+				FAST_CASE(IncreaseLocalVar)
+				{
+					OPERATOR_IncreaseValue(stack[stackFrame->stackBase + ins->indexParameter], globalContext->constants[ins->countParameter]);
+					FAST_NEXT;
+				}
+				FAST_COMPARE_JUMP(JumpIfLT, <)
+				FAST_COMPARE_JUMP(JumpIfGT, >)
+				FAST_COMPARE_JUMP(JumpIfLE, <=)
+				FAST_COMPARE_JUMP(JumpIfGE, >=)
+				FAST_COMPARE_JUMP(JumpIfEQ, ==)
+				FAST_COMPARE_JUMP(JumpIfNE, !=)
+				FAST_CASE(SwitchTable)
+				{
+					vint label = globalContext->switchTables[ins->indexParameter]->FindLabel(stack[stack.Count() - 1], types);
+					PopValuesUnchecked(1);
+					if (label != -1)
+					{
+						FAST_JUMP(label);
+					}
+					FAST_NEXT;
+				}
+				FAST_CASE(Invoke)
+				{
+					CONTEXT_ACTION(PushStackFrame(ins->indexParameter, ins->countParameter), L"failed to invoke a function.");
+					stackFrame = &GetCurrentStackFrame();
+					FAST_JUMP(stackFrame->nextInstructionIndex);
+					FAST_NEXT;
+				}
+				FAST_CASE(TailInvoke)
+				{
+					CONTEXT_ACTION(ReplaceStackFrame(ins->indexParameter, ins->countParameter), L"failed to invoke a function.");
+					FAST_JUMP(stackFrame->nextInstructionIndex);
+					FAST_NEXT;
+				}
+				FAST_CASE(Return)
+				{
+					CONTEXT_ACTION(PopStackFrame(1), L"failed to pop the stack frame.");
+					if (stackFrames.Count() == 0)
+					{
+						status = WfRuntimeExecutionStatus::Finished;
+						return WfRuntimeExecutionAction::ExitStackFrame;
+					}
+					stackFrame = &GetCurrentStackFrame();
+					FAST_JUMP(stackFrame->nextInstructionIndex);
+					FAST_NEXT;
+				}
+
+				FAST_END
+			}
+
+			void WfRuntimeThreadContext::ExecuteFast()
+			{
+				while (true)
+				{
+					switch (status)
+					{
+					case WfRuntimeExecutionStatus::Ready:
+					case WfRuntimeExecutionStatus::Executing:
+						try
+						{
+							ExecuteFastInternal();
+						}
+						catch (const WfRuntimeException& ex)
+						{
+							if (ex.GetInfo())
+							{
+								RaiseException(ex.GetInfo());
+							}
+							else
+							{
+								RaiseException(ex.Message(), ex.IsFatal());
+							}
+						}
+						catch (const Exception& ex)
+						{
+							RaiseException(ex.Message(), false);
+						}
+						catch (const Error& ex)
+						{
+							RaiseException(ex.Description(), false);
+						}
+						break;
+					case WfRuntimeExecutionStatus::RaisedException:
+						// unwinding the stack to a trap frame is rare, reuse the step-wise implementation
+						if (Execute(nullptr) == WfRuntimeExecutionAction::Nop)
+						{
+							return;
+						}
+						break;
+					default:
+						return;
+					}
+				}
+			}
+
+#undef FAST_FETCH
+#undef FAST_BEGIN
+#undef FAST_END
+#undef FAST_CASE
+#undef FAST_NEXT
+#undef FAST_JUMP
+#undef FAST_ACTION
+#undef FAST_COMPARE
+#undef FAST_COMPARE_JUMP
+#undef FAST_SPECIALIZED
+
 #undef INTERNAL_ERROR
 #undef CONTEXT_ACTION
 #undef CALL_DEBUGGER
@@ -1230,8 +1801,6 @@ WfRuntimeThreadContext
 #undef TYPE_OF_F8
 #undef TYPE_OF_String
 #undef EXECUTE
-#undef BEGIN_TYPE
-#undef END_TYPE
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "WfRuntime.h"
+
+namespace vl
+{
+	namespace workflow
+	{
+		namespace runtime
+		{
+			using namespace collections;
+			using namespace reflection;
+			using namespace reflection::description;
+
+/***********************************************************************
+WfRuntimeHashMap::EntryList
+***********************************************************************/
+
+			// removed keys are compacted before keys or values are read in order
+			class WfRuntimeHashMap::EntryList : public ValueReadonlyListWrapper<const List<Value>*>
+			{
+			protected:
+				WfRuntimeHashMap*				map;
+
+			public:
+				EntryList(WfRuntimeHashMap* _map, const List<Value>* _list)
+					:ValueReadonlyListWrapper<const List<Value>*>(_list)
+					, map(_map)
+				{
+				}
+
+				Ptr<IValueEnumerator> CreateEnumerator()override
+				{
+					map->Compact();
+					return ValueReadonlyListWrapper<const List<Value>*>::CreateEnumerator();
+				}
+
+				vint GetCount()override
+				{
+					map->Compact();
+					return ValueReadonlyListWrapper<const List<Value>*>::GetCount();
+				}
+
+				Value Get(vint index)override
+				{
+					map->Compact();
+					return ValueReadonlyListWrapper<const List<Value>*>::Get(index);
+				}
+
+				bool Contains(const Value& value)override
+				{
+					map->Compact();
+					return ValueReadonlyListWrapper<const List<Value>*>::Contains(value);
+				}
+
+				vint IndexOf(const Value& value)override
+				{
+					map->Compact();
+					return ValueReadonlyListWrapper<const List<Value>*>::IndexOf(value);
+				}
+			};
+
+/***********************************************************************
+WfRuntimeHashMap::KeyList
+***********************************************************************/
+
+			class WfRuntimeHashMap::KeyList : public EntryList
+			{
+			public:
+				KeyList(WfRuntimeHashMap* _map)
+					:EntryList(_map, &_map->keys)
+				{
+				}
+
+				bool Contains(const Value& value)override
+				{
+					return map->FindSlot(value) != -1;
+				}
+
+				vint IndexOf(const Value& value)override
+				{
+					return map->IndexOf(value);
+				}
+			};
+
+/***********************************************************************
+WfRuntimeHashMap
+***********************************************************************/
+
+			void WfRuntimeHashMap::Rehash(vint bucketCount)
+			{
+				buckets.Resize(bucketCount);
+				for (vint i = 0; i < buckets.Count(); i++)
+				{
+					buckets[i] = -1;
+				}
+
+				vint mask = buckets.Count() - 1;
+				for (vint i = 0; i < keys.Count(); i++)
+				{
+					vint slot = (vint)(GetHash(keys[i]) & (vuint64_t)mask);
+					while (buckets[slot] != -1)
+					{
+						slot = (slot + 1) & mask;
+					}
+					buckets[slot] = i;
+				}
+			}
+
+			void WfRuntimeHashMap::Compact()
+			{
+				if (removedCount == 0) return;
+
+				// keys that are not removed are still referenced by a slot
+				Array<bool> alive(keys.Count());
+				for (vint i = 0; i < alive.Count(); i++)
+				{
+					alive[i] = false;
+				}
+				for (vint i = 0; i < buckets.Count(); i++)
+				{
+					if (buckets[i] >= 0)
+					{
+						alive[buckets[i]] = true;
+					}
+				}
+
+				vint count = 0;
+				for (vint i = 0; i < keys.Count(); i++)
+				{
+					if (alive[i])
+					{
+						if (count != i)
+						{
+							keys.Set(count, keys[i]);
+							values.Set(count, values[i]);
+						}
+						count++;
+					}
+				}
+				keys.RemoveRange(count, keys.Count() - count);
+				values.RemoveRange(count, values.Count() - count);
+				removedCount = 0;
+				Rehash(buckets.Count());
+			}
+
+			vint WfRuntimeHashMap::FindSlot(const Value& key)
+			{
+				if (buckets.Count() == 0) return -1;
+				vint mask = buckets.Count() - 1;
+				vint slot = (vint)(GetHash(key) & (vuint64_t)mask);
+				while (true)
+				{
+					vint index = buckets[slot];
+					if (index == -1) return -1;
+					if (index >= 0 && keys[index] == key) return slot;
+					slot = (slot + 1) & mask;
+				}
+			}
+
+			WfRuntimeHashMap::WfRuntimeHashMap()
+			{
+			}
+
+			vuint64_t WfRuntimeHashMap::GetHash(vuint64_t number)
+			{
+				// objects are aligned, and close numbers in texts only change the last characters, so spread all bits over the lower ones
+				number ^= number >> 33;
+				number *= 0xFF51AFD7ED558CCDULL;
+				number ^= number >> 33;
+				return number;
+			}
+
+			vuint64_t WfRuntimeHashMap::GetHash(const WString& text)
+			{
+				// FNV-1a
+				auto buffer = text.Buffer();
+				vuint64_t hash = 14695981039346656037ULL;
+				for (vint i = 0; i < text.Length(); i++)
+				{
+					hash = (hash ^ (vuint64_t)buffer[i]) * 1099511628211ULL;
+				}
+				return GetHash(hash);
+			}
+
+			vuint64_t WfRuntimeHashMap::GetHash(const Value& value)
+			{
+				vuint64_t hash = (vuint64_t)value.GetValueType();
+				switch (value.GetValueType())
+				{
+				case Value::Text:
+					return GetHash(value.GetText());
+				case Value::RawPtr:
+				case Value::SharedPtr:
+					hash = hash * 31 + (vuint64_t)(vint)value.GetRawPtr();
+					break;
+				default:;
+				}
+				return GetHash(hash);
+			}
+
+			vint WfRuntimeHashMap::IndexOf(const Value& key)
+			{
+				Compact();
+				vint slot = FindSlot(key);
+				return slot == -1 ? -1 : buckets[slot];
+			}
+
+			IValueReadonlyList* WfRuntimeHashMap::GetKeys()
+			{
+				if (!keyList)
+				{
+					keyList = new KeyList(this);
+				}
+				return keyList.Obj();
+			}
+
+			IValueReadonlyList* WfRuntimeHashMap::GetValues()
+			{
+				if (!valueList)
+				{
+					valueList = new EntryList(this, &values);
+				}
+				return valueList.Obj();
+			}
+
+			vint WfRuntimeHashMap::GetCount()
+			{
+				return keys.Count() - removedCount;
+			}
+
+			Value WfRuntimeHashMap::Get(const Value& key)
+			{
+				vint slot = FindSlot(key);
+				CHECK_ERROR(slot != -1, L"WfRuntimeHashMap::Get(const Value&)#The key does not exist.");
+				return values[buckets[slot]];
+			}
+
+			void WfRuntimeHashMap::Set(const Value& key, const Value& value)
+			{
+				vint slot = FindSlot(key);
+				if (slot != -1)
+				{
+					values.Set(buckets[slot], value);
+					return;
+				}
+
+				// keep at least half of the slots empty, removed keys also occupy slots
+				if ((keys.Count() + 1) * 2 > buckets.Count())
+				{
+					Compact();
+					if ((keys.Count() + 1) * 2 > buckets.Count())
+					{
+						Rehash(buckets.Count() == 0 ? 16 : buckets.Count() * 2);
+					}
+				}
+
+				vint mask = buckets.Count() - 1;
+				slot = (vint)(GetHash(key) & (vuint64_t)mask);
+				while (buckets[slot] != -1)
+				{
+					slot = (slot + 1) & mask;
+				}
+				buckets[slot] = keys.Add(key);
+				values.Add(value);
+			}
+
+			bool WfRuntimeHashMap::Remove(const Value& key)
+			{
+				vint slot = FindSlot(key);
+				if (slot == -1) return false;
+
+				// the slot stays occupied so that other keys are still found, the key is dropped when compacting
+				vint index = buckets[slot];
+				buckets[slot] = -2;
+				keys.Set(index, Value());
+				values.Set(index, Value());
+				removedCount++;
+
+				// compacting after more than half of the keys are removed keeps removing O(1) amortized
+				if (removedCount * 2 > keys.Count())
+				{
+					Compact();
+				}
+				return true;
+			}
+
+			void WfRuntimeHashMap::Clear()
+			{
+				keys.Clear();
+				values.Clear();
+				buckets.Resize(0);
+				removedCount = 0;
+			}
+		}
+	}
+}
@@ -0,0 +1,532 @@
+#include "WfRuntime.h"
+
+namespace vl
+{
+	namespace workflow
+	{
+		namespace runtime
+		{
+			using namespace collections;
+			using namespace reflection::description;
+
+/***********************************************************************
+WfAssembly (Verification)
+***********************************************************************/
+
+			class WfAssemblyFunctionVerifier : public Object
+			{
+			protected:
+				struct TrapFrame
+				{
+					vint							parent;
+					vint							stackDepth;
+				};
+
+				WfAssembly*							assembly;
+				WfAssemblyFunction*					function;
+				List<WString>&						errors;
+				const WfRuntimePrimitiveTypes&		primitiveTypes;
+
+				Array<vint>							stackDepths;		// instruction -> stack depth before executing, -1 for unreached instructions
+				Array<vint>							trapFrames;			// instruction -> index of the innermost trap frame before executing
+				List<TrapFrame>						trapFrameNodes;
+				List<vint>							pendingInstructions;
+
+				bool Error(vint index, const WString& message)
+				{
+					errors.Add(L"Function \"" + function->name + L"\", instruction " + itow(index) + L": " + message);
+					return false;
+				}
+
+				bool Reach(vint from, vint index, vint stackDepth, vint trapFrame)
+				{
+					if (index < function->firstInstruction || index > function->lastInstruction)
+					{
+						return Error(from, L"jumps to instruction " + itow(index) + L" outside of the function.");
+					}
+
+					vint offset = index - function->firstInstruction;
+					if (stackDepths[offset] == -1)
+					{
+						stackDepths[offset] = stackDepth;
+						trapFrames[offset] = trapFrame;
+						pendingInstructions.Add(index);
+					}
+					else if (stackDepths[offset] != stackDepth)
+					{
+						return Error(index, L"reached with different stack depths " + itow(stackDepths[offset]) + L" and " + itow(stackDepth) + L".");
+					}
+					else if (trapFrames[offset] != trapFrame)
+					{
+						return Error(index, L"reached with different trap frames.");
+					}
+					return true;
+				}
+
+				bool VerifyLocalVariableIndex(vint index, vint variableIndex)
+				{
+					if (variableIndex < 0 || variableIndex >= function->argumentNames.Count() + function->localVariableNames.Count())
+					{
+						return Error(index, L"illegal local variable index.");
+					}
+					return true;
+				}
+
+				bool VerifyFunctionIndex(vint index, vint functionIndex)
+				{
+					if (functionIndex < 0 || functionIndex >= assembly->functions.Count())
+					{
+						return Error(index, L"illegal function index " + itow(functionIndex) + L".");
+					}
+					return true;
+				}
+
+				bool VerifyInstruction(vint index, vint stackDepth, vint trapFrame, vint& maxStackDepth)
+				{
+					auto& ins = assembly->instructions[index];
+					vint popCount = 0;
+					vint pushCount = 0;
+					bool fallThrough = true;
+
+					switch (WfInstruction::GetGenericCode(ins.code))
+					{
+					case WfInsCode::Nop:
+						break;
+					case WfInsCode::LoadValue:
+					case WfInsCode::LoadException:
+						pushCount = 1;
+						break;
+					case WfInsCode::LoadClosure:
+						if (!VerifyFunctionIndex(index, ins.indexParameter)) return false;
+						if (ins.countParameter != assembly->functions[ins.indexParameter]->capturedVariableNames.Count())
+						{
+							return Error(index, L"wrong captured variable count.");
+						}
+						popCount = ins.countParameter;
+						pushCount = 1;
+						break;
+					case WfInsCode::LoadLocalVar:
+					case WfInsCode::StoreLocalVar:
+						if (!VerifyLocalVariableIndex(index, ins.indexParameter)) return false;
+						if (ins.code == WfInsCode::LoadLocalVar)
+						{
+							pushCount = 1;
+						}
+						else
+						{
+							popCount = 1;
+						}
+						break;
+					case WfInsCode::LoadCapturedVar:
+						if (ins.indexParameter < 0 || ins.indexParameter >= function->capturedVariableNames.Count())
+						{
+							return Error(index, L"illegal captured variable index.");
+						}
+						pushCount = 1;
+						break;
+					case WfInsCode::LoadGlobalVar:
+					case WfInsCode::StoreGlobalVar:
+						if (ins.indexParameter < 0 || ins.indexParameter >= assembly->variableNames.Count())
+						{
+							return Error(index, L"illegal global variable index.");
+						}
+						if (ins.code == WfInsCode::LoadGlobalVar)
+						{
+							pushCount = 1;
+						}
+						else
+						{
+							popCount = 1;
+						}
+						break;
+					case WfInsCode::Duplicate:
+						if (ins.countParameter < 0 || ins.countParameter >= stackDepth)
+						{
+							return Error(index, L"failed to duplicate a value from the stack.");
+						}
+						pushCount = 1;
+						break;
+					case WfInsCode::Pop:
+					case WfInsCode::DeleteRawPtr:
+					case WfInsCode::JumpIf:
+						popCount = 1;
+						break;
+					case WfInsCode::Return:
+						if (trapFrame != -1)
+						{
+							return Error(index, L"returns with an installed trap frame.");
+						}
+						popCount = 1;
+						fallThrough = false;
+						break;
+					case WfInsCode::RaiseException:
+						popCount = 1;
+						fallThrough = false;
+						break;
+					case WfInsCode::CreateArray:
+						popCount = ins.countParameter;
+						pushCount = 1;
+						break;
+					case WfInsCode::ConcatN:
+						if (ins.countParameter < 2)
+						{
+							return Error(index, L"expects at least two strings.");
+						}
+						popCount = ins.countParameter;
+						pushCount = 1;
+						break;
+					case WfInsCode::CreateMap:
+					case WfInsCode::CreateHashMap:
+						if (ins.countParameter % 2 != 0)
+						{
+							return Error(index, L"expects key-value pairs.");
+						}
+						popCount = ins.countParameter;
+						pushCount = 1;
+						break;
+					case WfInsCode::CreateInterface:
+						{
+							if (ins.indexParameter < 0 || ins.indexParameter >= assembly->methodTables.Count())
+							{
+								return Error(index, L"illegal method table index.");
+							}
+							auto table = assembly->methodTables[ins.indexParameter];
+							if (table->methods.Count() != table->functions.Count())
+							{
+								return Error(index, L"expects a function for each method in the method table.");
+							}
+							FOREACH(vint, function, table->functions)
+							{
+								if (!VerifyFunctionIndex(index, function)) return false;
+								if (ins.countParameter != assembly->functions[function]->capturedVariableNames.Count())
+								{
+									return Error(index, L"wrong captured variable count.");
+								}
+							}
+							popCount = ins.countParameter;
+							pushCount = 1;
+						}
+						break;
+					case WfInsCode::ConvertToType:
+					case WfInsCode::TryConvertToType:
+					case WfInsCode::TestType:
+						if (!ins.typeDescriptorParameter)
+						{
+							return Error(index, L"missing type descriptor.");
+						}
+						popCount = 1;
+						pushCount = 1;
+						break;
+					case WfInsCode::GetProperty:
+						if (!ins.propertyParameter)
+						{
+							return Error(index, L"missing property.");
+						}
+						popCount = 1;
+						pushCount = 1;
+						break;
+					case WfInsCode::ReverseEnumerable:
+					case WfInsCode::GetType:
+					case WfInsCode::DetachEvent:
+					case WfInsCode::OpNot:
+					case WfInsCode::OpPositive:
+					case WfInsCode::OpNegative:
+					case WfInsCode::OpLT:
+					case WfInsCode::OpGT:
+					case WfInsCode::OpLE:
+					case WfInsCode::OpGE:
+					case WfInsCode::OpEQ:
+					case WfInsCode::OpNE:
+						popCount = 1;
+						pushCount = 1;
+						break;
+					case WfInsCode::Jump:
+						fallThrough = false;
+						break;
+					case WfInsCode::Invoke:
+					case WfInsCode::TailInvoke:
+						if (!VerifyFunctionIndex(index, ins.indexParameter)) return false;
+						if (ins.countParameter != assembly->functions[ins.indexParameter]->argumentNames.Count())
+						{
+							return Error(index, L"wrong argument count.");
+						}
+						if (assembly->functions[ins.indexParameter]->capturedVariableNames.Count() != 0)
+						{
+							return Error(index, L"invokes a function that requires captured variables.");
+						}
+						if (ins.code == WfInsCode::TailInvoke)
+						{
+							if (trapFrame != -1)
+							{
+								return Error(index, L"tail-invokes with an installed trap frame.");
+							}
+							popCount = ins.countParameter;
+							fallThrough = false;
+						}
+						else
+						{
+							popCount = ins.countParameter;
+							pushCount = 1;
+						}
+						break;
+					case WfInsCode::InvokeMethod:
+					case WfInsCode::InvokeProxy:
+						if (ins.code == WfInsCode::InvokeMethod && !ins.methodParameter)
+						{
+							return Error(index, L"missing method.");
+						}
+						if (ins.countParameter < 0)
+						{
+							return Error(index, L"wrong argument count.");
+						}
+						popCount = ins.countParameter + 1;
+						pushCount = 1;
+						break;
+					case WfInsCode::AttachEvent:
+						if (!ins.eventParameter)
+						{
+							return Error(index, L"missing event.");
+						}
+						popCount = 2;
+						pushCount = 1;
+						break;
+					case WfInsCode::InstallTry:
+					case WfInsCode::UninstallTry:
+						break;
+					case WfInsCode::CreateRange:
+					case WfInsCode::CompareLiteral:
+					case WfInsCode::OpExp:
+					case WfInsCode::OpAdd:
+					case WfInsCode::OpSub:
+					case WfInsCode::OpMul:
+					case WfInsCode::OpDiv:
+					case WfInsCode::OpMod:
+					case WfInsCode::OpShl:
+					case WfInsCode::OpShr:
+					case WfInsCode::OpXor:
+					case WfInsCode::OpAnd:
+					case WfInsCode::OpOr:
+						if (ins.code == WfInstruction::GetGenericCode(ins.code))
+						{
+							return Error(index, L"unexpected type argument.");
+						}
+						popCount = 2;
+						pushCount = 1;
+						break;
+					case WfInsCode::LoadLocalVar2:
+						if (!VerifyLocalVariableIndex(index, ins.indexParameter)) return false;
+						if (!VerifyLocalVariableIndex(index, ins.countParameter)) return false;
+						pushCount = 2;
+						break;
+					case WfInsCode::IncreaseLocalVar:
+						if (!VerifyLocalVariableIndex(index, ins.indexParameter)) return false;
+						switch (primitiveTypes.GetInsType(ins.valueParameter.GetTypeDescriptor()))
+						{
+						case WfInsType::Bool:
+						case WfInsType::String:
+						case WfInsType::Unknown:
+							return Error(index, L"expects a number.");
+						default:;
+						}
+						break;
+					case WfInsCode::JumpIfLT:
+					case WfInsCode::JumpIfGT:
+					case WfInsCode::JumpIfLE:
+					case WfInsCode::JumpIfGE:
+					case WfInsCode::JumpIfEQ:
+					case WfInsCode::JumpIfNE:
+						if (ins.typeParameter == WfInsType::Unknown)
+						{
+							return Error(index, L"unexpected type argument.");
+						}
+						popCount = 2;
+						break;
+					case WfInsCode::SwitchTable:
+						{
+							if (ins.indexParameter < 0 || ins.indexParameter >= assembly->switchTables.Count())
+							{
+								return Error(index, L"illegal switch table index.");
+							}
+							auto table = assembly->switchTables[ins.indexParameter];
+							switch (table->type)
+							{
+							case WfInsType::Bool:
+							case WfInsType::F4:
+							case WfInsType::F8:
+							case WfInsType::Unknown:
+								return Error(index, L"expects a switch table of integers or strings.");
+							default:;
+							}
+							if (table->keys.Count() != table->labels.Count())
+							{
+								return Error(index, L"expects a label for each key in the switch table.");
+							}
+							popCount = 1;
+						}
+						break;
+					case WfInsCode::TestElementInConstantSet:
+						{
+							if (ins.indexParameter < 0 || ins.indexParameter >= assembly->constantSets.Count())
+							{
+								return Error(index, L"illegal constant set index.");
+							}
+							switch (assembly->constantSets[ins.indexParameter]->type)
+							{
+							case WfInsType::Bool:
+							case WfInsType::F4:
+							case WfInsType::F8:
+							case WfInsType::Unknown:
+								return Error(index, L"expects a constant set of integers or strings.");
+							default:;
+							}
+							popCount = 1;
+							pushCount = 1;
+						}
+						break;
+					case WfInsCode::TestElementInSet:
+					case WfInsCode::CompareStruct:
+					case WfInsCode::CompareReference:
+					case WfInsCode::CompareValue:
+					case WfInsCode::OpConcat:
+						popCount = 2;
+						pushCount = 1;
+						break;
+					default:
+						return Error(index, L"unknown instruction.");
+					}
+
+					if (popCount < 0)
+					{
+						return Error(index, L"illegal value count.");
+					}
+					if (stackDepth < popCount)
+					{
+						return Error(index, L"pops " + itow(popCount) + L" values from a stack of depth " + itow(stackDepth) + L".");
+					}
+					stackDepth = stackDepth - popCount + pushCount;
+					if (maxStackDepth < stackDepth)
+					{
+						maxStackDepth = stackDepth;
+					}
+
+					switch (ins.code)
+					{
+					case WfInsCode::Jump:
+					case WfInsCode::JumpIf:
+					case WfInsCode::JumpIfLT:
+					case WfInsCode::JumpIfGT:
+					case WfInsCode::JumpIfLE:
+					case WfInsCode::JumpIfGE:
+					case WfInsCode::JumpIfEQ:
+					case WfInsCode::JumpIfNE:
+						if (!Reach(index, ins.indexParameter, stackDepth, trapFrame)) return false;
+						break;
+					case WfInsCode::SwitchTable:
+						FOREACH(vint, label, assembly->switchTables[ins.indexParameter]->labels)
+						{
+							if (!Reach(index, label, stackDepth, trapFrame)) return false;
+						}
+						break;
+					case WfInsCode::InstallTry:
+						{
+							if (!Reach(index, ins.indexParameter, stackDepth, trapFrame)) return false;
+							TrapFrame node;
+							node.parent = trapFrame;
+							node.stackDepth = stackDepth;
+							trapFrame = trapFrameNodes.Add(node);
+						}
+						break;
+					case WfInsCode::UninstallTry:
+						{
+							if (trapFrame == -1)
+							{
+								return Error(index, L"no trap frame to uninstall.");
+							}
+							auto node = trapFrameNodes[trapFrame];
+							if (ins.countParameter < 0 || node.stackDepth + ins.countParameter > stackDepth)
+							{
+								return Error(index, L"keeps more values than the stack has since the trap frame is installed.");
+							}
+							stackDepth = node.stackDepth + ins.countParameter;
+							trapFrame = node.parent;
+						}
+						break;
+					default:;
+					}
+
+					if (fallThrough)
+					{
+						if (index == function->lastInstruction)
+						{
+							return Error(index, L"executes beyond the last instruction of the function.");
+						}
+						if (!Reach(index, index + 1, stackDepth, trapFrame)) return false;
+					}
+					return true;
+				}
+			public:
+				WfAssemblyFunctionVerifier(WfAssembly* _assembly, WfAssemblyFunction* _function, List<WString>& _errors, const WfRuntimePrimitiveTypes& _primitiveTypes)
+					:assembly(_assembly)
+					, function(_function)
+					, errors(_errors)
+					, primitiveTypes(_primitiveTypes)
+				{
+				}
+
+				bool Verify()
+				{
+					if (function->firstInstruction < 0 || function->lastInstruction >= assembly->instructions.Count() || function->firstInstruction > function->lastInstruction)
+					{
+						errors.Add(L"Function \"" + function->name + L"\": illegal instruction range.");
+						return false;
+					}
+
+					vint count = function->lastInstruction - function->firstInstruction + 1;
+					stackDepths.Resize(count);
+					trapFrames.Resize(count);
+					for (vint i = 0; i < count; i++)
+					{
+						stackDepths[i] = -1;
+						trapFrames[i] = -1;
+					}
+
+					vint maxStackDepth = 0;
+					if (!Reach(function->firstInstruction, function->firstInstruction, 0, -1)) return false;
+					while (pendingInstructions.Count() > 0)
+					{
+						vint index = pendingInstructions[pendingInstructions.Count() - 1];
+						pendingInstructions.RemoveAt(pendingInstructions.Count() - 1);
+
+						vint offset = index - function->firstInstruction;
+						if (!VerifyInstruction(index, stackDepths[offset], trapFrames[offset], maxStackDepth)) return false;
+					}
+
+					function->maxStackDepth = maxStackDepth;
+					return true;
+				}
+			};
+
+			bool WfAssembly::Verify(collections::List<WString>& errors)
+			{
+				verified = false;
+				FOREACH(Ptr<WfAssemblyFunction>, function, functions)
+				{
+					function->maxStackDepth = -1;
+				}
+
+				WfRuntimePrimitiveTypes primitiveTypes;
+				FOREACH(Ptr<WfAssemblyFunction>, function, functions)
+				{
+					WfAssemblyFunctionVerifier verifier(this, function.Obj(), errors, primitiveTypes);
+					if (!verifier.Verify())
+					{
+						return false;
+					}
+				}
+
+				verified = true;
+				return true;
+			}
+		}
+	}
+}
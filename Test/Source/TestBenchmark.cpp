@@ -0,0 +1,313 @@
+#include "TestFunctions.h"
+
+// benchmarks only run when the unit test is started with /benchmark (Windows) or --benchmark (Linux)
+
+template<typename TBody>
+void RunBenchmark(const WString& name, vint count, const TBody& body)
+{
+	auto start = DateTime::LocalTime();
+	body(count);
+	auto end = DateTime::LocalTime();
+	UnitTest::PrintInfo(L"    " + itow(count) + L" " + name + L": " + i64tow(end.totalMilliseconds - start.totalMilliseconds) + L" ms");
+}
+
+TEST_CASE(BenchmarkLambdaInvoke)
+{
+	if (!IsBenchmarkEnabled()) return;
+	auto globalContext = InitializeAssembly(CompileModule(LR"workflow(
+module test;
+
+func Add(a : int, b : int) : int
+{
+	return a + b;
+}
+)workflow"));
+	auto add = LoadFunction<vint(vint, vint)>(globalContext, L"Add");
+
+	RunBenchmark(L"native to script calls", 1000000, [&](vint count)
+	{
+		vint sum = 0;
+		for (vint i = 0; i < count; i++)
+		{
+			sum = add(sum, 1);
+		}
+		TEST_ASSERT(sum == count);
+	});
+}
+
+TEST_CASE(BenchmarkCallSiteCache)
+{
+	if (!IsBenchmarkEnabled()) return;
+	auto globalContext = InitializeAssembly(CompileModule(LR"workflow(
+module test;
+
+func FillAndSum(count : int) : int
+{
+	var xs : int[] = {};
+	for (i in range[0, count))
+	{
+		xs.Add(i);
+	}
+	var sum = 0;
+	for (i in range[0, xs.Count))
+	{
+		sum = sum + xs[i];
+	}
+	return sum;
+}
+)workflow"));
+	auto fillAndSum = LoadFunction<vint(vint)>(globalContext, L"FillAndSum");
+
+	RunBenchmark(L"list items written and read", 100000, [&](vint count)
+	{
+		TEST_ASSERT(fillAndSum(count) == (count - 1) * count / 2);
+	});
+}
+
+TEST_CASE(BenchmarkMethodTable)
+{
+	if (!IsBenchmarkEnabled()) return;
+	auto globalContext = InitializeAssembly(CompileModule(LR"workflow(
+module test;
+using system::*;
+
+func Sum(count : int) : int
+{
+	var current = {0};
+	var enumerator = new Enumerator^
+	{
+		func GetCurrent() : object
+		{
+			return current[0];
+		}
+
+		func GetIndex() : int
+		{
+			return current[0] - 1;
+		}
+
+		func Next() : bool
+		{
+			current[0] = current[0] + 1;
+			return true;
+		}
+	};
+
+	var sum = 0;
+	for (i in range[1, count])
+	{
+		enumerator.Next();
+		sum = sum + cast int enumerator.GetCurrent();
+	}
+	return sum;
+}
+)workflow"));
+	auto sum = LoadFunction<vint(vint)>(globalContext, L"Sum");
+
+	RunBenchmark(L"iterations with 2 interface method calls", 100000, [&](vint count)
+	{
+		TEST_ASSERT(sum(count) == count * (count + 1) / 2);
+	});
+}
+
+TEST_CASE(BenchmarkTailInvoke)
+{
+	if (!IsBenchmarkEnabled()) return;
+	auto globalContext = InitializeAssembly(CompileModule(LR"workflow(
+module test;
+
+func SumTo(n : int, sum : int) : int
+{
+	if (n == 0)
+	{
+		return sum;
+	}
+	return SumTo(n - 1, sum + n);
+}
+)workflow"));
+	auto sumTo = LoadFunction<vint(vint, vint)>(globalContext, L"SumTo");
+
+	RunBenchmark(L"tail calls", 1000000, [&](vint count)
+	{
+		TEST_ASSERT(sumTo(count, 0) == count * (count + 1) / 2);
+	});
+}
+
+TEST_CASE(BenchmarkLocalClosure)
+{
+	if (!IsBenchmarkEnabled()) return;
+	auto globalContext = InitializeAssembly(CompileModule(LR"workflow(
+module test;
+
+func Sum(count : int, step : int) : int
+{
+	var add : func(int, int):int = [$1 + $2 * step];
+	var sum = 0;
+	for (i in range[1, count])
+	{
+		sum = add(sum, i);
+	}
+	return sum;
+}
+)workflow"));
+	auto sum = LoadFunction<vint(vint, vint)>(globalContext, L"Sum");
+
+	RunBenchmark(L"local closure calls", 1000000, [&](vint count)
+	{
+		TEST_ASSERT(sum(count, 2) == count * (count + 1));
+	});
+}
+
+TEST_CASE(BenchmarkInlineFunction)
+{
+	if (!IsBenchmarkEnabled()) return;
+	WfCodegenOptions options;
+	options.optimizeInstructions = true;
+	options.inlineFunctions = true;
+	auto globalContext = InitializeAssembly(CompileModule(LR"workflow(
+module test;
+
+func Square(x : int) : int
+{
+	return x * x;
+}
+
+func IsOdd(x : int) : bool
+{
+	return x % 2 == 1;
+}
+
+func SumOddSquares(count : int) : int
+{
+	var sum = 0;
+	for (i in range[1, count])
+	{
+		if (IsOdd(i))
+		{
+			sum = sum + Square(i);
+		}
+	}
+	return sum;
+}
+)workflow", options));
+	auto sumOddSquares = LoadFunction<vint(vint)>(globalContext, L"SumOddSquares");
+
+	RunBenchmark(L"iterations with inlined calls", 1000000, [&](vint count)
+	{
+		TEST_ASSERT(sumOddSquares(count) == (count / 2) * (4 * (count / 2) * (count / 2) - 1) / 3);
+	});
+}
+
+TEST_CASE(BenchmarkConstantSet)
+{
+	if (!IsBenchmarkEnabled()) return;
+	WString ids;
+	for (vint i = 0; i < 500; i++)
+	{
+		ids += L" " + itow(i * 7919 % 100003);
+	}
+
+	auto globalContext = InitializeAssembly(CompileModule(LR"workflow(
+module test;
+
+func CountAllowed(count : int) : int
+{
+	var allowed = 0;
+	for (i in range[0, count - 1])
+	{
+		if (i in {)workflow" + ids + LR"workflow(})
+		{
+			allowed = allowed + 1;
+		}
+	}
+	return allowed;
+}
+)workflow"));
+	auto countAllowed = LoadFunction<vint(vint)>(globalContext, L"CountAllowed");
+
+	RunBenchmark(L"tests against 500 constant keys", 100003, [&](vint count)
+	{
+		TEST_ASSERT(countAllowed(count) == 500);
+	});
+}
+
+TEST_CASE(BenchmarkHashMap)
+{
+	if (!IsBenchmarkEnabled()) return;
+
+	// the MapProcessing sample scaled to count keys
+	const wchar_t* code = LR"workflow(
+module test;
+using system::*;
+
+func Process(count : int) : string
+{
+	var xs = {"a":1 "b":2 "c":3 "d":4 "e":5};
+	for (i in range[1, count])
+	{
+		xs.Set("key" & i, i);
+	}
+	var s1 = xs.Count & ", " & xs["a"] & ", " & xs["e"];
+	var sum = 0;
+	for (i in range[1, count])
+	{
+		sum = sum + xs["key" & i];
+	}
+	xs["e"] = 6;
+	for (i in range[1, count])
+	{
+		xs.Remove("key" & i);
+	}
+	var s2 = xs.Count & ", " & xs["a"] & ", " & xs["e"];
+	return s1 & ", " & s2 & ", " & sum;
+}
+)workflow";
+
+	for (vint i = 0; i < 2; i++)
+	{
+		WfCodegenOptions options;
+		options.hashMaps = i == 1;
+		auto process = LoadFunction<WString(vint)>(InitializeAssembly(CompileModule(code, options)), L"Process");
+		RunBenchmark(L"keys in " + (options.hashMaps ? WString(L"WfRuntimeHashMap") : WString(L"IValueDictionary::Create()")), 100000, [&](vint count)
+		{
+			TEST_ASSERT(process(count) == itow(count + 5) + L", 1, 5, 5, 1, 6, " + itow(count * (count + 1) / 2));
+		});
+	}
+}
+
+TEST_CASE(BenchmarkAssemblyCache)
+{
+	if (!IsBenchmarkEnabled()) return;
+	const wchar_t* code = LR"workflow(
+module test;
+
+func Main() : int
+{
+	var sum = 0;
+	for (i in range[1, 100])
+	{
+		sum = sum + i;
+	}
+	return sum;
+}
+)workflow";
+
+	// a cached assembly is deserialized instead of compiled
+	MemoryStream stream;
+	RunBenchmark(L"compilings", 100, [&](vint count)
+	{
+		for (vint i = 0; i < count; i++)
+		{
+			CompileModule(code);
+		}
+	});
+	CompileModule(code)->Serialize(stream);
+	RunBenchmark(L"deserializings", 100, [&](vint count)
+	{
+		for (vint i = 0; i < count; i++)
+		{
+			stream.SeekFromBegin(0);
+			Ptr<WfAssembly> assembly = new WfAssembly(stream);
+		}
+	});
+}
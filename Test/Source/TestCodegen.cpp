@@ -1,5 +1,77 @@
 #include "TestFunctions.h"
 
+void TestCodegenAssembly(Ptr<WfAssembly> assembly, const WString& itemName, const WString& itemResult)
+{
+	TEST_ASSERT(assembly);
+	LogSampleCodegenResult(L"Codegen", itemName, assembly);
+	{
+		MemoryStream stream;
+		assembly->Serialize(stream);
+		UnitTest::PrintInfo(L"    serialized: " + i64tow(stream.Size()) + L" bytes");
+		stream.SeekFromBegin(0);
+		assembly = new WfAssembly(stream);
+	}
+
+	TEST_ASSERT(assembly->verified);
+	FOREACH(Ptr<WfAssemblyFunction>, function, assembly->functions)
+	{
+		TEST_ASSERT(function->maxStackDepth >= 0);
+	}
+
+	WfRuntimeThreadContext context(assembly);
+	TEST_ASSERT(context.status == WfRuntimeExecutionStatus::Finished);
+
+	{
+		vint functionIndex = assembly->functionByName[L"<initialize>"][0];
+		context.PushStackFrame(functionIndex, 0);
+		TEST_ASSERT(context.status == WfRuntimeExecutionStatus::Ready);
+
+		while (context.status != WfRuntimeExecutionStatus::Finished)
+		{
+			auto action = context.Execute(nullptr);
+			TEST_ASSERT(action != WfRuntimeExecutionAction::Nop);
+		}
+		TEST_ASSERT(context.Execute(nullptr) == WfRuntimeExecutionAction::Nop);
+		Value result;
+		TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
+	}
+
+	{
+		vint functionIndex = assembly->functionByName[L"main"][0];
+		context.PushStackFrame(functionIndex, 0);
+		TEST_ASSERT(context.status == WfRuntimeExecutionStatus::Ready);
+
+		while (context.status != WfRuntimeExecutionStatus::Finished)
+		{
+			auto action = context.Execute(nullptr);
+			TEST_ASSERT(action != WfRuntimeExecutionAction::Nop);
+		}
+		TEST_ASSERT(context.Execute(nullptr) == WfRuntimeExecutionAction::Nop);
+	}
+	
+	Value result;
+	TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
+	UnitTest::PrintInfo(L"    expected: " + itemResult);
+	UnitTest::PrintInfo(L"    actual: " + result.GetText());
+	TEST_ASSERT(result.GetText() == itemResult);
+	TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::EmptyStack);
+
+	{
+		WfRuntimeThreadContext context(assembly);
+		context.PushStackFrame(assembly->functionByName[L"<initialize>"][0], 0);
+		context.ExecuteToEnd();
+		TEST_ASSERT(context.status == WfRuntimeExecutionStatus::Finished);
+		TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
+
+		context.PushStackFrame(assembly->functionByName[L"main"][0], 0);
+		context.ExecuteToEnd();
+		TEST_ASSERT(context.status == WfRuntimeExecutionStatus::Finished);
+		TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
+		TEST_ASSERT(result.GetText() == itemResult);
+		TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::EmptyStack);
+	}
+}
+
 TEST_CASE(TestCodegen)
 {
 	Ptr<ParsingTable> table = GetWorkflowTable();
@@ -52,53 +124,17 @@ TEST_CASE(TestCodegen)
 		TEST_ASSERT(manager.errors.Count() == 0);
 		
 		Ptr<WfAssembly> assembly = GenerateAssembly(&manager);
-		TEST_ASSERT(assembly);
-		LogSampleCodegenResult(L"Codegen", itemName, assembly);
-		{
-			MemoryStream stream;
-			assembly->Serialize(stream);
-			UnitTest::PrintInfo(L"    serialized: " + i64tow(stream.Size()) + L" bytes");
-			stream.SeekFromBegin(0);
-			assembly = new WfAssembly(stream);
-		}
-
-		WfRuntimeThreadContext context(assembly);
-		TEST_ASSERT(context.status == WfRuntimeExecutionStatus::Finished);
-
-		{
-			vint functionIndex = assembly->functionByName[L"<initialize>"][0];
-			context.PushStackFrame(functionIndex, 0);
-			TEST_ASSERT(context.status == WfRuntimeExecutionStatus::Ready);
-
-			while (context.status != WfRuntimeExecutionStatus::Finished)
-			{
-				auto action = context.Execute(nullptr);
-				TEST_ASSERT(action != WfRuntimeExecutionAction::Nop);
-			}
-			TEST_ASSERT(context.Execute(nullptr) == WfRuntimeExecutionAction::Nop);
-			Value result;
-			TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
-		}
+		TestCodegenAssembly(assembly, itemName, itemResult);
 
-		{
-			vint functionIndex = assembly->functionByName[L"main"][0];
-			context.PushStackFrame(functionIndex, 0);
-			TEST_ASSERT(context.status == WfRuntimeExecutionStatus::Ready);
+		WfCodegenOptions options;
+		options.optimizeInstructions = true;
+		Ptr<WfAssembly> optimizedAssembly = GenerateAssembly(&manager, options);
+		TEST_ASSERT(optimizedAssembly->instructions.Count() <= assembly->instructions.Count());
+		TestCodegenAssembly(optimizedAssembly, itemName + L".Optimized", itemResult);
 
-			while (context.status != WfRuntimeExecutionStatus::Finished)
-			{
-				auto action = context.Execute(nullptr);
-				TEST_ASSERT(action != WfRuntimeExecutionAction::Nop);
-			}
-			TEST_ASSERT(context.Execute(nullptr) == WfRuntimeExecutionAction::Nop);
-		}
-		
-		Value result;
-		TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
-		UnitTest::PrintInfo(L"    expected: " + itemResult);
-		UnitTest::PrintInfo(L"    actual: " + result.GetText());
-		TEST_ASSERT(result.GetText() == itemResult);
-		TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::EmptyStack);
+		options.inlineFunctions = true;
+		Ptr<WfAssembly> inlinedAssembly = GenerateAssembly(&manager, options);
+		TestCodegenAssembly(inlinedAssembly, itemName + L".Inlined", itemResult);
 	}
 }
 
@@ -129,3 +165,1134 @@ func main():string
 	TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
 	TEST_ASSERT(result.GetText() == L"Hello, world!");
 }
+
+TEST_CASE(TestSpecializedInstructions)
+{
+	auto assembly = MakePtr<WfAssembly>();
+	assembly->insBeforeCodegen = new WfInstructionDebugInfo;
+	assembly->insAfterCodegen = new WfInstructionDebugInfo;
+	{
+		auto meta = MakePtr<WfAssemblyFunction>();
+		meta->name = L"main";
+		vint functionIndex = assembly->functions.Add(meta);
+		assembly->functionByName.Add(meta->name, functionIndex);
+
+		meta->firstInstruction = assembly->instructions.Count();
+		assembly->instructions.Add(WfInstruction::LoadValue(BoxValue<vint32_t>(1)));
+		assembly->instructions.Add(WfInstruction::LoadValue(BoxValue<vint32_t>(2)));
+		assembly->instructions.Add(WfInstruction::OpAdd(WfInsType::I4));
+		assembly->instructions.Add(WfInstruction::Return());
+		meta->lastInstruction = assembly->instructions.Count() - 1;
+	}
+	TEST_ASSERT(WfInstruction::OpAdd(WfInsType::I4).code == WfInsCode::OpAdd_I4);
+	TEST_ASSERT(WfInstruction::OpAdd(WfInsType::Unknown).code == WfInsCode::OpAdd);
+	TEST_ASSERT(WfInstruction::GetGenericCode(WfInsCode::OpAdd_I4) == WfInsCode::OpAdd);
+	{
+		MemoryStream stream;
+		assembly->Serialize(stream);
+		stream.SeekFromBegin(0);
+		assembly = new WfAssembly(stream);
+	}
+	TEST_ASSERT(assembly->instructions[2].code == WfInsCode::OpAdd_I4);
+	TEST_ASSERT(assembly->instructions[2].typeParameter == WfInsType::I4);
+
+	WfRuntimeThreadContext context(assembly);
+	context.PushStackFrame(assembly->functionByName[L"main"][0], 0);
+	context.ExecuteToEnd();
+
+	Value result;
+	TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
+	TEST_ASSERT(UnboxValue<vint32_t>(result) == 3);
+
+	// a generic instruction with a type argument is never created, and is rejected
+	WfInstruction add;
+	add.code = WfInsCode::OpAdd;
+	add.typeParameter = WfInsType::I4;
+	assembly->instructions[2] = add;
+	List<WString> errors;
+	TEST_ASSERT(!assembly->Verify(errors));
+}
+
+TEST_CASE(TestAssemblyVerification)
+{
+	auto assembly = MakePtr<WfAssembly>();
+	auto meta = MakePtr<WfAssemblyFunction>();
+	meta->name = L"main";
+	meta->localVariableNames.Add(L"x");
+	assembly->functions.Add(meta);
+	List<WString> errors;
+
+	meta->firstInstruction = assembly->instructions.Count();
+	assembly->instructions.Add(WfInstruction::LoadValue(BoxValue<vint32_t>(1)));
+	assembly->instructions.Add(WfInstruction::StoreLocalVar(0));
+	assembly->instructions.Add(WfInstruction::LoadLocalVar(0));
+	assembly->instructions.Add(WfInstruction::Duplicate(0));
+	assembly->instructions.Add(WfInstruction::OpAdd(WfInsType::I4));
+	assembly->instructions.Add(WfInstruction::Return());
+	meta->lastInstruction = assembly->instructions.Count() - 1;
+	TEST_ASSERT(assembly->Verify(errors));
+	TEST_ASSERT(assembly->verified);
+	TEST_ASSERT(meta->maxStackDepth == 2);
+
+	// stack underflow
+	assembly->instructions[3] = WfInstruction::Nop();
+	TEST_ASSERT(!assembly->Verify(errors));
+	TEST_ASSERT(!assembly->verified);
+	TEST_ASSERT(errors.Count() == 1);
+
+	// illegal local variable index
+	errors.Clear();
+	assembly->instructions[3] = WfInstruction::Duplicate(0);
+	assembly->instructions[2] = WfInstruction::LoadLocalVar(1);
+	TEST_ASSERT(!assembly->Verify(errors));
+	TEST_ASSERT(errors.Count() == 1);
+
+	// different stack depths at the same instruction
+	errors.Clear();
+	assembly->instructions[2] = WfInstruction::LoadLocalVar(0);
+	assembly->instructions[1] = WfInstruction::JumpIf(4);
+	assembly->instructions.Insert(0, WfInstruction::LoadValue(BoxValue<bool>(true)));
+	meta->lastInstruction++;
+	TEST_ASSERT(!assembly->Verify(errors));
+	TEST_ASSERT(errors.Count() == 1);
+
+	// an assembly that fails the verification is rejected with the errors
+	bool rejected = false;
+	try
+	{
+		assembly->Initialize();
+	}
+	catch (const WfRuntimeException& ex)
+	{
+		rejected = ex.Message().Right(errors[0].Length()) == errors[0];
+	}
+	TEST_ASSERT(rejected);
+	TEST_ASSERT(!assembly->verified);
+	TEST_ASSERT(assembly->verificationErrors.Count() == 1);
+}
+
+TEST_CASE(TestRuntimeInstructions)
+{
+	auto assembly = MakePtr<WfAssembly>();
+	auto meta = MakePtr<WfAssemblyFunction>();
+	meta->name = L"main";
+	assembly->functions.Add(meta);
+
+	meta->firstInstruction = assembly->instructions.Count();
+	assembly->instructions.Add(WfInstruction::LoadValue(BoxValue<vint32_t>(1)));
+	assembly->instructions.Add(WfInstruction::LoadValue(BoxValue<vint32_t>(2)));
+	assembly->instructions.Add(WfInstruction::OpAdd(WfInsType::I4));
+	assembly->instructions.Add(WfInstruction::LoadValue(BoxValue<vint32_t>(1)));
+	assembly->instructions.Add(WfInstruction::OpAdd(WfInsType::I4));
+	assembly->instructions.Add(WfInstruction::Return());
+	meta->lastInstruction = assembly->instructions.Count() - 1;
+
+	TEST_ASSERT(sizeof(WfRuntimeInstruction) <= 16);
+	auto globalContext = MakePtr<WfRuntimeGlobalContext>(assembly);
+	TEST_ASSERT(globalContext->instructions.Count() == assembly->instructions.Count());
+	TEST_ASSERT(globalContext->constants.Count() == 2);
+	TEST_ASSERT(globalContext->instructions[0].indexParameter == globalContext->instructions[3].indexParameter);
+
+	WfRuntimeThreadContext context(globalContext);
+	context.PushStackFrame(0, 0);
+	context.ExecuteToEnd();
+
+	Value result;
+	TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
+	TEST_ASSERT(UnboxValue<vint32_t>(result) == 4);
+}
+
+TEST_CASE(TestSuperInstructions)
+{
+	List<Ptr<ParsingError>> errors;
+	List<WString> moduleCodes;
+	moduleCodes.Add(LR"workflow(
+module test;
+
+func main():int
+{
+	var result = 0;
+	var current = 10;
+	while (current > 0)
+	{
+		result = result + current;
+		current = current - 1;
+	}
+	return result;
+}
+)workflow");
+
+	auto table = GetWorkflowTable();
+	auto assembly = Compile(table, moduleCodes, errors);
+	TEST_ASSERT(errors.Count() == 0);
+	TEST_ASSERT(assembly->insBeforeCodegen->instructionCodeMapping.Count() == assembly->instructions.Count());
+	TEST_ASSERT(assembly->insAfterCodegen->instructionCodeMapping.Count() == assembly->instructions.Count());
+
+	auto meta = assembly->functions[assembly->functionByName[L"main"][0]];
+	List<WfInsCode> codes;
+	CopyFrom(codes, From(assembly->instructions)
+		.Skip(meta->firstInstruction)
+		.Take(meta->lastInstruction - meta->firstInstruction + 1)
+		.Select([](const WfInstruction& ins) { return ins.code; }));
+	TEST_ASSERT(codes.Contains(WfInsCode::LoadLocalVar2));
+	TEST_ASSERT(codes.Contains(WfInsCode::IncreaseLocalVar));
+	TEST_ASSERT(codes.Contains(WfInsCode::JumpIfLE));
+	TEST_ASSERT(!codes.Contains(WfInsCode::JumpIf));
+
+	WfRuntimeThreadContext context(assembly);
+	context.PushStackFrame(assembly->functionByName[L"<initialize>"][0], 0);
+	context.ExecuteToEnd();
+	context.PushStackFrame(assembly->functionByName[L"main"][0], 0);
+	context.ExecuteToEnd();
+
+	Value result;
+	TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
+	TEST_ASSERT(result.GetText() == L"55");
+}
+
+TEST_CASE(TestSwitchTable)
+{
+	List<Ptr<ParsingError>> errors;
+	List<WString> moduleCodes;
+	moduleCodes.Add(LR"workflow(
+module test;
+
+func Dense(x : int) : int
+{
+	switch (x)
+	{
+		case 1: { return 10; }
+		case 2: { return 20; }
+		case 3: { return 30; }
+	}
+	return 0;
+}
+
+func Sparse(x : string) : int
+{
+	switch (x)
+	{
+		case "a": { return 1; }
+		case "b": { return 2; }
+		case "c": { return 3; }
+	}
+	return 0;
+}
+
+func main():string
+{
+	return Dense(0) & Dense(2) & Sparse("c") & Sparse("d");
+}
+)workflow");
+
+	auto table = GetWorkflowTable();
+	auto assembly = Compile(table, moduleCodes, errors);
+	TEST_ASSERT(errors.Count() == 0);
+	TEST_ASSERT(assembly->switchTables.Count() == 2);
+	TEST_ASSERT(From(assembly->instructions).Where([](const WfInstruction& ins) { return ins.code == WfInsCode::SwitchTable; }).Count() == 2);
+	{
+		MemoryStream stream;
+		assembly->Serialize(stream);
+		stream.SeekFromBegin(0);
+		assembly = new WfAssembly(stream);
+	}
+	TEST_ASSERT(assembly->switchTables.Count() == 2);
+
+	auto globalContext = MakePtr<WfRuntimeGlobalContext>(assembly);
+	TEST_ASSERT(globalContext->switchTables[0]->denseLabels.Count() == 3);
+	TEST_ASSERT(globalContext->switchTables[1]->stringKeys.Count() == 3);
+
+	WfRuntimeThreadContext context(globalContext);
+	context.PushStackFrame(assembly->functionByName[L"<initialize>"][0], 0);
+	context.ExecuteToEnd();
+	context.PushStackFrame(assembly->functionByName[L"main"][0], 0);
+	context.ExecuteToEnd();
+
+	Value result;
+	TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
+	TEST_ASSERT(result.GetText() == L"02030");
+}
+
+TEST_CASE(TestLambdaInvoke)
+{
+	auto globalContext = InitializeAssembly(CompileModule(LR"workflow(
+module test;
+
+func Add(a : int, b : int) : int
+{
+	return a + b;
+}
+
+func Twice(f : func(int):int, x : int) : int
+{
+	return f(f(x));
+}
+)workflow"));
+	auto add = LoadFunction<vint(vint, vint)>(globalContext, L"Add");
+	auto twice = LoadFunction<vint(Func<vint(vint)>, vint)>(globalContext, L"Twice");
+
+	// a script function calling back into a native function that calls a script function again uses nested thread contexts
+	TEST_ASSERT(twice([&](vint x) { return add(x, 1); }, 1) == 3);
+
+	// finished calls return their contexts to the pool of the current thread, and the next call leases one again instead of creating a context
+	vint idleCount = GetIdleThreadContextCount();
+	TEST_ASSERT(idleCount >= 2);
+	TEST_ASSERT(add(1, 2) == 3);
+	TEST_ASSERT(GetIdleThreadContextCount() == idleCount);
+
+	// a nested call leases another idle context while the outer call keeps its own
+	TEST_ASSERT(twice([&](vint x)
+	{
+		TEST_ASSERT(GetIdleThreadContextCount() == idleCount - 1);
+		vint result = add(x, 1);
+		TEST_ASSERT(GetIdleThreadContextCount() == idleCount - 1);
+		return result;
+	}, 1) == 3);
+	TEST_ASSERT(GetIdleThreadContextCount() == idleCount);
+}
+
+TEST_CASE(TestCallSiteCache)
+{
+	auto globalContext = MakePtr<WfRuntimeGlobalContext>(CompileModule(LR"workflow(
+module test;
+
+func Fill(count : int) : int[]
+{
+	var xs : int[] = {0};
+	for (i in range[1, count))
+	{
+		xs.Add(i);
+	}
+	xs[0] = count;
+	return xs;
+}
+
+func Sum(xs : int[]) : int
+{
+	var sum = 0;
+	for (i in range[0, xs.Count))
+	{
+		sum = sum + xs[i];
+	}
+	return xs.Contains(0) ? -1 : sum;
+}
+)workflow"));
+	TEST_ASSERT(From(globalContext->callSites).Where([](const WfRuntimeCallSite& callSite) { return callSite.thunk != nullptr; }).Count() == 4);
+	TEST_ASSERT(From(globalContext->callSites).All([](const WfRuntimeCallSite& callSite) { return callSite.uncheckedMethod != nullptr; }));
+
+	LoadFunction<void()>(globalContext, L"<initialize>")();
+	auto fill = LoadFunction<Ptr<IValueList>(vint)>(globalContext, L"Fill");
+	auto sum = LoadFunction<vint(Ptr<IValueList>)>(globalContext, L"Sum");
+
+	const vint itemCount = 100;
+	TEST_ASSERT(sum(fill(itemCount)) == (itemCount - 1) * itemCount / 2 + itemCount);
+	TEST_ASSERT(From(globalContext->callSites).All([](const WfRuntimeCallSite& callSite) { return callSite.receiverType.Load() != nullptr; }));
+
+	// a receiver of another type is checked again and cached
+	List<vint> items;
+	items.Add(1);
+	items.Add(2);
+	TEST_ASSERT(sum(new ValueListWrapper<List<vint>*>(&items)) == 3);
+}
+
+TEST_CASE(TestMethodTable)
+{
+	const wchar_t* code = LR"workflow(
+module test;
+using system::*;
+
+func Counter(start : int, step : int) : Enumerable^
+{
+	return new Enumerable^
+	{
+		func CreateEnumerator() : Enumerator^
+		{
+			var current = {(start - step)};
+			var index = {-1};
+			return new Enumerator^
+			{
+				func GetCurrent() : object
+				{
+					return current[0];
+				}
+
+				func GetIndex() : int
+				{
+					return index[0];
+				}
+
+				func Next() : bool
+				{
+					current[0] = current[0] + step;
+					index[0] = index[0] + 1;
+					return true;
+				}
+			};
+		}
+	};
+}
+
+func Sum(xs : Enumerable^, count : int) : int
+{
+	var enumerator = xs.CreateEnumerator();
+	var sum = 0;
+	for (i in range[1, count])
+	{
+		enumerator.Next();
+		var current = enumerator.GetCurrent();
+		sum = sum + cast int current;
+	}
+	return sum;
+}
+)workflow";
+	auto assembly = CompileModule(code);
+	TEST_ASSERT(assembly->methodTables.Count() == 2);
+	TEST_ASSERT(assembly->methodTables[1]->methods.Count() == 3);
+
+	auto globalContext = InitializeAssembly(assembly);
+	auto counter = LoadFunction<Ptr<IValueEnumerable>(vint, vint)>(globalContext, L"Counter");
+	auto sum = LoadFunction<vint(Ptr<IValueEnumerable>, vint)>(globalContext, L"Sum");
+
+	// methods called from C++ are found by name in the shared method table
+	auto enumerator = counter(1, 2)->CreateEnumerator();
+	TEST_ASSERT(enumerator->Next());
+	TEST_ASSERT(enumerator->Next());
+	TEST_ASSERT(UnboxValue<vint>(enumerator->GetCurrent()) == 3);
+	TEST_ASSERT(enumerator->GetIndex() == 1);
+
+	// methods called from the script run in the same thread context
+	const vint itemCount = 100;
+	TEST_ASSERT(sum(counter(1, 2), itemCount) == itemCount * itemCount);
+
+	// methods share captured variables without changing the captures found by the analyzer
+	List<WString> moduleCodes;
+	moduleCodes.Add(code);
+	List<Ptr<ParsingError>> errors;
+	WfLexicalScopeManager manager(GetWorkflowTable());
+	for (vint i = 0; i < 2; i++)
+	{
+		assembly = Compile(GetWorkflowTable(), &manager, moduleCodes, errors);
+		TEST_ASSERT(errors.Count() == 0);
+		vint checkedCount = 0;
+		FOREACH_INDEXER(WfFunctionDeclaration*, decl, index, manager.functionLambdaCaptures.Keys())
+		{
+			vint count = manager.functionLambdaCaptures.GetByIndex(index).Count();
+			if (decl->name.value == L"GetCurrent")
+			{
+				TEST_ASSERT(count == 1);
+				checkedCount++;
+			}
+			else if (decl->name.value == L"Next")
+			{
+				TEST_ASSERT(count == 3);
+				checkedCount++;
+			}
+		}
+		FOREACH(Ptr<WfAssemblyFunction>, function, assembly->functions)
+		{
+			if (INVLOC.StartsWith(function->name, L"<method:GetCurrent<", Locale::None))
+			{
+				TEST_ASSERT(function->capturedVariableNames.Count() == 3);
+				checkedCount++;
+			}
+		}
+		TEST_ASSERT(checkedCount == 3);
+	}
+}
+
+TEST_CASE(TestTailInvoke)
+{
+	auto assembly = CompileModule(LR"workflow(
+module test;
+
+func SumTo(n : int, sum : int) : int
+{
+	if (n == 0)
+	{
+		return sum;
+	}
+	return SumTo(n - 1, sum + n);
+}
+
+func IsEven(n : int) : bool
+{
+	if (n == 0)
+	{
+		return true;
+	}
+	return IsOdd(n - 1);
+}
+
+func IsOdd(n : int) : bool
+{
+	if (n == 0)
+	{
+		return false;
+	}
+	return IsEven(n - 1);
+}
+)workflow");
+	TEST_ASSERT(From(assembly->instructions).Where([](const WfInstruction& ins) { return ins.code == WfInsCode::TailInvoke; }).Count() == 3);
+
+	// recursion in tail position runs in a single stack frame
+	const vint depth = 10000;
+	WfRuntimeThreadContext context(assembly);
+	context.PushValue(BoxValue<vint>(depth));
+	context.PushValue(BoxValue<vint>(0));
+	context.PushStackFrame(assembly->functionByName[L"SumTo"][0], 2);
+	context.ExecuteToEnd();
+
+	Value result;
+	TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
+	TEST_ASSERT(UnboxValue<vint>(result) == depth * (depth + 1) / 2);
+	TEST_ASSERT(context.reservedStackSize < 16);
+
+	context.PushValue(BoxValue<vint>(depth + 1));
+	context.PushStackFrame(assembly->functionByName[L"IsEven"][0], 1);
+	context.ExecuteToEnd();
+	TEST_ASSERT(context.PopValue(result) == WfRuntimeThreadContextError::Success);
+	TEST_ASSERT(UnboxValue<bool>(result) == false);
+	TEST_ASSERT(context.reservedStackSize < 16);
+}
+
+TEST_CASE(TestLocalClosure)
+{
+	auto assembly = CompileModule(LR"workflow(
+module test;
+
+func Apply(f : func(int):int, x : int) : int
+{
+	return f(x);
+}
+
+func Sum(count : int, step : int) : int
+{
+	var add : func(int, int):int = [$1 + $2 * step];
+	var sum = 0;
+	for (i in range[1, count])
+	{
+		sum = add(sum, i);
+	}
+	return sum;
+}
+
+func Escape(x : int) : int
+{
+	var add : func(int):int = [$1 + x];
+	return Apply(add, 1);
+}
+)workflow");
+
+	// a closure that is only called is generated as a function taking captured values as arguments
+	TEST_ASSERT(From(assembly->instructions).Where([](const WfInstruction& ins) { return ins.code == WfInsCode::LoadClosure; }).Count() == 1);
+
+	auto globalContext = InitializeAssembly(assembly);
+	TEST_ASSERT(LoadFunction<vint(vint)>(globalContext, L"Escape")(2) == 3);
+	TEST_ASSERT(LoadFunction<vint(vint, vint)>(globalContext, L"Sum")(100, 2) == 100 * 101);
+}
+
+TEST_CASE(TestInlineFunction)
+{
+	WfCodegenOptions options;
+	options.optimizeInstructions = true;
+	options.inlineFunctions = true;
+	auto assembly = CompileModule(LR"workflow(
+module test;
+
+func Square(x : int) : int
+{
+	return x * x;
+}
+
+func IsOdd(x : int) : bool
+{
+	return x % 2 == 1;
+}
+
+func Factorial(n : int) : int
+{
+	return n <= 1 ? 1 : n * Factorial(n - 1);
+}
+
+func SumOddSquares(count : int) : int
+{
+	var sum = 0;
+	for (i in range[1, count])
+	{
+		if (IsOdd(i))
+		{
+			sum = sum + Square(i);
+		}
+	}
+	return sum + Factorial(3);
+}
+)workflow", options);
+
+	// only the recursive function is still called
+	auto meta = assembly->functions[assembly->functionByName[L"SumOddSquares"][0]];
+	vint invokeCount = 0;
+	for (vint i = meta->firstInstruction; i <= meta->lastInstruction; i++)
+	{
+		if (assembly->instructions[i].code == WfInsCode::Invoke)
+		{
+			TEST_ASSERT(assembly->instructions[i].indexParameter == assembly->functionByName[L"Factorial"][0]);
+			invokeCount++;
+		}
+	}
+	TEST_ASSERT(invokeCount == 1);
+
+	auto globalContext = InitializeAssembly(assembly);
+	TEST_ASSERT(LoadFunction<vint(vint)>(globalContext, L"Factorial")(5) == 120);
+
+	// 1 + 9 + ... + 99 * 99 + 3!
+	const vint count = 100;
+	TEST_ASSERT(LoadFunction<vint(vint)>(globalContext, L"SumOddSquares")(count) == (count / 2) * (4 * (count / 2) * (count / 2) - 1) / 3 + 6);
+}
+
+TEST_CASE(TestConstantSet)
+{
+	// 500 different keys in [0, 1009)
+	WString ids;
+	for (vint i = 0; i < 500; i++)
+	{
+		ids += L" " + itow(i * 7 % 1009);
+	}
+
+	auto assembly = CompileModule(LR"workflow(
+module test;
+
+func CountAllowed(count : int) : int
+{
+	var allowed = 0;
+	for (i in range[0, count - 1])
+	{
+		if (i in {)workflow" + ids + LR"workflow(})
+		{
+			allowed = allowed + 1;
+		}
+	}
+	return allowed;
+}
+)workflow");
+	TEST_ASSERT(assembly->constantSets.Count() == 1);
+	TEST_ASSERT(From(assembly->instructions).Where([](const WfInstruction& ins) { return ins.code == WfInsCode::CreateArray; }).Count() == 0);
+	{
+		MemoryStream stream;
+		assembly->Serialize(stream);
+		stream.SeekFromBegin(0);
+		assembly = new WfAssembly(stream);
+	}
+	TEST_ASSERT(assembly->constantSets.Count() == 1);
+	TEST_ASSERT(assembly->constantSets[0]->keys.Count() == 500);
+
+	// sparse keys are hashed
+	auto globalContext = InitializeAssembly(assembly);
+	TEST_ASSERT(globalContext->constantSets[0]->integerKeys.Count() == 500);
+	TEST_ASSERT(LoadFunction<vint(vint)>(globalContext, L"CountAllowed")(1009) == 500);
+}
+
+TEST_CASE(TestElementInList)
+{
+	auto assembly = CompileModule(LR"workflow(
+module test;
+
+func Contains(xs : object{}, x : object) : bool
+{
+	return x in xs;
+}
+)workflow");
+	auto contains = LoadFunction<bool(Ptr<IValueEnumerable>, Value)>(InitializeAssembly(assembly), L"Contains");
+
+	// a typed list is only searched by Contains for an element of the same type
+	List<vint> items;
+	items.Add(1);
+	items.Add(2);
+	Ptr<IValueEnumerable> xs = new ValueListWrapper<List<vint>*>(&items);
+	TEST_ASSERT(contains(xs, BoxValue<vint>(2)));
+	TEST_ASSERT(!contains(xs, BoxValue<vint>(3)));
+	TEST_ASSERT(!contains(xs, BoxValue<WString>(L"two")));
+	TEST_ASSERT(!contains(xs, Value()));
+}
+
+TEST_CASE(TestHashMap)
+{
+	const wchar_t* code = LR"workflow(
+module test;
+using system::*;
+
+func Process(count : int) : string
+{
+	var xs = {"a":1 "b":2 "c":3 "d":4 "e":5};
+	for (i in range[1, count])
+	{
+		xs.Set("key" & i, i);
+	}
+	var sum = 0;
+	for (i in range[1, count])
+	{
+		sum = sum + xs["key" & i];
+	}
+	xs["e"] = 6;
+	var removed = xs.Remove("a");
+	var keys = xs.Keys;
+	return xs.Count & ", " & sum & ", " & xs["e"] & ", " & removed & ("key1" in keys) & ("a" in keys);
+}
+)workflow";
+
+	for (vint i = 0; i < 2; i++)
+	{
+		WfCodegenOptions options;
+		options.hashMaps = i == 1;
+		auto assembly = CompileModule(code, options);
+		TEST_ASSERT(From(assembly->instructions).Any([&](const WfInstruction& ins) { return ins.code == (options.hashMaps ? WfInsCode::CreateHashMap : WfInsCode::CreateMap); }));
+
+		auto globalContext = InitializeAssembly(assembly);
+		TEST_ASSERT(LoadFunction<WString(vint)>(globalContext, L"Process")(100) == L"104, 5050, 6, truetruefalse");
+	}
+
+	auto map = MakePtr<WfRuntimeHashMap>();
+	map->Set(BoxValue<vint>(2), BoxValue<WString>(L"two"));
+	map->Set(BoxValue<vint>(1), BoxValue<WString>(L"one"));
+	map->Set(BoxValue<vint>(2), BoxValue<WString>(L"TWO"));
+	TEST_ASSERT(map->GetCount() == 2);
+	TEST_ASSERT(UnboxValue<vint>(map->GetKeys()->Get(0)) == 2);
+	TEST_ASSERT(UnboxValue<WString>(map->Get(BoxValue<vint>(2))) == L"TWO");
+	TEST_ASSERT(map->Remove(BoxValue<vint>(2)));
+	TEST_ASSERT(!map->GetKeys()->Contains(BoxValue<vint>(2)));
+	TEST_ASSERT(UnboxValue<WString>(map->Get(BoxValue<vint>(1))) == L"one");
+
+	// removed keys are compacted without changing the order of other keys
+	for (vint i = 3; i <= 100; i++)
+	{
+		map->Set(BoxValue<vint>(i), BoxValue<vint>(i));
+	}
+	for (vint i = 3; i <= 100; i += 2)
+	{
+		TEST_ASSERT(map->Remove(BoxValue<vint>(i)));
+	}
+	TEST_ASSERT(map->GetCount() == 50);
+	TEST_ASSERT(!map->GetKeys()->Contains(BoxValue<vint>(99)));
+	TEST_ASSERT(UnboxValue<vint>(map->Get(BoxValue<vint>(100))) == 100);
+	TEST_ASSERT(map->GetKeys()->GetCount() == 50);
+	TEST_ASSERT(UnboxValue<vint>(map->GetKeys()->Get(1)) == 4);
+	TEST_ASSERT(UnboxValue<vint>(map->GetValues()->Get(49)) == 100);
+}
+
+TEST_CASE(TestAssemblySymbolTables)
+{
+	List<Ptr<ParsingError>> errors;
+	List<WString> moduleCodes;
+	moduleCodes.Add(LR"workflow(
+module test;
+using system::*;
+
+func Main() : string
+{
+	var xs : int[] = {1 2};
+	xs.Add(3);
+	return "symbol" & xs.Count & "symbol" & xs[1] & "symbol" & 1.5 & true;
+}
+)workflow");
+
+	auto table = GetWorkflowTable();
+	auto assembly = Compile(table, moduleCodes, errors);
+	TEST_ASSERT(errors.Count() == 0);
+
+	MemoryStream stream;
+	assembly->Serialize(stream);
+	{
+		stream.SeekFromBegin(0);
+		Ptr<WfAssembly> loaded = new WfAssembly(stream);
+		TEST_ASSERT(loaded->verified);
+		TEST_ASSERT(loaded->instructions.Count() == assembly->instructions.Count());
+
+		auto globalContext = MakePtr<WfRuntimeGlobalContext>(loaded);
+		LoadFunction<void()>(globalContext, L"<initialize>")();
+		TEST_ASSERT(LoadFunction<WString()>(globalContext, L"Main")() == L"symbol3symbol2symbol1.5true");
+	}
+
+	// assemblies in another binary version are rejected
+	vint32_t version = WfAssembly::BinaryVersion + 1;
+	stream.SeekFromBegin(sizeof(vint32_t));
+	stream.Write(&version, sizeof(version));
+	stream.SeekFromBegin(0);
+	bool rejected = false;
+	try
+	{
+		Ptr<WfAssembly> loaded = new WfAssembly(stream);
+	}
+	catch (const Error&)
+	{
+		rejected = true;
+	}
+	TEST_ASSERT(rejected);
+
+	// symbol indexes in corrupted assemblies are checked
+	auto loadCorrupted = [](vint typeName, vint valueType)
+	{
+		MemoryStream corrupted;
+		{
+			stream::internal::Writer writer(corrupted);
+			vint32_t magic = 0x53414657, version = WfAssembly::BinaryVersion, instructionCount = 1, code = (vint32_t)WfInsCode::LoadValue, tag = -3;
+			List<WString> strings, variableNames;
+			strings.Add(L"system::Int32");
+			strings.Add(L"1");
+			List<vint> typeNames, emptyList;
+			typeNames.Add(typeName);
+			Group<WString, vint> functionByName;
+			vint text = 1;
+			MemoryStream debugInfo;
+			stream::IStream& debugInfoStream = debugInfo;
+			writer
+				<< magic << version << strings << typeNames << emptyList << emptyList << emptyList
+				<< variableNames << functionByName << emptyList << instructionCount << code << tag << valueType << text
+				<< emptyList << emptyList << emptyList << debugInfoStream;
+		}
+		corrupted.SeekFromBegin(0);
+		try
+		{
+			Ptr<WfAssembly> loaded = new WfAssembly(corrupted);
+			return UnboxValue<vint32_t>(loaded->instructions[0].valueParameter) == 1;
+		}
+		catch (const Error&)
+		{
+			return false;
+		}
+	};
+	TEST_ASSERT(loadCorrupted(0, 0));
+	TEST_ASSERT(!loadCorrupted(2, 0));
+	TEST_ASSERT(!loadCorrupted(0, 1));
+	TEST_ASSERT(!loadCorrupted(0, -1));
+}
+
+TEST_CASE(TestAssemblyImage)
+{
+	List<Ptr<ParsingError>> errors;
+	List<WString> moduleCodes;
+	moduleCodes.Add(LR"workflow(
+module test;
+using system::*;
+
+var counter = 0;
+
+func Main(text : string) : string
+{
+	var xs : int[] = {1 2};
+	xs.Add(counter + 3);
+	counter = counter + 1;
+	var o : object = xs;
+	var isList = false;
+	if (var ys : int[] = o)
+	{
+		isList = true;
+	}
+	return counter & ", " & xs.Count & ", " & xs[2] & ", " & isList & ", <" & text;
+}
+
+func GetX(point : test::Point) : int
+{
+	return point.x;
+}
+
+func Numbers() : Enumerable^
+{
+	return new Enumerable^
+	{
+		func CreateEnumerator() : Enumerator^
+		{
+			var xs : int[] = {1 2};
+			return xs.CreateEnumerator();
+		}
+	};
+}
+)workflow");
+
+	auto table = GetWorkflowTable();
+	auto assembly = Compile(table, moduleCodes, errors);
+	TEST_ASSERT(errors.Count() == 0);
+
+	MemoryStream stream;
+	{
+		WfRuntimeGlobalContext context(assembly);
+		WfAssemblyImage::Write(&context, stream);
+	}
+
+	auto buffer = (const char*)stream.GetInternalBuffer();
+	Ptr<WfAssemblyImage> image = new WfAssemblyImage(buffer, (vint)stream.Size());
+	TEST_ASSERT(image->instructionCount == assembly->instructions.Count());
+	TEST_ASSERT(image->assembly->instructions.Count() == assembly->instructions.Count());
+	TEST_ASSERT(image->assembly->verified);
+	TEST_ASSERT(!image->assembly->insBeforeCodegen);
+	TEST_ASSERT(image->assembly->GetDebugInfo(true)->moduleCodes.Count() == 1);
+
+	// instructions are used in place by all global contexts, global variables are not shared
+	for (vint i = 0; i < 2; i++)
+	{
+		auto globalContext = MakePtr<WfRuntimeGlobalContext>(image);
+		TEST_ASSERT((const char*)&globalContext->instructions[0] >= buffer);
+		TEST_ASSERT((const char*)&globalContext->instructions[0] < buffer + stream.Size());
+
+		LoadFunction<void()>(globalContext, L"<initialize>")();
+		auto main = LoadFunction<WString(WString)>(globalContext, L"Main");
+		TEST_ASSERT(main(L"abcd") == L"1, 3, 3, true, <abcd");
+		TEST_ASSERT(main(L"xy") == L"2, 3, 4, true, <xy");
+	}
+
+	// images that are not packed from verified instructions are rejected
+	auto loadTampered = [&](vint offset, vint value)
+	{
+		Array<vint64_t> copied((stream.Size() + sizeof(vint64_t) - 1) / sizeof(vint64_t));
+		memcpy(&copied[0], buffer, (size_t)stream.Size());
+		*(vint32_t*)((char*)&copied[0] + offset) = (vint32_t)value;
+		try
+		{
+			Ptr<WfAssemblyImage> tampered = new WfAssemblyImage(&copied[0], (vint)stream.Size());
+		}
+		catch (const Error&)
+		{
+			return false;
+		}
+		return true;
+	};
+
+	auto findInstruction = [&](WfInsCode code)
+	{
+		for (vint i = 0; i < image->instructionCount; i++)
+		{
+			if (image->instructions[i].code == code)
+			{
+				return &image->instructions[i];
+			}
+		}
+		TEST_ASSERT(false);
+		return (const WfRuntimeInstruction*)nullptr;
+	};
+	auto getOffset = [&](const void* field)
+	{
+		return (vint)((const char*)field - buffer);
+	};
+
+	auto loadValue = findInstruction(WfInsCode::LoadValue);
+	TEST_ASSERT(loadTampered(getOffset(&loadValue->indexParameter), loadValue->indexParameter));
+	TEST_ASSERT(!loadTampered(getOffset(&loadValue->indexParameter), image->constants.Count()));
+	TEST_ASSERT(!loadTampered(getOffset(&image->functions[0].maxStackDepth), image->functions[0].maxStackDepth - 1));
+
+	// call sites must be used by instructions of the same kind
+	auto getProperty = findInstruction(WfInsCode::GetProperty);
+	auto invokeMethod = findInstruction(WfInsCode::InvokeMethod);
+	TEST_ASSERT(!loadTampered(getOffset(&invokeMethod->indexParameter), getProperty->indexParameter));
+	TEST_ASSERT(!loadTampered(getOffset(&getProperty->indexParameter), invokeMethod->indexParameter));
+
+	auto createInterface = findInstruction(WfInsCode::CreateInterface);
+	TEST_ASSERT(!loadTampered(getOffset(&createInterface->indexParameter), image->assembly->methodTables.Count()));
+}
+
+TEST_CASE(TestLazyDebugInfo)
+{
+	List<Ptr<ParsingError>> errors;
+	List<WString> moduleCodes;
+	moduleCodes.Add(LR"workflow(
+module test;
+
+func Main() : int
+{
+	var sum = 0;
+	for (i in range[1, 10])
+	{
+		sum = sum + i;
+	}
+	return sum;
+}
+)workflow");
+
+	auto table = GetWorkflowTable();
+	auto assembly = Compile(table, moduleCodes, errors);
+	TEST_ASSERT(errors.Count() == 0);
+
+	MemoryStream withDebugInfo, withoutDebugInfo, sideFile;
+	assembly->Serialize(withDebugInfo);
+	assembly->Serialize(withoutDebugInfo, false);
+	assembly->SerializeDebugInfo(sideFile);
+	TEST_ASSERT(withoutDebugInfo.Size() + sideFile.Size() <= withDebugInfo.Size());
+
+	// debug informations are deserialized on first use
+	withDebugInfo.SeekFromBegin(0);
+	Ptr<WfAssembly> loaded = new WfAssembly(withDebugInfo);
+	TEST_ASSERT(!loaded->insBeforeCodegen && !loaded->insAfterCodegen);
+	auto debugInfo = loaded->GetDebugInfo(true);
+	TEST_ASSERT(debugInfo && loaded->insAfterCodegen);
+	TEST_ASSERT(debugInfo->moduleCodes[0] == assembly->insBeforeCodegen->moduleCodes[0]);
+	TEST_ASSERT(debugInfo->instructionCodeMapping.Count() == loaded->instructions.Count());
+	TEST_ASSERT(debugInfo->codeInstructionMapping.Count() == assembly->insBeforeCodegen->codeInstructionMapping.Count());
+
+	// debug informations could be stripped or loaded from a side file
+	withoutDebugInfo.SeekFromBegin(0);
+	loaded = new WfAssembly(withoutDebugInfo);
+	TEST_ASSERT(!loaded->GetDebugInfo(false));
+	{
+		auto globalContext = MakePtr<WfRuntimeGlobalContext>(loaded);
+		LoadFunction<void()>(globalContext, L"<initialize>")();
+		TEST_ASSERT(LoadFunction<vint()>(globalContext, L"Main")() == 55);
+	}
+
+	sideFile.SeekFromBegin(0);
+	loaded->AttachDebugInfo(sideFile);
+	TEST_ASSERT(!loaded->insAfterCodegen);
+	TEST_ASSERT(loaded->GetDebugInfo(false)->moduleCodes[0] == assembly->insAfterCodegen->moduleCodes[0]);
+	loaded->StripDebugInfo();
+	TEST_ASSERT(!loaded->GetDebugInfo(true));
+
+	// debug informations in an incompatible version are ignored
+	{
+		MemoryStream incompatible;
+		vint32_t header[] = { 0x42444657, WfAssembly::BinaryVersion + 1 };
+		incompatible.Write(header, sizeof(header));
+		incompatible.SeekFromBegin(0);
+		loaded->AttachDebugInfo(incompatible);
+		TEST_ASSERT(!loaded->GetDebugInfo(true));
+		TEST_ASSERT(!loaded->GetDebugInfo(false));
+	}
+
+	// debug informations are deserialized only once when threads that report exceptions load them at the same time
+	withDebugInfo.SeekFromBegin(0);
+	loaded = new WfAssembly(withDebugInfo);
+	Ptr<WfInstructionDebugInfo> loadedDebugInfos[4];
+	Ptr<Thread> threads[4];
+	for (vint i = 0; i < 4; i++)
+	{
+		threads[i] = Thread::CreateAndStart([&, i]()
+		{
+			loadedDebugInfos[i] = loaded->GetDebugInfo(true);
+		}, false);
+	}
+	for (vint i = 0; i < 4; i++)
+	{
+		threads[i]->Wait();
+		TEST_ASSERT(loadedDebugInfos[i] && loadedDebugInfos[i] == loadedDebugInfos[0]);
+	}
+}
+
+TEST_CASE(TestDebugInfoOptions)
+{
+	List<Ptr<ParsingError>> errors;
+	List<WString> moduleCodes;
+	moduleCodes.Add(LR"workflow(
+module test;
+
+func Main() : int
+{
+	var sum = 0;
+	for (i in range[1, 10])
+	{
+		if (i % 2 == 0)
+		{
+			continue;
+		}
+		sum = sum + i;
+	}
+	return sum;
+}
+)workflow");
+
+	auto table = GetWorkflowTable();
+	WfCodegenOptions options;
+	options.optimizeInstructions = true;
+	auto assembly = Compile(table, moduleCodes, errors, options);
+	TEST_ASSERT(errors.Count() == 0);
+
+	// generated syntax trees are not printed, positions before codegen are the same
+	options.debugInfoAfterCodegen = false;
+	options.embedModuleCodes = false;
+	auto stripped = Compile(table, moduleCodes, errors, options);
+	TEST_ASSERT(errors.Count() == 0);
+	TEST_ASSERT(!stripped->insAfterCodegen);
+	TEST_ASSERT(stripped->insBeforeCodegen->moduleCodes.Count() == 1);
+	TEST_ASSERT(stripped->insBeforeCodegen->moduleCodes[0] == L"");
+
+	auto& expected = assembly->insBeforeCodegen->instructionCodeMapping;
+	auto& actual = stripped->insBeforeCodegen->instructionCodeMapping;
+	TEST_ASSERT(stripped->instructions.Count() == assembly->instructions.Count());
+	TEST_ASSERT(actual.Count() == stripped->instructions.Count());
+	for (vint i = 0; i < actual.Count(); i++)
+	{
+		TEST_ASSERT(actual[i].codeIndex == expected[i].codeIndex);
+		TEST_ASSERT(actual[i].start == expected[i].start);
+		TEST_ASSERT(actual[i].end == expected[i].end);
+	}
+
+	auto globalContext = MakePtr<WfRuntimeGlobalContext>(stripped);
+	LoadFunction<void()>(globalContext, L"<initialize>")();
+	TEST_ASSERT(LoadFunction<vint()>(globalContext, L"Main")() == 25);
+}
+
+TEST_CASE(TestAssemblyCache)
+{
+	List<Ptr<ParsingError>> errors;
+	List<WString> moduleCodes;
+	moduleCodes.Add(LR"workflow(
+module test;
+
+func Main() : int
+{
+	var sum = 0;
+	for (i in range[1, 100])
+	{
+		sum = sum + i;
+	}
+	return sum;
+}
+)workflow");
+
+	auto table = GetWorkflowTable();
+	WfAssemblyCache cache(GetTestOutputPath());
+	auto filePath = GetTestOutputPath() + u64tow(cache.GetKey(moduleCodes, WfCodegenOptions())) + L".wfasm";
+
+	auto run = [&](Ptr<WfAssembly> assembly)
+	{
+		return LoadFunction<vint()>(InitializeAssembly(assembly), L"Main")();
+	};
+
+	// a broken file is compiled again and replaced, the next compiling loads the assembly
+	{
+		FileStream fileStream(filePath, FileStream::WriteOnly);
+		char garbage[] = "garbage";
+		fileStream.Write(garbage, sizeof(garbage));
+	}
+	for (vint i = 0; i < 2; i++)
+	{
+		auto assembly = cache.Compile(table, moduleCodes, errors);
+		TEST_ASSERT(errors.Count() == 0);
+		TEST_ASSERT(run(assembly) == 5050);
+
+		// debug informations of deserialized assemblies are loaded on first use
+		TEST_ASSERT((i == 0) == (bool)assembly->insBeforeCodegen);
+	}
+
+	// different options or codes use different keys
+	WfCodegenOptions options;
+	options.optimizeInstructions = true;
+	auto key = cache.GetKey(moduleCodes, WfCodegenOptions());
+	TEST_ASSERT(cache.GetKey(moduleCodes, options) != key);
+	moduleCodes[0] = moduleCodes[0] + L" ";
+	TEST_ASSERT(cache.GetKey(moduleCodes, WfCodegenOptions()) != key);
+	moduleCodes[0] = moduleCodes[0].Left(moduleCodes[0].Length() - 1);
+	TEST_ASSERT(cache.GetKey(moduleCodes, WfCodegenOptions()) == key);
+
+	// loading different types uses different keys
+	auto fingerprint = GetReflectionFingerprint();
+	UnloadTypes();
+	LoadPredefinedTypes();
+	TEST_ASSERT(GetGlobalTypeManager()->Load());
+	TEST_ASSERT(GetReflectionFingerprint() != fingerprint);
+	TEST_ASSERT(WfAssemblyCache(GetTestOutputPath()).GetKey(moduleCodes, WfCodegenOptions()) != key);
+	UnloadTypes();
+	LoadTypes();
+	TEST_ASSERT(GetReflectionFingerprint() == fingerprint);
+	TEST_ASSERT(WfAssemblyCache(GetTestOutputPath()).GetKey(moduleCodes, WfCodegenOptions()) == key);
+
+#if defined VCZH_MSVC
+	TEST_ASSERT(_wremove(filePath.Buffer()) == 0);
+#elif defined VCZH_GCC
+	TEST_ASSERT(remove(wtoa(filePath).Buffer()) == 0);
+#endif
+}
@@ -676,11 +676,11 @@ namespace debugger_internal
 			TEST_ASSERT(callStack->GetFunctionName() == L"Update");
 			TEST_ASSERT(callStack->GetRowBeforeCodegen() == 8);
 			TEST_ASSERT(callStack->global->variables.Count() == 1);
-			TEST_ASSERT(UnboxValue<vint>(callStack->global->variables[callStack->assembly->variableNames.IndexOf(L"s")]) == 0);
+			TEST_ASSERT(UnboxValue<vint>(callStack->global->variables[callStack->assembly->variableNames.IndexOf(L"s")].ToValue()) == 0);
 			TEST_ASSERT(callStack->captured == nullptr);
 			TEST_ASSERT(callStack->arguments->variables.Count() == 2);
-			TEST_ASSERT(UnboxValue<vint>(callStack->arguments->variables[function->argumentNames.IndexOf(L"a")]) == 0);
-			TEST_ASSERT(UnboxValue<vint>(callStack->arguments->variables[function->argumentNames.IndexOf(L"b")]) == 1);
+			TEST_ASSERT(UnboxValue<vint>(callStack->arguments->variables[function->argumentNames.IndexOf(L"a")].ToValue()) == 0);
+			TEST_ASSERT(UnboxValue<vint>(callStack->arguments->variables[function->argumentNames.IndexOf(L"b")].ToValue()) == 1);
 			TEST_ASSERT(callStack->localVariables == nullptr);
 		}
 		{
@@ -693,11 +693,11 @@ namespace debugger_internal
 			TEST_ASSERT(callStack->GetFunctionName() == (uncatch ? L"Main" : L"Main2"));
 			TEST_ASSERT(callStack->GetRowBeforeCodegen() == (uncatch ? 15 : 25));
 			TEST_ASSERT(callStack->global->variables.Count() == 1);
-			TEST_ASSERT(UnboxValue<vint>(callStack->global->variables[callStack->assembly->variableNames.IndexOf(L"s")]) == 0);
+			TEST_ASSERT(UnboxValue<vint>(callStack->global->variables[callStack->assembly->variableNames.IndexOf(L"s")].ToValue()) == 0);
 			TEST_ASSERT(callStack->captured == nullptr);
 			TEST_ASSERT(callStack->arguments == nullptr);
 			TEST_ASSERT(callStack->localVariables->variables.Count() == (uncatch ? 1 : 2));
-			TEST_ASSERT(callStack->localVariables->variables[function->localVariableNames.IndexOf(L"o")].GetTypeDescriptor()->GetTypeName() == L"test::ObservableValue");
+			TEST_ASSERT(callStack->localVariables->variables[function->localVariableNames.IndexOf(L"o")].ToValue().GetTypeDescriptor()->GetTypeName() == L"test::ObservableValue");
 			if (!uncatch)
 			{
 				TEST_ASSERT(callStack->localVariables->variables[function->localVariableNames.IndexOf(L"<catch>ex")].IsNull());
@@ -20,9 +20,14 @@ using namespace vl::reflection::description;
 extern Ptr<ParsingTable>	GetWorkflowTable();
 extern WString				GetTestResourcePath();
 extern WString				GetTestOutputPath();
+extern bool					IsBenchmarkEnabled();
+extern void					LoadTypes();
+extern void					UnloadTypes();
 extern void					LoadSampleIndex(const WString& sampleName, List<WString>& itemNames);
 extern WString				LoadSample(const WString& sampleName, const WString& itemName);
 extern void					LogSampleParseResult(const WString& sampleName, const WString& itemName, const WString& sample, Ptr<ParsingTreeNode> node, WfLexicalScopeManager* manager = 0);
 extern void					LogSampleCodegenResult(const WString& sampleName, const WString& itemName, Ptr<WfAssembly> assembly);
+extern Ptr<WfAssembly>		CompileModule(const WString& code, const WfCodegenOptions& options = WfCodegenOptions());
+extern Ptr<WfRuntimeGlobalContext>	InitializeAssembly(Ptr<WfAssembly> assembly);
 
 #endif
\ No newline at end of file
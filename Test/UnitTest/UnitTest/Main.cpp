@@ -9,6 +9,7 @@ using namespace vl::filesystem;
 #endif
 
 Ptr<ParsingTable> workflowTable;
+bool benchmarkEnabled = false;
 
 #define BEGIN_TIMER\
 		DateTime beginTime = DateTime::LocalTime();\
@@ -82,6 +83,11 @@ WString GetTestResourcePath()
 #endif
 }
 
+bool IsBenchmarkEnabled()
+{
+	return benchmarkEnabled;
+}
+
 WString GetTestOutputPath()
 {
 #if defined VCZH_MSVC
@@ -121,6 +127,23 @@ WString LoadSample(const WString& sampleName, const WString& itemName)
 	return reader.ReadToEnd();
 }
 
+Ptr<WfAssembly> CompileModule(const WString& code, const WfCodegenOptions& options)
+{
+	List<Ptr<ParsingError>> errors;
+	List<WString> moduleCodes;
+	moduleCodes.Add(code);
+	auto assembly = Compile(GetWorkflowTable(), moduleCodes, errors, options);
+	TEST_ASSERT(errors.Count() == 0);
+	return assembly;
+}
+
+Ptr<WfRuntimeGlobalContext> InitializeAssembly(Ptr<WfAssembly> assembly)
+{
+	auto globalContext = MakePtr<WfRuntimeGlobalContext>(assembly);
+	LoadFunction<void()>(globalContext, L"<initialize>")();
+	return globalContext;
+}
+
 void LogSampleParseResult(const WString& sampleName, const WString& itemName, const WString& sample, Ptr<ParsingTreeNode> node, WfLexicalScopeManager* manager)
 {
 	FileStream fileStream(GetTestOutputPath() + L"Parsing." + sampleName + L"." + itemName + L".txt", FileStream::WriteOnly);
@@ -242,7 +265,7 @@ void LogSampleCodegenResult(const WString& sampleName, const WString& itemName,
 		case WfInsType::F8:
 			return L"F8";
 		case WfInsType::String:
-			return L"Bool";
+			return L"String";
 		default:
 			return L"Unknown";
 		}
@@ -257,15 +280,47 @@ void LogSampleCodegenResult(const WString& sampleName, const WString& itemName,
 			L">";
 	};
 
-	auto formatVarName = [assembly](const WfInstruction& ins, vint index)->WString
+	auto formatTable = [&formatType](Ptr<WfSwitchTable> table)->WString
+	{
+		WString result = L", type = " + formatType(table->type) + L", labels = {";
+		FOREACH_INDEXER(Value, key, index, table->keys)
+		{
+			result += (index == 0 ? L"" : L", ") + key.GetText() + L":" + itow(table->labels[index]);
+		}
+		return result + L"}";
+	};
+
+	auto formatMethodTable = [](Ptr<WfMethodTable> table)->WString
+	{
+		WString result = L", methods = {";
+		FOREACH_INDEXER(IMethodInfo*, method, index, table->methods)
+		{
+			result += (index == 0 ? L"" : L", ") + method->GetName() + L":" + itow(table->functions[index]);
+		}
+		return result + L"}";
+	};
+
+	auto formatConstantSet = [&formatType](Ptr<WfConstantSet> set)->WString
+	{
+		WString result = L", type = " + formatType(set->type) + L", keys = {";
+		FOREACH_INDEXER(Value, key, index, set->keys)
+		{
+			result += (index == 0 ? L"" : L", ") + key.GetText();
+		}
+		return result + L"}";
+	};
+
+	auto formatVarName = [assembly](const WfInstruction& ins, vint index, vint variable)->WString
 	{
 		switch (ins.code)
 		{
 		case WfInsCode::LoadGlobalVar:
 		case WfInsCode::StoreGlobalVar:
-			return L"(" + assembly->variableNames[ins.indexParameter] + L")";
+			return L"(" + assembly->variableNames[variable] + L")";
 		case WfInsCode::LoadLocalVar:
 		case WfInsCode::StoreLocalVar:
+		case WfInsCode::LoadLocalVar2:
+		case WfInsCode::IncreaseLocalVar:
 			{
 				auto function=From(assembly->functions)
 					.Where([&ins,index](Ptr<WfAssemblyFunction> function)
@@ -273,13 +328,13 @@ void LogSampleCodegenResult(const WString& sampleName, const WString& itemName,
 						return function->firstInstruction <= index && index <= function->lastInstruction;
 					})
 					.First();
-				if (ins.indexParameter < function->argumentNames.Count())
+				if (variable < function->argumentNames.Count())
 				{
-					return L"(" + function->argumentNames[ins.indexParameter] + L")";
+					return L"(" + function->argumentNames[variable] + L")";
 				}
 				else
 				{
-					return L"(" + function->localVariableNames[ins.indexParameter - function->argumentNames.Count()] + L")";
+					return L"(" + function->localVariableNames[variable - function->argumentNames.Count()] + L")";
 				}
 			}
 		case WfInsCode::LoadCapturedVar:
@@ -290,7 +345,7 @@ void LogSampleCodegenResult(const WString& sampleName, const WString& itemName,
 						return function->firstInstruction <= index && index <= function->lastInstruction;
 					})
 					.First();
-				return L"(" + function->capturedVariableNames[ins.indexParameter] + L")";
+				return L"(" + function->capturedVariableNames[variable] + L")";
 			}
 		default:;
 		}
@@ -301,7 +356,7 @@ void LogSampleCodegenResult(const WString& sampleName, const WString& itemName,
 #define LOG_VALUE(NAME)					case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": value = " + formatValue(ins.valueParameter)); break;
 #define LOG_FUNCTION(NAME)				case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": func = " + itow(ins.indexParameter) + L"(" + assembly->functions[ins.indexParameter]->name + L")"); break;
 #define LOG_FUNCTION_COUNT(NAME)		case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": func = " + itow(ins.indexParameter) + L"(" + assembly->functions[ins.indexParameter]->name + L"), stackPatternCount = " + itow(ins.countParameter)); break;
-#define LOG_VARIABLE(NAME)				case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": var = " + itow(ins.indexParameter) + formatVarName(ins, index)); break;
+#define LOG_VARIABLE(NAME)				case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": var = " + itow(ins.indexParameter) + formatVarName(ins, index, ins.indexParameter)); break;
 #define LOG_COUNT(NAME)					case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": stackPatternCount = " + itow(ins.countParameter)); break;
 #define LOG_FLAG_TYPEDESCRIPTOR(NAME)	case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": flag = " + formatFlag(ins.flagParameter) + L", typeDescriptor = " + ins.typeDescriptorParameter->GetTypeName()); break;
 #define LOG_PROPERTY(NAME)				case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": propertyInfo = " + ins.propertyParameter->GetName() + L"<" + ins.propertyParameter->GetOwnerTypeDescriptor()->GetTypeName() + L">"); break;
@@ -309,6 +364,13 @@ void LogSampleCodegenResult(const WString& sampleName, const WString& itemName,
 #define LOG_EVENT(NAME)					case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": eventInfo = " + ins.eventParameter->GetName() + L"<" + ins.eventParameter->GetOwnerTypeDescriptor()->GetTypeName() + L">"); break;
 #define LOG_LABEL(NAME)					case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": label = " + itow(ins.indexParameter)); break;
 #define LOG_TYPE(NAME)					case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": type = " + formatType(ins.typeParameter)); break;
+#define LOG_VARIABLE_VARIABLE(NAME)		case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": var = " + itow(ins.indexParameter) + formatVarName(ins, index, ins.indexParameter) + L", var = " + itow(ins.countParameter) + formatVarName(ins, index, ins.countParameter)); break;
+#define LOG_VARIABLE_VALUE(NAME)		case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": var = " + itow(ins.indexParameter) + formatVarName(ins, index, ins.indexParameter) + L", value = " + formatValue(ins.valueParameter)); break;
+#define LOG_LABEL_TYPE(NAME)			case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": label = " + itow(ins.indexParameter) + L", type = " + formatType(ins.typeParameter)); break;
+#define LOG_TABLE(NAME)					case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": table = " + itow(ins.indexParameter) + formatTable(assembly->switchTables[ins.indexParameter])); break;
+#define LOG_METHOD_TABLE_COUNT(NAME)	case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": methodTable = " + itow(ins.indexParameter) + formatMethodTable(assembly->methodTables[ins.indexParameter]) + L", stackPatternCount = " + itow(ins.countParameter)); break;
+#define LOG_CONSTANT_SET(NAME)			case WfInsCode::NAME: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": set = " + itow(ins.indexParameter) + formatConstantSet(assembly->constantSets[ins.indexParameter])); break;
+#define LOG_SPECIALIZED(NAME, TYPE)		case WfInsCode::NAME##_##TYPE: writer.WriteLine(formatText(itow(index), 5) + L": " + formatText(L"    " L ## #NAME, 18) + L": type = " + formatType(ins.typeParameter)); break;
 
 	FOREACH_INDEXER(WfInstruction, ins, index, assembly->instructions)
 	{
@@ -339,7 +401,14 @@ void LogSampleCodegenResult(const WString& sampleName, const WString& itemName,
 				LOG_METHOD_COUNT,
 				LOG_EVENT,
 				LOG_LABEL,
-				LOG_TYPE)
+				LOG_TYPE,
+				LOG_VARIABLE_VARIABLE,
+				LOG_VARIABLE_VALUE,
+				LOG_LABEL_TYPE,
+				LOG_TABLE,
+				LOG_METHOD_TABLE_COUNT,
+				LOG_CONSTANT_SET,
+				LOG_SPECIALIZED)
 		}
 	}
 
@@ -355,6 +424,13 @@ void LogSampleCodegenResult(const WString& sampleName, const WString& itemName,
 #undef LOG_EVENT
 #undef LOG_LABEL
 #undef LOG_TYPE
+#undef LOG_VARIABLE_VARIABLE
+#undef LOG_VARIABLE_VALUE
+#undef LOG_LABEL_TYPE
+#undef LOG_TABLE
+#undef LOG_METHOD_TABLE_COUNT
+#undef LOG_CONSTANT_SET
+#undef LOG_SPECIALIZED
 }
 
 namespace test
@@ -520,9 +596,20 @@ void UnloadTypes()
 #if defined VCZH_MSVC
 int wmain(int argc, wchar_t* argv[])
 #elif defined VCZH_GCC
-int main()
+int main(int argc, char* argv[])
 #endif
 {
+	for (vint i = 1; i < argc; i++)
+	{
+#if defined VCZH_MSVC
+		if (wcscmp(argv[i], L"/benchmark") == 0)
+#elif defined VCZH_GCC
+		if (strcmp(argv[i], "--benchmark") == 0)
+#endif
+		{
+			benchmarkEnabled = true;
+		}
+	}
 #if defined VCZH_MSVC
 	{
 		Folder folder(GetTestOutputPath());